@@ -0,0 +1,660 @@
+/**
+ * This file contains the implementation of the adaptive radix tree index interface as defined in art.h
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include "art.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+
+namespace badgerdb
+{
+
+    namespace
+    {
+        // Adds a child to the sorted arrays of a node with room for it
+        void insertSorted(std::uint8_t* keys, std::uintptr_t* children, int& count,
+                          const std::uint8_t byte, const std::uintptr_t child) {
+            int pos = count;
+            while (pos > 0 && keys[pos - 1] > byte) {
+                keys[pos] = keys[pos - 1];
+                children[pos] = children[pos - 1];
+                pos--;
+            }
+            keys[pos] = byte;
+            children[pos] = child;
+            count++;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::ArtIndex -- Constructor
+    // -----------------------------------------------------------------------------
+    ArtIndex::ArtIndex(
+            const std::string & relationName,
+            std::string & outIndexName,
+            BufMgr *bufMgrIn,
+            const int attrByteOffset,
+            const Datatype attrType) {
+
+        // Create index file name
+        std::ostringstream idxStr;
+        idxStr << relationName << '.' << attrByteOffset;
+        outIndexName = idxStr.str();
+
+        root = 0;
+        numEntries = 0;
+        this->relationName = relationName;
+        indexName = outIndexName;
+        this->attrByteOffset = attrByteOffset;
+        attributeType = attrType;
+        bufMgr = bufMgrIn;
+        file = nullptr;
+        headerPageNum = Page::INVALID_NUMBER;
+        scanExecuting = false;
+        nextDuplicate = nullptr;
+
+        if (File::exists(indexName)) {
+            file = new BlobFile(indexName, false);
+            headerPageNum = file->getFirstPageNo();
+
+            PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            if (strcmp(metadata->relationName, relationName.c_str()) != 0
+                || metadata->attrByteOffset != attrByteOffset
+                || metadata->attrType != attrType
+                || metadata->indexKind != ART_INDEX) {
+                headerPage.release();
+                bufMgr->flushFile(file);
+                delete file;
+                throw BadIndexInfoException("Error: Existing index metadata does not match parameters passed.");
+            }
+
+            // Reload the entries of the last checkpoint
+            PageId pageNo = metadata->rootPageNo;
+            headerPage.release();
+            while (pageNo != Page::INVALID_NUMBER) {
+                PageHandle page = bufMgr->readPage(file, pageNo);
+                auto stored = (const LeafNodeInt*) page.page();
+                for (int i = 0; i < INTARRAYLEAFSIZE && stored->ridArray[i].page_number != Page::INVALID_NUMBER; i++)
+                    insertInt(stored->keyArray[i], stored->ridArray[i]);
+                entryPages.push_back(pageNo);
+                pageNo = stored->rightSibPageNo;
+            }
+            return;
+        }
+
+        // Scan relation and insert entries for all tuples into index
+        try {
+            FileScan fileScan(relationName, bufMgr);
+            RecordId rid = {};
+            while (true) {
+                fileScan.scanNext(rid);
+                insertEntry((int*) fileScan.getRecord().c_str() + attrByteOffset, rid);
+            }
+        } catch (EndOfFileException& e) {
+            // Do nothing. Finished scanning file.
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::~ArtIndex -- destructor
+    // -----------------------------------------------------------------------------
+    ArtIndex::~ArtIndex() {
+        scanExecuting = false;
+        free(root);
+        if (file != nullptr) {
+            bufMgr->flushFile(file);
+            delete file;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::keyByte
+    // -----------------------------------------------------------------------------
+    std::uint8_t ArtIndex::keyByte(const int key, const int depth) {
+        const std::uint32_t bits = (std::uint32_t) key ^ 0x80000000U;
+        return (std::uint8_t) (bits >> (24 - 8 * depth));
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::findChild
+    // -----------------------------------------------------------------------------
+    ArtIndex::Ref* ArtIndex::findChild(Node* node, const std::uint8_t byte) {
+        switch (node->type) {
+            case NODE4: {
+                auto n = (Node4*) node;
+                for (int i = 0; i < n->numChildren; i++) {
+                    if (n->keys[i] == byte)
+                        return &n->children[i];
+                }
+                return nullptr;
+            }
+            case NODE16: {
+                auto n = (Node16*) node;
+                for (int i = 0; i < n->numChildren; i++) {
+                    if (n->keys[i] == byte)
+                        return &n->children[i];
+                }
+                return nullptr;
+            }
+            case NODE48: {
+                auto n = (Node48*) node;
+                return n->childIndex[byte] ? &n->children[n->childIndex[byte] - 1] : nullptr;
+            }
+            case NODE256: {
+                auto n = (Node256*) node;
+                return n->children[byte] ? &n->children[byte] : nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::firstChildFrom
+    // -----------------------------------------------------------------------------
+    ArtIndex::Ref ArtIndex::firstChildFrom(const Node* node, const int byte) {
+        switch (node->type) {
+            case NODE4: {
+                auto n = (const Node4*) node;
+                for (int i = 0; i < n->numChildren; i++) {
+                    if (n->keys[i] >= byte)
+                        return n->children[i];
+                }
+                return 0;
+            }
+            case NODE16: {
+                auto n = (const Node16*) node;
+                for (int i = 0; i < n->numChildren; i++) {
+                    if (n->keys[i] >= byte)
+                        return n->children[i];
+                }
+                return 0;
+            }
+            case NODE48: {
+                auto n = (const Node48*) node;
+                for (int b = byte; b < 256; b++) {
+                    if (n->childIndex[b])
+                        return n->children[n->childIndex[b] - 1];
+                }
+                return 0;
+            }
+            case NODE256: {
+                auto n = (const Node256*) node;
+                for (int b = byte; b < 256; b++) {
+                    if (n->children[b])
+                        return n->children[b];
+                }
+                return 0;
+            }
+        }
+        return 0;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::addChild
+    // -----------------------------------------------------------------------------
+    void ArtIndex::addChild(Ref& ref, const std::uint8_t byte, const Ref child) {
+        Node* node = nodeOf(ref);
+        switch (node->type) {
+            case NODE4: {
+                auto n = (Node4*) node;
+                if (n->numChildren < 4) {
+                    insertSorted(n->keys, n->children, n->numChildren, byte, child);
+                    return;
+                }
+                auto bigger = new Node16;
+                *(Node*) bigger = *(Node*) n;
+                bigger->type = NODE16;
+                std::copy(n->keys, n->keys + 4, bigger->keys);
+                std::copy(n->children, n->children + 4, bigger->children);
+                delete n;
+                insertSorted(bigger->keys, bigger->children, bigger->numChildren, byte, child);
+                ref = (Ref) bigger;
+                return;
+            }
+            case NODE16: {
+                auto n = (Node16*) node;
+                if (n->numChildren < 16) {
+                    insertSorted(n->keys, n->children, n->numChildren, byte, child);
+                    return;
+                }
+                auto bigger = new Node48;
+                *(Node*) bigger = *(Node*) n;
+                bigger->type = NODE48;
+                std::memset(bigger->childIndex, 0, sizeof(bigger->childIndex));
+                for (int i = 0; i < 16; i++) {
+                    bigger->childIndex[n->keys[i]] = (std::uint8_t) (i + 1);
+                    bigger->children[i] = n->children[i];
+                }
+                delete n;
+                ref = (Ref) bigger;
+                addChild(ref, byte, child);
+                return;
+            }
+            case NODE48: {
+                auto n = (Node48*) node;
+                if (n->numChildren < 48) {
+                    // Children are never removed, so the slots are used in order
+                    n->children[n->numChildren] = child;
+                    n->childIndex[byte] = (std::uint8_t) (n->numChildren + 1);
+                    n->numChildren++;
+                    return;
+                }
+                auto bigger = new Node256;
+                *(Node*) bigger = *(Node*) n;
+                bigger->type = NODE256;
+                for (int b = 0; b < 256; b++)
+                    bigger->children[b] = n->childIndex[b] ? n->children[n->childIndex[b] - 1] : 0;
+                delete n;
+                ref = (Ref) bigger;
+                addChild(ref, byte, child);
+                return;
+            }
+            case NODE256: {
+                auto n = (Node256*) node;
+                n->children[byte] = child;
+                n->numChildren++;
+                return;
+            }
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::insert
+    // -----------------------------------------------------------------------------
+    void ArtIndex::insert(Ref& ref, Leaf* leaf, int depth) {
+        const Ref leafRef = (Ref) leaf | 1;
+        if (ref == 0) {
+            ref = leafRef;
+            return;
+        }
+
+        if (isLeaf(ref)) {
+            Leaf* existing = leafOf(ref);
+            if (existing->key == leaf->key) {
+                // Behind the first entry, so the tree does not change
+                leaf->next = existing->next;
+                existing->next = leaf;
+                return;
+            }
+
+            // Both leaves go below a new node, after the bytes their keys share
+            auto node = new Node4;
+            node->type = NODE4;
+            node->numChildren = 0;
+            node->prefixLength = 0;
+            while (keyByte(existing->key, depth + node->prefixLength) == keyByte(leaf->key, depth + node->prefixLength)) {
+                node->prefix[node->prefixLength] = keyByte(leaf->key, depth + node->prefixLength);
+                node->prefixLength++;
+            }
+            const int split = depth + node->prefixLength;
+            Ref nodeRef = (Ref) node;
+            addChild(nodeRef, keyByte(existing->key, split), ref);
+            addChild(nodeRef, keyByte(leaf->key, split), leafRef);
+            ref = nodeRef;
+            return;
+        }
+
+        Node* node = nodeOf(ref);
+        for (int i = 0; i < node->prefixLength; i++) {
+            const std::uint8_t byte = keyByte(leaf->key, depth + i);
+            if (byte != node->prefix[i]) {
+                // The key leaves the prefix here: a new node takes the shared part, the old node keeps the rest
+                auto parent = new Node4;
+                parent->type = NODE4;
+                parent->numChildren = 0;
+                parent->prefixLength = i;
+                std::copy(node->prefix, node->prefix + i, parent->prefix);
+                const std::uint8_t nodeByte = node->prefix[i];
+                node->prefixLength -= i + 1;
+                std::memmove(node->prefix, node->prefix + i + 1, node->prefixLength);
+
+                Ref parentRef = (Ref) parent;
+                addChild(parentRef, nodeByte, ref);
+                addChild(parentRef, byte, leafRef);
+                ref = parentRef;
+                return;
+            }
+        }
+        depth += node->prefixLength;
+
+        Ref* child = findChild(node, keyByte(leaf->key, depth));
+        if (child != nullptr) {
+            insert(*child, leaf, depth + 1);
+            return;
+        }
+        addChild(ref, keyByte(leaf->key, depth), leafRef);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::minimum
+    // -----------------------------------------------------------------------------
+    const ArtIndex::Leaf* ArtIndex::minimum(Ref ref) {
+        while (!isLeaf(ref))
+            ref = firstChildFrom(nodeOf(ref), 0);
+        return leafOf(ref);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::lowerBound
+    // -----------------------------------------------------------------------------
+    const ArtIndex::Leaf* ArtIndex::lowerBound(const Ref ref, const int key, int depth) {
+        if (ref == 0)
+            return nullptr;
+        if (isLeaf(ref)) {
+            const Leaf* leaf = leafOf(ref);
+            return leaf->key >= key ? leaf : nullptr;
+        }
+
+        // Below the node all keys are larger or all are smaller if the prefix differs
+        const Node* node = nodeOf(ref);
+        for (int i = 0; i < node->prefixLength; i++) {
+            const std::uint8_t byte = keyByte(key, depth + i);
+            if (node->prefix[i] > byte)
+                return minimum(ref);
+            if (node->prefix[i] < byte)
+                return nullptr;
+        }
+        depth += node->prefixLength;
+
+        const std::uint8_t byte = keyByte(key, depth);
+        Ref* child = findChild((Node*) node, byte);
+        if (child != nullptr) {
+            const Leaf* leaf = lowerBound(*child, key, depth + 1);
+            if (leaf != nullptr)
+                return leaf;
+        }
+        const Ref next = firstChildFrom(node, byte + 1);
+        return next ? minimum(next) : nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::collect
+    // -----------------------------------------------------------------------------
+    void ArtIndex::collect(const Ref ref, std::vector<const Leaf*>& leaves) {
+        if (ref == 0)
+            return;
+        if (isLeaf(ref)) {
+            for (const Leaf* leaf = leafOf(ref); leaf != nullptr; leaf = leaf->next)
+                leaves.push_back(leaf);
+            return;
+        }
+
+        const Node* node = nodeOf(ref);
+        switch (node->type) {
+            case NODE4:
+                for (int i = 0; i < node->numChildren; i++)
+                    collect(((const Node4*) node)->children[i], leaves);
+                break;
+            case NODE16:
+                for (int i = 0; i < node->numChildren; i++)
+                    collect(((const Node16*) node)->children[i], leaves);
+                break;
+            case NODE48: {
+                auto n = (const Node48*) node;
+                for (int b = 0; b < 256; b++) {
+                    if (n->childIndex[b])
+                        collect(n->children[n->childIndex[b] - 1], leaves);
+                }
+                break;
+            }
+            case NODE256:
+                for (int b = 0; b < 256; b++)
+                    collect(((const Node256*) node)->children[b], leaves);
+                break;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::free
+    // -----------------------------------------------------------------------------
+    void ArtIndex::free(const Ref ref) {
+        if (ref == 0)
+            return;
+        if (isLeaf(ref)) {
+            Leaf* leaf = leafOf(ref);
+            while (leaf != nullptr) {
+                Leaf* next = leaf->next;
+                delete leaf;
+                leaf = next;
+            }
+            return;
+        }
+
+        Node* node = nodeOf(ref);
+        switch (node->type) {
+            case NODE4:
+                for (int i = 0; i < node->numChildren; i++)
+                    free(((Node4*) node)->children[i]);
+                delete (Node4*) node;
+                break;
+            case NODE16:
+                for (int i = 0; i < node->numChildren; i++)
+                    free(((Node16*) node)->children[i]);
+                delete (Node16*) node;
+                break;
+            case NODE48:
+                for (int i = 0; i < node->numChildren; i++)
+                    free(((Node48*) node)->children[i]);
+                delete (Node48*) node;
+                break;
+            case NODE256:
+                for (int b = 0; b < 256; b++)
+                    free(((Node256*) node)->children[b]);
+                delete (Node256*) node;
+                break;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::insertInt
+    // -----------------------------------------------------------------------------
+    void ArtIndex::insertInt(const int key, const RecordId rid) {
+        auto leaf = new Leaf;
+        leaf->key = key;
+        leaf->rid = rid;
+        leaf->next = nullptr;
+        insert(root, leaf, 0);
+        numEntries++;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::insertEntry
+    // -----------------------------------------------------------------------------
+    void ArtIndex::insertEntry(const void *key, const RecordId rid) {
+        if (key == nullptr)
+            return;
+        insertInt(*((int*) key), rid);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::lookup
+    // -----------------------------------------------------------------------------
+    void ArtIndex::lookup(const void *key, RecordId& outRid) {
+        const int intKey = *((int*) key);
+        Ref ref = root;
+        int depth = 0;
+        while (ref != 0) {
+            if (isLeaf(ref)) {
+                const Leaf* leaf = leafOf(ref);
+                if (leaf->key == intKey) {
+                    outRid = leaf->rid;
+                    return;
+                }
+                break;
+            }
+
+            Node* node = nodeOf(ref);
+            int i = 0;
+            while (i < node->prefixLength && node->prefix[i] == keyByte(intKey, depth + i))
+                i++;
+            if (i < node->prefixLength)
+                break;
+            depth += node->prefixLength;
+
+            Ref* child = findChild(node, keyByte(intKey, depth));
+            if (child == nullptr)
+                break;
+            ref = *child;
+            depth++;
+        }
+        throw NoSuchKeyFoundException();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::checkpoint
+    // -----------------------------------------------------------------------------
+    void ArtIndex::checkpoint() {
+        if (file == nullptr) {
+            file = new BlobFile(indexName, true);
+            PageHandle headerPage = bufMgr->allocPage(file, headerPageNum);
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            strcpy(metadata->relationName, relationName.c_str());
+            metadata->attrByteOffset = attrByteOffset;
+            metadata->attrType = attributeType;
+            metadata->rootPageNo = Page::INVALID_NUMBER;
+            metadata->bloomPageNo = Page::INVALID_NUMBER;
+            metadata->indexKind = ART_INDEX;
+            headerPage.markDirty();
+        }
+
+        std::vector<const Leaf*> leaves;
+        collect(root, leaves);
+
+        // Full pages, reusing the pages of the last checkpoint first
+        const std::size_t numPages = std::max<std::size_t>(1, (leaves.size() + INTARRAYLEAFSIZE - 1) / INTARRAYLEAFSIZE);
+        while (entryPages.size() < numPages) {
+            PageId pageNo;
+            bufMgr->allocPage(file, pageNo).release();
+            entryPages.push_back(pageNo);
+        }
+        for (std::size_t p = 0; p < numPages; p++) {
+            PageHandle page = bufMgr->readPage(file, entryPages[p]);
+            auto stored = (LeafNodeInt*) page.page();
+            for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
+                const std::size_t idx = p * INTARRAYLEAFSIZE + i;
+                if (idx < leaves.size()) {
+                    stored->keyArray[i] = leaves[idx]->key;
+                    stored->ridArray[i] = leaves[idx]->rid;
+                } else {
+                    stored->keyArray[i] = -1;
+                    stored->ridArray[i].page_number = Page::INVALID_NUMBER;
+                    stored->ridArray[i].slot_number = Page::INVALID_SLOT;
+                }
+            }
+            stored->rightSibPageNo = p + 1 < numPages ? entryPages[p + 1] : Page::INVALID_NUMBER;
+            page.markDirty();
+        }
+
+        PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+        ((IndexMetaInfo*) headerPage.page())->rootPageNo = entryPages[0];
+        headerPage.markDirty();
+        headerPage.release();
+        bufMgr->flushFile(file);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::startScan
+    // -----------------------------------------------------------------------------
+    void ArtIndex::startScan(const void* lowValParm,
+                             const Operator lowOpParm,
+                             const void* highValParm,
+                             const Operator highOpParm) {
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+            throw BadOpcodesException();
+        }
+
+        const int lowValInt = *(int *)lowValParm;
+        highValInt = *(int *)highValParm;
+        if (lowValInt > highValInt)
+            throw BadScanrangeException();
+
+        if (scanExecuting) {
+            endScan();
+        }
+        highOp = highOpParm;
+        nextKey = lowOpParm == GT ? (std::int64_t) lowValInt + 1 : lowValInt;
+        nextDuplicate = nullptr;
+        scanExecuting = true;
+
+        // Make sure the scan finds anything at all
+        const std::int64_t firstKey = nextKey;
+        RecordId rid;
+        try {
+            scanNext(rid);
+        } catch (IndexScanCompletedException& e) {
+            endScan();
+            throw NoSuchKeyFoundException();
+        }
+        nextKey = firstKey;
+        nextDuplicate = nullptr;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::scanNext
+    // -----------------------------------------------------------------------------
+    void ArtIndex::scanNext(RecordId& outRid) {
+        if (!scanExecuting)
+            throw ScanNotInitializedException();
+
+        // Leaves are never freed, so the other entries of the last key can be followed directly
+        if (nextDuplicate != nullptr) {
+            outRid = nextDuplicate->rid;
+            nextDuplicate = nextDuplicate->next;
+            return;
+        }
+
+        // Each key is found from the root, so entries inserted during the scan are no problem
+        if (nextKey > INT_MAX)
+            throw IndexScanCompletedException();
+        const Leaf* leaf = lowerBound(root, (int) nextKey, 0);
+        if (leaf == nullptr || (highOp == LT && leaf->key >= highValInt) || (highOp == LTE && leaf->key > highValInt))
+            throw IndexScanCompletedException();
+
+        outRid = leaf->rid;
+        nextDuplicate = leaf->next;
+        nextKey = (std::int64_t) leaf->key + 1;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // ArtIndex::endScan
+    // -----------------------------------------------------------------------------
+    void ArtIndex::endScan() {
+        if (!scanExecuting)
+            throw ScanNotInitializedException();
+        scanExecuting = false;
+    }
+
+}
@@ -0,0 +1,333 @@
+/**
+ * This is the header file for an in-memory adaptive radix tree index over a single INTEGER attribute.
+ * It offers the interface of BTreeIndex for relations whose index fits into memory.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief ArtIndex class. It implements an adaptive radix tree (ART) index on a single INTEGER attribute
+ * of a relation. Keys are split into their four bytes, most significant first, and every node branches
+ * on one byte; nodes come in four sizes, for up to 4, 16, 48 and 256 children, and grow as children
+ * are added. A common run of bytes below a node is stored in the node as its prefix, and a key gets
+ * its own leaf as soon as no other key shares its bytes so far, so a lookup visits at most four nodes.
+ * Further entries with the key of a leaf are chained to it.
+ *
+ * The tree lives in memory and does not use the buffer manager while it is used. checkpoint() writes
+ * the entries in key order to the index file, and the constructor reloads them from there if the file
+ * exists instead of scanning the relation. This index supports only one scan at a time.
+ */
+    class ArtIndex {
+
+    private:
+
+        /**
+         * Reference to a child: a pointer to a node or, with the lowest bit set, to a leaf. 0 if there is none.
+         */
+        typedef std::uintptr_t Ref;
+
+        /**
+         * Node sizes.
+         */
+        enum NodeType { NODE4, NODE16, NODE48, NODE256 };
+
+        /**
+         * Entry of the index.
+         */
+        struct Leaf {
+            int key;
+            RecordId rid;
+            /** Next entry with the same key, NULL if there is none. */
+            Leaf* next;
+        };
+
+        /**
+         * Common part of all nodes.
+         */
+        struct Node {
+            NodeType type;
+            /** Number of children. */
+            int numChildren;
+            /** Number of key bytes in the prefix. */
+            int prefixLength;
+            /** Key bytes all keys below the node share, after those of the nodes above it. */
+            std::uint8_t prefix[4];
+        };
+
+        /**
+         * Node with up to 4 children, sorted by key byte.
+         */
+        struct Node4 : Node {
+            std::uint8_t keys[4];
+            Ref children[4];
+        };
+
+        /**
+         * Node with up to 16 children, sorted by key byte.
+         */
+        struct Node16 : Node {
+            std::uint8_t keys[16];
+            Ref children[16];
+        };
+
+        /**
+         * Node with up to 48 children. childIndex holds one more than the slot of the child for each key byte, 0 if there is none.
+         */
+        struct Node48 : Node {
+            std::uint8_t childIndex[256];
+            Ref children[48];
+        };
+
+        /**
+         * Node with a child slot for every key byte.
+         */
+        struct Node256 : Node {
+            Ref children[256];
+        };
+
+        /**
+         * Root of the tree.
+         */
+        Ref		root;
+
+        /**
+         * Number of entries.
+         */
+        std::uint64_t	numEntries;
+
+        /**
+         * Name of base relation.
+         */
+        std::string	relationName;
+
+        /**
+         * Name of the index file.
+         */
+        std::string	indexName;
+
+        /**
+         * Offset of attribute, over which index is built, inside records.
+         */
+        int			attrByteOffset;
+
+        /**
+         * Datatype of attribute over which index is built.
+         */
+        Datatype	attributeType;
+
+        /**
+         * Buffer Manager Instance.
+         */
+        BufMgr	*bufMgr;
+
+        /**
+         * File object for the index file, NULL before the first checkpoint if the file did not exist.
+         */
+        File		*file;
+
+        /**
+         * Page number of meta page.
+         */
+        PageId	headerPageNum;
+
+        /**
+         * Pages of the index file holding entries, in key order.
+         */
+        std::vector<PageId>	entryPages;
+
+
+        // MEMBERS SPECIFIC TO SCANNING
+
+        /**
+         * True if an index scan has been started.
+         */
+        bool		scanExecuting;
+
+        /**
+         * Smallest key the next entry to be scanned may have.
+         */
+        std::int64_t	nextKey;
+
+        /**
+         * Next entry to be scanned with the key of the last one, NULL if there is none.
+         */
+        const Leaf*	nextDuplicate;
+
+        /**
+         * High INTEGER value for scan.
+         */
+        int			highValInt;
+
+        /**
+         * High Operator. Can only be LT(<) or LTE(<=).
+         */
+        Operator	highOp;
+
+
+        static bool isLeaf(Ref ref) { return (ref & 1) != 0; }
+        static Leaf* leafOf(Ref ref) { return (Leaf*) (ref & ~(Ref) 1); }
+        static Node* nodeOf(Ref ref) { return (Node*) ref; }
+
+        /**
+         * Returns the byte of a key at the given depth, the most significant byte first. The sign bit is
+         * flipped, so keys are ordered as their bytes are.
+         */
+        static std::uint8_t keyByte(int key, int depth);
+
+        /**
+         * Returns the slot of the child for a key byte, NULL if there is none.
+         */
+        static Ref* findChild(Node* node, std::uint8_t byte);
+
+        /**
+         * Returns the child with the smallest key byte not below the given one, 0 if there is none.
+         */
+        static Ref firstChildFrom(const Node* node, int byte);
+
+        /**
+         * Adds a child to a node, replacing the node by a larger one if it is full.
+         * @param ref		Reference to the node, updated if the node is replaced
+         * @param byte		Key byte of the child
+         * @param child		The child
+         */
+        static void addChild(Ref& ref, std::uint8_t byte, Ref child);
+
+        /**
+         * Inserts a leaf below a node, or adds it to the entries of the leaf with the same key.
+         * @param ref		Reference to the node or leaf, updated if it is replaced
+         * @param leaf		New leaf
+         * @param depth		Number of key bytes consumed by the nodes above
+         */
+        static void insert(Ref& ref, Leaf* leaf, int depth);
+
+        /**
+         * Returns the leaf with the smallest key below a node.
+         */
+        static const Leaf* minimum(Ref ref);
+
+        /**
+         * Returns the leaf with the smallest key not below the given one, NULL if there is none.
+         * @param ref		Reference to the node or leaf
+         * @param key		Key to search for
+         * @param depth		Number of key bytes consumed by the nodes above
+         */
+        static const Leaf* lowerBound(Ref ref, int key, int depth);
+
+        /**
+         * Appends the leaves below a node to a list in key order, with every entry of a key.
+         */
+        static void collect(Ref ref, std::vector<const Leaf*>& leaves);
+
+        /**
+         * Frees a node or leaf and everything below it.
+         */
+        static void free(Ref ref);
+
+        /**
+         * Inserts an entry into the tree.
+         */
+        void insertInt(int key, RecordId rid);
+
+    public:
+
+        /**
+         * ArtIndex Constructor.
+         * Check to see if the corresponding index file exists. If so, load the entries of its last checkpoint.
+         * If not, insert entries for every tuple in the base relation using FileScan class; the file is only
+         * created by checkpoint().
+         *
+         * @param relationName        Name of file.
+         * @param outIndexName        Return the name of index file.
+         * @param bufMgrIn			  Buffer Manager Instance
+         * @param attrByteOffset	  Offset of attribute, over which index is to be built, in the record
+         * @param attrType			  Datatype of attribute over which index is built
+         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters, or the file holds another kind of index.
+         */
+        ArtIndex(const std::string & relationName, std::string & outIndexName,
+                 BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+
+        /**
+         * ArtIndex Destructor.
+         * Frees the tree and closes the index file, if it is open. Entries inserted since the last checkpoint
+         * are not written.
+         */
+        ~ArtIndex();
+
+
+        /**
+         * Insert a new entry using the pair <value,rid>.
+         * Entries with the same key are all kept.
+         * @param key			Key to insert, pointer to integer
+         * @param rid			Record ID of a record whose entry is getting inserted into the index.
+         */
+        void insertEntry(const void* key, RecordId rid);
+
+
+        /**
+         * Find the record id of the entry with the given key.
+         * @param key			Key to search for, pointer to integer
+         * @param outRid		RecordId of the entry returned in this
+         * @throws  NoSuchKeyFoundException If there is no entry with the key in the index.
+         */
+        void lookup(const void* key, RecordId& outRid);
+
+
+        /**
+         * Writes all entries in key order to the index file, creating it if needed, and flushes it.
+         */
+        void checkpoint();
+
+
+        /**
+         * Returns the number of entries in the index.
+         */
+        std::uint64_t entryCount() const { return numEntries; }
+
+
+        /**
+         * Begin a filtered scan of the index. Entries inserted during the scan are seen if their key
+         * is above that of the last entry returned.
+         * @param lowVal	Low value of range, pointer to integer
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer
+         * @param highOp	High operator (LT/LTE)
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+         * @throws  NoSuchKeyFoundException If there is no key in the index that satisfies the scan criteria.
+         */
+        void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+        /**
+         * Fetch the record id of the next index entry that matches the scan.
+         * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+         * @throws ScanNotInitializedException If no scan has been initialized.
+         * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+         */
+        void scanNext(RecordId& outRid);
+
+
+        /**
+         * Terminate the current scan. Reset scan specific variables.
+         * @throws ScanNotInitializedException If no scan has been initialized.
+         */
+        void endScan();
+
+    };
+
+}
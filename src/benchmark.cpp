@@ -0,0 +1,1191 @@
+/**
+ * This file contains micro benchmarks for the buffer manager and the b+tree index.
+ * Build them with "make bench" and run ./src/badgerdb_bench from the top directory.
+ * "make bench-page-sizes" runs the page size benchmark for every supported page size.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "btree.h"
+#include "betree.h"
+#include "bwtree.h"
+#include "hashindex.h"
+#include "art.h"
+#include "page.h"
+#include "file_appender.h"
+#include "file_cache_tier.h"
+#include "compressed_memory_tier.h"
+#include "filescan.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Globals
+// -----------------------------------------------------------------------------
+const std::string relationName = "relBench";
+const int relationSize = 200000;
+std::uint32_t relationPages = 0;
+
+// This is the structure for tuples in the base relation
+
+typedef struct tuple {
+	int i;
+	double d;
+	char s[64];
+} RECORD;
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsedNs(const Clock::time_point& start)
+{
+	return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+}
+
+void removeFile(const std::string& name)
+{
+	try
+	{
+		File::remove(name);
+	}
+	catch(FileNotFoundException& e)
+	{
+	}
+}
+
+// Creates the benchmark relation with keys 0 to relationSize - 1 in random order.
+void createRelation()
+{
+	removeFile(relationName);
+	PageFile file(relationName, true);
+	FileAppender appender(&file);
+
+	std::vector<int> keys(relationSize);
+	for (int i = 0; i < relationSize; i++)
+		keys[i] = i;
+	for (int i = relationSize - 1; i > 0; i--)
+		std::swap(keys[i], keys[random() % (i + 1)]);
+
+	RECORD record;
+	memset(&record, ' ', sizeof(record));
+	for (int i = 0; i < relationSize; i++)
+	{
+		sprintf(record.s, "%05d string record", keys[i]);
+		record.i = keys[i];
+		record.d = keys[i];
+		appender.appendRecord(std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+	}
+	appender.finish();
+	relationPages = appender.pagesWritten();
+}
+
+// -----------------------------------------------------------------------------
+// Benchmarks
+// -----------------------------------------------------------------------------
+
+// Pinning and unpinning resident pages through the page number API (two hash
+// table lookups per pin) and through PageHandle (one lookup per pin).
+void benchPageHandle()
+{
+	const std::string fileName = "relBench.pin";
+	const int numPages = 64;
+	const int rounds = 20000;
+
+	removeFile(fileName);
+	BufMgr bufMgr(100);
+	{
+		BlobFile file(fileName, true);
+		std::vector<PageId> pageNos(numPages);
+		for (int i = 0; i < numPages; i++)
+			bufMgr.allocPage(&file, pageNos[i]).markDirty();
+
+		Clock::time_point start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+		{
+			for (int i = 0; i < numPages; i++)
+			{
+				Page* page;
+				bufMgr.readPage(&file, pageNos[i], page);
+				bufMgr.unPinPage(&file, pageNos[i], false);
+			}
+		}
+		const double byPageNo = elapsedNs(start) / (rounds * numPages);
+
+		start = Clock::now();
+		for (int r = 0; r < rounds; r++)
+		{
+			for (int i = 0; i < numPages; i++)
+			{
+				PageHandle page = bufMgr.readPage(&file, pageNos[i]);
+			}
+		}
+		const double byHandle = elapsedNs(start) / (rounds * numPages);
+
+		std::cout << "pin/unpin by page number: " << byPageNo << " ns" << std::endl;
+		std::cout << "pin/unpin by PageHandle:  " << byHandle << " ns" << std::endl;
+		std::cout << "saved per pinned page:    " << byPageNo - byHandle << " ns" << std::endl;
+
+		bufMgr.flushFile(&file);
+	}
+	removeFile(fileName);
+}
+
+// Root to leaf descents of the index, one per scan. Every level is pinned
+// through a PageHandle, so each descent saves one hash lookup per level.
+void benchDescent()
+{
+	const int numScans = 20000;
+	std::string indexName;
+
+	BufMgr bufMgr(100);
+	{
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+
+		Clock::time_point start = Clock::now();
+		for (int n = 0; n < numScans; n++)
+		{
+			int key = random() % relationSize;
+			RecordId rid;
+			index.startScan(&key, GTE, &key, LTE);
+			index.scanNext(rid);
+			index.endScan();
+		}
+		std::cout << "point scan descent:       " << elapsedNs(start) / numScans / 1000 << " us" << std::endl;
+
+		// Lookups pin each node on the way down, but keep no scan state
+		start = Clock::now();
+		for (int n = 0; n < numScans; n++)
+		{
+			int key = random() % relationSize;
+			RecordId rid;
+			index.lookup(&key, rid);
+		}
+		std::cout << "point lookup:             " << elapsedNs(start) / numScans / 1000 << " us" << std::endl;
+	}
+	removeFile(indexName);
+}
+
+// Point scan descents with child references resolved through the buffer
+// pool hash table and with swizzled references resolved by frame number.
+void benchSwizzling()
+{
+	const int numScans = 20000;
+	std::string indexName;
+
+	BufMgr bufMgr(1000);
+	{
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+
+		for (int swizzle = 0; swizzle < 2; swizzle++)
+		{
+			bufMgr.setSwizzling(swizzle == 1);
+
+			// Warm up the pool (and swizzle the references) before timing
+			for (int n = 0; n < numScans; n++)
+			{
+				int key = random() % relationSize;
+				RecordId rid;
+				index.startScan(&key, GTE, &key, LTE);
+				index.scanNext(rid);
+				index.endScan();
+			}
+
+			Clock::time_point start = Clock::now();
+			for (int n = 0; n < numScans; n++)
+			{
+				int key = random() % relationSize;
+				RecordId rid;
+				index.startScan(&key, GTE, &key, LTE);
+				index.scanNext(rid);
+				index.endScan();
+			}
+			std::cout << (swizzle ? "descent, swizzled:        " : "descent, page numbers:    ")
+				<< elapsedNs(start) / numScans / 1000 << " us" << std::endl;
+		}
+		bufMgr.setSwizzling(false);
+	}
+	removeFile(indexName);
+}
+
+// Lookups while a file scan streams the relation through the same small pool.
+// Without resident levels the clock evicts the upper levels of the index, with
+// them every lookup only has to bring in the leaf.
+void benchResidentLevels()
+{
+	const int numLookups = 20000;
+	std::string indexName;
+
+	BufMgr bufMgr(100);
+	{
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+
+		for (int levels = 0; levels <= 2; levels += 2)
+		{
+			index.setResidentLevels(levels);
+			bufMgr.clearBufStats();
+
+			FileScan scan(relationName, &bufMgr);
+			Clock::time_point start = Clock::now();
+			for (int n = 0; n < numLookups; n++)
+			{
+				// Scan pressure: one relation page per lookup
+				RecordId scanRid;
+				for (int r = 0; r < 40; r++)
+				{
+					try
+					{
+						scan.scanNext(scanRid);
+					}
+					catch (EndOfFileException& e)
+					{
+						break;
+					}
+				}
+
+				int key = random() % relationSize;
+				RecordId rid;
+				index.lookup(&key, rid);
+			}
+			std::cout << "resident levels " << levels << ":        " << elapsedNs(start) / numLookups / 1000
+				<< " us, " << bufMgr.getBufStats().diskreads << " disk reads" << std::endl;
+		}
+		index.setResidentLevels(0);
+	}
+	removeFile(indexName);
+}
+
+// Warming up a pool of 1000 frames with the hot pages of an earlier run: one
+// synchronous readPage() per page in recency order against restoreHotPages(),
+// which reads the pages back sorted and in batches.
+void benchWarmup()
+{
+	const std::string dumpName = "relBench.hot";
+	const std::uint32_t numFrames = 1000;
+
+	PageFile file(relationName, false);
+	{
+		// Random accesses to build up a hot page list
+		BufMgr bufMgr(numFrames);
+		for (std::uint32_t n = 0; n < 4 * numFrames; n++)
+		{
+			const PageId pageNo = 1 + random() % relationPages;
+			bufMgr.readPage(&file, pageNo).release();
+		}
+		bufMgr.dumpHotPages(dumpName);
+	}
+
+	std::vector<PageId> pageNos;
+	{
+		std::ifstream dump(dumpName.c_str());
+		std::string line;
+		std::getline(dump, line);
+		PageId pageNo;
+		while (dump >> pageNo && std::getline(dump, line))
+			pageNos.push_back(pageNo);
+	}
+
+	{
+		BufMgr bufMgr(numFrames);
+		Clock::time_point start = Clock::now();
+		for (PageId pageNo : pageNos)
+			bufMgr.readPage(&file, pageNo).release();
+		std::cout << "page at a time:           " << elapsedNs(start) / 1000000 << " ms for "
+			<< pageNos.size() << " pages" << std::endl;
+	}
+	{
+		BufMgr bufMgr(numFrames);
+		Clock::time_point start = Clock::now();
+		const std::uint32_t restored = bufMgr.restoreHotPages(dumpName, std::vector<File*>(1, &file));
+		std::cout << "restoreHotPages:          " << elapsedNs(start) / 1000000 << " ms for "
+			<< restored << " pages" << std::endl;
+	}
+	removeFile(dumpName);
+}
+
+// Growing a pool with 1000 resident pages to 20000 frames and shrinking it back.
+// Growing only appends frames and rehashes; shrinking drains the removed frames.
+void benchResize()
+{
+	BufMgr bufMgr(1000);
+	PageFile file(relationName, false);
+	for (PageId pageNo = 1; pageNo <= relationPages && pageNo <= 1000; pageNo++)
+		bufMgr.readPage(&file, pageNo).release();
+
+	Clock::time_point start = Clock::now();
+	bufMgr.resize(20000);
+	std::cout << "grow 1000 -> 20000:       " << elapsedNs(start) / 1000000 << " ms" << std::endl;
+
+	for (PageId pageNo = 1; pageNo <= relationPages; pageNo++)
+		bufMgr.readPage(&file, pageNo).release();
+
+	start = Clock::now();
+	bufMgr.resize(1000);
+	std::cout << "shrink 20000 -> 1000:     " << elapsedNs(start) / 1000000 << " ms" << std::endl;
+	bufMgr.flushFile(&file);
+}
+
+// Random lookups through a small pool, with and without a file cache tier
+// behind it. With the tier, pages falling out of the pool are read back from
+// the cache file instead of the index file.
+void benchPageTier()
+{
+	const int numLookups = 50000;
+	std::string indexName;
+
+	for (int tiered = 0; tiered < 2; tiered++)
+	{
+		FileCacheTier tier("relBench.cache", 4000, FileCacheTier::ADMIT_ALL);
+		BufMgr bufMgr(50);
+		if (tiered)
+			bufMgr.setPageTier(&tier);
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+			bufMgr.clearBufStats();
+
+			Clock::time_point start = Clock::now();
+			for (int n = 0; n < numLookups; n++)
+			{
+				int key = random() % relationSize;
+				RecordId rid;
+				index.lookup(&key, rid);
+			}
+			std::cout << (tiered ? "with file cache tier:     " : "without tier:             ")
+				<< elapsedNs(start) / numLookups / 1000 << " us, "
+				<< bufMgr.getBufStats().diskreads << " disk reads, "
+				<< bufMgr.getBufStats().tierreads << " tier reads" << std::endl;
+		}
+		bufMgr.setPageTier(NULL);
+	}
+	removeFile(indexName);
+}
+
+// Random lookups with the same amount of memory spent as 100 frames, and as 50
+// frames plus a compressed memory tier holding 50 frames' worth of bytes.
+void benchCompressedTier()
+{
+	const int numLookups = 50000;
+	std::string indexName;
+
+	for (int tiered = 0; tiered < 2; tiered++)
+	{
+		CompressedMemoryTier tier(50 * Page::SIZE);
+		BufMgr bufMgr(tiered ? 50 : 100);
+		if (tiered)
+			bufMgr.setPageTier(&tier);
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+			bufMgr.clearBufStats();
+
+			Clock::time_point start = Clock::now();
+			for (int n = 0; n < numLookups; n++)
+			{
+				int key = random() % relationSize;
+				RecordId rid;
+				index.lookup(&key, rid);
+			}
+			std::cout << (tiered ? "50 frames + compressed:   " : "100 frames:               ")
+				<< elapsedNs(start) / numLookups / 1000 << " us, "
+				<< bufMgr.getBufStats().diskreads << " disk reads, "
+				<< bufMgr.getBufStats().tierreads << " tier reads" << std::endl;
+			if (tiered)
+				std::cout << "compressed pages held:    " << tier.size() << ", ratio "
+					<< tier.compressionRatio() << std::endl;
+		}
+		bufMgr.setPageTier(NULL);
+	}
+	removeFile(indexName);
+}
+
+// Full index scans through a small pool over a plain and a compressed index
+// file: file size against scan throughput, and the time to build each index.
+void benchCompressedFile()
+{
+	for (int compressed = 0; compressed < 2; compressed++)
+	{
+		std::string indexName;
+		BufMgr bufMgr(100);
+		Clock::time_point start = Clock::now();
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER, compressed ? COMPRESSED_FILE : PLAIN_FILE);
+			const double buildMs = elapsedNs(start) / 1000000;
+
+			std::ifstream stream(indexName.c_str(), std::ifstream::binary | std::ifstream::ate);
+			const double fileKb = static_cast<double>(stream.tellg()) / 1024;
+
+			start = Clock::now();
+			int low = 0;
+			int high = relationSize;
+			int count = 0;
+			index.startScan(&low, GTE, &high, LT);
+			try
+			{
+				RecordId rid;
+				while (true)
+				{
+					index.scanNext(rid);
+					count++;
+				}
+			}
+			catch (IndexScanCompletedException& e)
+			{
+			}
+			index.endScan();
+			const double scanMs = elapsedNs(start) / 1000000;
+
+			std::cout << (compressed ? "compressed file:          " : "plain file:               ")
+				<< fileKb << " KB, build " << buildMs << " ms, scan of " << count << " keys "
+				<< scanMs << " ms" << std::endl;
+		}
+		removeFile(indexName);
+	}
+}
+
+// Building the index, random lookups and a full scan with the page size of this
+// build. The pool holds the same number of bytes at every page size.
+void benchPageSize()
+{
+	const int numLookups = 50000;
+	const std::uint32_t poolBytes = 1024 * 1024;
+	std::string indexName;
+
+	std::cout << "page size " << Page::SIZE << ": leaf fanout " << INTARRAYLEAFSIZE
+		<< ", non-leaf fanout " << INTARRAYNONLEAFSIZE << std::endl;
+
+	BufMgr bufMgr(poolBytes / Page::SIZE);
+	Clock::time_point start = Clock::now();
+	{
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+		std::cout << "build:                    " << elapsedNs(start) / 1000000 << " ms" << std::endl;
+
+		bufMgr.clearBufStats();
+		start = Clock::now();
+		for (int n = 0; n < numLookups; n++)
+		{
+			int key = random() % relationSize;
+			RecordId rid;
+			index.lookup(&key, rid);
+		}
+		std::cout << "random lookup:            " << elapsedNs(start) / numLookups / 1000 << " us, "
+			<< bufMgr.getBufStats().diskreads << " disk reads" << std::endl;
+
+		start = Clock::now();
+		int low = 0;
+		int high = relationSize;
+		index.startScan(&low, GTE, &high, LT);
+		try
+		{
+			RecordId rid;
+			while (true)
+				index.scanNext(rid);
+		}
+		catch (IndexScanCompletedException& e)
+		{
+		}
+		index.endScan();
+		std::cout << "full scan:                " << elapsedNs(start) / 1000000 << " ms" << std::endl;
+	}
+	removeFile(indexName);
+}
+
+// Allocating and writing back new blob pages through a small pool, as an index
+// build does. Allocation only reserves page numbers, so every page is written
+// once, when it is evicted.
+void benchFileExtension()
+{
+	const std::string fileName = "relBench.extend";
+	const int numPages = 20000;
+
+	removeFile(fileName);
+	{
+		BufMgr bufMgr(100);
+		BlobFile file(fileName, true);
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			PageHandle page = bufMgr.allocPage(&file, pageNo);
+			*reinterpret_cast<int*>(page.page()) = i;
+			page.markDirty();
+		}
+		bufMgr.flushFile(&file);
+		std::cout << "allocate and write back:  " << elapsedNs(start) / numPages / 1000 << " us per page, "
+			<< bufMgr.getBufStats().diskwrites << " page writes" << std::endl;
+	}
+	removeFile(fileName);
+}
+
+// Full scans of an index in a mapped file, through a fresh pool, before and
+// after the file is laid out in key order by defragment().
+void benchDefragment()
+{
+	std::string indexName;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		BufMgr bufMgr(100);
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER, MAPPED_FILE);
+		Clock::time_point start = Clock::now();
+		if (pass == 1)
+		{
+			index.defragment();
+			std::cout << "defragment:               " << elapsedNs(start) / 1000000 << " ms" << std::endl;
+		}
+
+		start = Clock::now();
+		int low = 0;
+		int high = relationSize;
+		index.startScan(&low, GTE, &high, LT);
+		try
+		{
+			RecordId rid;
+			while (true)
+				index.scanNext(rid);
+		}
+		catch (IndexScanCompletedException& e)
+		{
+		}
+		index.endScan();
+		std::cout << (pass ? "scan, key order layout:   " : "scan, insertion layout:   ")
+			<< elapsedNs(start) / 1000000 << " ms" << std::endl;
+	}
+	removeFile(indexName);
+}
+
+void benchShadow()
+{
+	std::string indexName;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		{
+			BufMgr bufMgr(100);
+			Clock::time_point start = Clock::now();
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER,
+				pass ? SHADOW_FILE : MAPPED_FILE);
+			std::cout << (pass ? "build, shadow file:       " : "build, mapped file:       ")
+				<< elapsedNs(start) / 1000000 << " ms" << std::endl;
+
+			start = Clock::now();
+			index.checkpoint();
+			std::cout << (pass ? "checkpoint, shadow file:  " : "checkpoint, mapped file:  ")
+				<< elapsedNs(start) / 1000 << " us" << std::endl;
+
+			if (pass == 1)
+			{
+				start = Clock::now();
+				BTreeIndex* snapshot = index.snapshot();
+				std::cout << "snapshot:                 " << elapsedNs(start) / 1000 << " us" << std::endl;
+
+				// Scan the snapshot while entries are inserted into the index
+				RecordId rid = {};
+				int key = relationSize;
+				int low = 0;
+				int high = relationSize;
+				int found = 0;
+				start = Clock::now();
+				snapshot->startScan(&low, GTE, &high, LT);
+				try
+				{
+					while (true)
+					{
+						snapshot->scanNext(rid);
+						if (++found % 10 == 0)
+						{
+							index.insertEntry(&key, rid);
+							key++;
+						}
+					}
+				}
+				catch (IndexScanCompletedException& e)
+				{
+				}
+				snapshot->endScan();
+				std::cout << "snapshot scan + inserts:  " << elapsedNs(start) / 1000000 << " ms ("
+					<< found << " entries seen, " << key - relationSize << " inserted)" << std::endl;
+				delete snapshot;
+			}
+		}
+		removeFile(indexName);
+	}
+}
+
+// Random inserts with an index several times larger than the buffer pool: every
+// B+Tree insert descends to a leaf that is likely not cached, while the B-epsilon
+// tree buffers inserts in its non-leaf nodes and writes leaves in batches.
+void benchBEpsilonTree()
+{
+	std::string indexName;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		BufMgr bufMgr(50);
+		Clock::time_point start = Clock::now();
+		double buildNs;
+		{
+			if (pass == 0)
+			{
+				BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+				buildNs = elapsedNs(start);
+			}
+			else
+			{
+				BEpsilonTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+				buildNs = elapsedNs(start);
+				std::cout << "b-epsilon flushes:        " << index.flushCount() << std::endl;
+			}
+		}
+		std::cout << (pass ? "b-epsilon tree build:     " : "b+tree build:             ")
+			<< buildNs / 1000000 << " ms, " << buildNs / relationSize / 1000 << " us per insert, "
+			<< bufMgr.getBufStats().diskreads << " disk reads, "
+			<< bufMgr.getBufStats().diskwrites << " disk writes" << std::endl;
+		removeFile(indexName);
+	}
+}
+
+// One lookup of an existing key and, every fourth operation, one insert of a new
+// key per operation, from several threads at once: the B+Tree is guarded by a
+// mutex, as its buffer manager is not threadsafe, while the Bw-tree installs its
+// delta records with compare-and-swap and never blocks.
+template <class Index>
+double runContention(Index& index, std::mutex* latch, const int threads, const int firstKey)
+{
+	const int opsPerThread = 100000;
+	std::vector<std::thread> workers;
+	Clock::time_point start = Clock::now();
+	for (int t = 0; t < threads; t++)
+	{
+		workers.push_back(std::thread([&index, latch, threads, firstKey, t, opsPerThread]() {
+			unsigned seed = t + 1;
+			for (int i = 0; i < opsPerThread; i++)
+			{
+				seed = seed * 1103515245 + 12345;
+				int key = (seed >> 8) % relationSize;
+				RecordId rid;
+				if (latch)
+				{
+					std::lock_guard<std::mutex> guard(*latch);
+					index.lookup(&key, rid);
+				}
+				else
+				{
+					index.lookup(&key, rid);
+				}
+				if (i % 4 == 0)
+				{
+					int newKey = firstKey + (i / 4) * threads + t;
+					if (latch)
+					{
+						std::lock_guard<std::mutex> guard(*latch);
+						index.insertEntry(&newKey, rid);
+					}
+					else
+					{
+						index.insertEntry(&newKey, rid);
+					}
+				}
+			}
+		}));
+	}
+	for (std::thread& worker : workers)
+		worker.join();
+	return elapsedNs(start);
+}
+
+void benchBwTree()
+{
+	const int threadCounts[] = {1, 2, 4, 8};
+	std::string indexName;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		BufMgr bufMgr(2000);
+		std::mutex latch;
+		BTreeIndex* btree = NULL;
+		BwTreeIndex* bwtree = NULL;
+		if (pass == 0)
+			btree = new BTreeIndex(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+		else
+			bwtree = new BwTreeIndex(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+
+		int firstKey = relationSize;
+		for (int threads : threadCounts)
+		{
+			const double ns = pass == 0 ? runContention(*btree, &latch, threads, firstKey)
+			                            : runContention(*bwtree, NULL, threads, firstKey);
+			const double ops = threads * 100000.0 * 1.25;
+			std::cout << (pass ? "bw-tree, " : "b+tree with mutex, ") << threads
+				<< (threads == 1 ? " thread:  " : " threads: ") << ops / ns * 1000 << " M ops/s" << std::endl;
+			firstKey += threads * 100000 / 4;
+		}
+		if (pass == 1)
+			std::cout << "bw-tree consolidations:   " << bwtree->consolidationCount()
+				<< ", splits: " << bwtree->splitCount() << std::endl;
+		delete btree;
+		delete bwtree;
+		removeFile(indexName);
+	}
+	std::cout << "hardware threads:         " << std::thread::hardware_concurrency() << std::endl;
+}
+
+// Random equality probes with a buffer pool much smaller than the index: a
+// B+Tree probe descends through the non-leaf levels to a leaf, a hash index
+// probe reads one bucket page through its in-memory directory.
+template <class Index>
+void runProbes(const char* label, const int poolSize)
+{
+	const int numProbes = 100000;
+	std::string indexName;
+	BufMgr bufMgr(poolSize);
+	{
+		Index index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+		bufMgr.clearBufStats();
+		Clock::time_point start = Clock::now();
+		for (int n = 0; n < numProbes; n++)
+		{
+			int key = random() % relationSize;
+			RecordId rid;
+			index.lookup(&key, rid);
+		}
+		const double ns = elapsedNs(start);
+		std::cout << label << ns / numProbes / 1000 << " us per probe, "
+			<< (double) bufMgr.getBufStats().diskreads / numProbes << " disk reads per probe" << std::endl;
+	}
+	removeFile(indexName);
+}
+
+void benchHashIndex()
+{
+	runProbes<BTreeIndex>("b+tree, 50 frames:        ", 50);
+	runProbes<HashIndex>("hash index, 50 frames:    ", 50);
+	runProbes<BTreeIndex>("b+tree, 1000 frames:      ", 1000);
+	runProbes<HashIndex>("hash index, 1000 frames:  ", 1000);
+}
+
+// Lookups of missing keys, as for a duplicate check before an insert: without
+// a filter each descends to a leaf, with the Bloom filter all but about 1% are
+// answered without a buffer pool access. Lookups of existing keys pay for the
+// filter probe on top of the descent. The relation holds the even keys, so the
+// missing odd keys are spread over all leaves.
+void benchBloomFilter()
+{
+	const int numProbes = 100000;
+	const std::string evenName = relationName + "Even";
+	{
+		removeFile(evenName);
+		PageFile file(evenName, true);
+		FileAppender appender(&file);
+		RECORD record;
+		memset(&record, ' ', sizeof(record));
+		for (int i = 0; i < relationSize; i++)
+		{
+			record.i = 2 * (int) (((std::uint64_t) i * 7919) % relationSize);
+			record.d = record.i;
+			sprintf(record.s, "%05d string record", record.i);
+			appender.appendRecord(std::string(reinterpret_cast<char*>(&record), sizeof(record)));
+		}
+		appender.finish();
+	}
+
+	std::string indexName;
+	for (int pass = 0; pass < 2; pass++)
+	{
+		BufMgr bufMgr(50);
+		{
+			BTreeIndex index(evenName, indexName, &bufMgr, offsetof(tuple, i), INTEGER, PLAIN_FILE, pass == 1);
+			const char* label = pass ? "with bloom filter" : "without filter";
+
+			bufMgr.clearBufStats();
+			Clock::time_point start = Clock::now();
+			for (int n = 0; n < numProbes; n++)
+			{
+				int key = 2 * (random() % relationSize) + 1;
+				RecordId rid;
+				try
+				{
+					index.lookup(&key, rid);
+				}
+				catch (NoSuchKeyFoundException& e)
+				{
+				}
+			}
+			std::cout << "missing keys, " << label << ": " << elapsedNs(start) / numProbes / 1000 << " us, "
+				<< (double) bufMgr.getBufStats().diskreads / numProbes << " disk reads per probe" << std::endl;
+
+			start = Clock::now();
+			for (int n = 0; n < numProbes; n++)
+			{
+				int key = 2 * (random() % relationSize);
+				RecordId rid;
+				index.lookup(&key, rid);
+			}
+			std::cout << "present keys, " << label << ": " << elapsedNs(start) / numProbes / 1000 << " us" << std::endl;
+		}
+		removeFile(indexName);
+	}
+	removeFile(evenName);
+}
+
+// Random lookups through the descent and through a trained model, which reads
+// just the predicted leaf. The benchmark relation has dense keys, so a single
+// segment fits them; the model is trained with its default error bound.
+void benchLearnedModel()
+{
+	const int numProbes = 100000;
+	std::string indexName;
+	const int poolSizes[] = {50, 1000};
+	for (int poolSize : poolSizes)
+	{
+		BufMgr bufMgr(poolSize);
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+			for (int pass = 0; pass < 2; pass++)
+			{
+				if (pass == 1)
+				{
+					Clock::time_point start = Clock::now();
+					index.trainLearnedModel();
+					std::cout << "training, " << poolSize << " frames: " << elapsedNs(start) / 1000000 << " ms, "
+						<< index.learnedSegmentCount() << " segments" << std::endl;
+				}
+				bufMgr.clearBufStats();
+				Clock::time_point start = Clock::now();
+				for (int n = 0; n < numProbes; n++)
+				{
+					int key = random() % relationSize;
+					RecordId rid;
+					index.lookup(&key, rid);
+				}
+				std::cout << (pass ? "learned lookup, " : "descent, ") << poolSize << " frames: "
+					<< elapsedNs(start) / numProbes / 1000 << " us, "
+					<< (double) bufMgr.getBufStats().diskreads / numProbes << " disk reads per lookup" << std::endl;
+			}
+		}
+		removeFile(indexName);
+	}
+}
+
+// Full range scan through the scan interface of an index.
+template <class Index>
+void runFullScan(const char* label, Index& index)
+{
+	Clock::time_point start = Clock::now();
+	int low = 0, high = relationSize;
+	index.startScan(&low, GTE, &high, LT);
+	RecordId rid;
+	int count = 0;
+	try
+	{
+		while (true)
+		{
+			index.scanNext(rid);
+			count++;
+		}
+	}
+	catch (IndexScanCompletedException& e)
+	{
+	}
+	index.endScan();
+	std::cout << label << elapsedNs(start) / count << " ns per entry" << std::endl;
+}
+
+// Random probes and a full scan of the adaptive radix tree, which never goes
+// through the buffer pool, against a B+Tree whose pages all fit into it, and
+// the time to write the tree to its index file and to load it back.
+void benchArt()
+{
+	runProbes<BTreeIndex>("b+tree probe, 1000 frames: ", 1000);
+	runProbes<ArtIndex>("art probe:                 ", 1000);
+
+	std::string indexName;
+	BufMgr bufMgr(1000);
+	{
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+		runFullScan("b+tree scan, 1000 frames:  ", index);
+	}
+	removeFile(indexName);
+	{
+		Clock::time_point start = Clock::now();
+		ArtIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+		std::cout << "art build from relation:   " << elapsedNs(start) / 1000000 << " ms" << std::endl;
+		runFullScan("art scan:                  ", index);
+
+		start = Clock::now();
+		index.checkpoint();
+		std::cout << "art checkpoint:            " << elapsedNs(start) / 1000000 << " ms" << std::endl;
+	}
+	{
+		Clock::time_point start = Clock::now();
+		ArtIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+		std::cout << "art reload from file:      " << elapsedNs(start) / 1000000 << " ms, "
+			<< index.entryCount() << " entries" << std::endl;
+	}
+	removeFile(indexName);
+}
+
+// Random lookups with the non-leaf nodes searched through their directory and
+// by reading their keys in order, with every page in the buffer pool. Either
+// way a lookup searches a non-leaf node of several hundred keys: the directory
+// skips them in blocks of 16, reading one cache line per block, where the
+// in-order search compares each key before the one it looks for.
+void benchNodeLayout()
+{
+	const int numProbes = 200000;
+	std::string indexName;
+	BufMgr bufMgr(10000);
+	{
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER);
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		const int sizes[] = {relationSize, 10 * relationSize};
+		for (int size : sizes)
+		{
+			if (size > relationSize)
+			{
+				Clock::time_point start = Clock::now();
+				for (key = relationSize; key < size; key++)
+					index.insertEntry(&key, rid);
+				std::cout << "inserts up to " << size << " keys: " << elapsedNs(start) / (size - relationSize) << " ns per insert" << std::endl;
+			}
+
+			for (int pass = 0; pass < 2; pass++)
+			{
+				index.setDirectorySearch(pass == 0);
+				Clock::time_point start = Clock::now();
+				for (int n = 0; n < numProbes; n++)
+				{
+					key = random() % size;
+					index.lookup(&key, rid);
+				}
+				std::cout << (pass ? "in-order search, " : "directory search, ") << size << " keys: "
+					<< elapsedNs(start) / numProbes << " ns per lookup" << std::endl;
+			}
+			index.setDirectorySearch(true);
+		}
+	}
+	removeFile(indexName);
+}
+
+// Range counts from the subtree counts, which read two root to leaf paths,
+// against counting the entries with a scan, and the cost of keeping the
+// counts: every insert updates the non-leaf nodes on its path.
+void benchSubtreeCounts()
+{
+	const int numCounts = 1000;
+	std::string indexName;
+	BufMgr bufMgr(1000);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		{
+			Clock::time_point start = Clock::now();
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER, PLAIN_FILE, false, pass == 1);
+			std::cout << (pass ? "build with counts:        " : "build without counts:     ")
+				<< elapsedNs(start) / relationSize << " ns per insert" << std::endl;
+			if (pass == 1)
+			{
+				const int widths[] = {100, relationSize / 2};
+				for (int width : widths)
+				{
+					start = Clock::now();
+					for (int n = 0; n < numCounts; n++)
+					{
+						int low = random() % (relationSize - width);
+						int high = low + width;
+						index.countRange(&low, GTE, &high, LT);
+					}
+					const double byCounts = elapsedNs(start) / numCounts;
+
+					start = Clock::now();
+					for (int n = 0; n < numCounts / 10; n++)
+					{
+						int low = random() % (relationSize - width);
+						int high = low + width;
+						index.startScan(&low, GTE, &high, LT);
+						RecordId rid;
+						try
+						{
+							while (true)
+							{
+								index.scanNext(rid);
+							}
+						}
+						catch (IndexScanCompletedException& e)
+						{
+						}
+						index.endScan();
+					}
+					const double byScan = elapsedNs(start) / (numCounts / 10);
+					std::cout << "count of " << width << " keys: " << byCounts / 1000 << " us from counts, "
+						<< byScan / 1000 << " us by scan" << std::endl;
+				}
+			}
+		}
+		removeFile(indexName);
+	}
+}
+
+// Samples of a range against a full scan of it: the time to draw them, by
+// random descents with rejection and from subtree counts, and how well they
+// estimate the mean key and the share of the range in each tenth of it, which
+// the scan finds exactly. The whole index is sampled by descents, a range of
+// a few keys from the entries of its leaves.
+void benchSampling()
+{
+	const int numSamples = 1000;
+	// The whole relation, a range of a little over SAMPLE_SCAN_LEAVES leaves and one within a leaf
+	const int ranges[][2] = {{0, relationSize}, {relationSize / 4, relationSize / 4 + 5000},
+		{relationSize / 2, relationSize / 2 + 20}};
+	std::string indexName;
+	BufMgr bufMgr(1000);
+	for (int pass = 0; pass < 2; pass++)
+	{
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(tuple, i), INTEGER, PLAIN_FILE, false, pass == 1);
+
+			for (const auto& range : ranges)
+			{
+				const int low = range[0], high = range[1];
+
+				// The relation holds every key once, so the range has an even spread a scan would find
+				Clock::time_point start = Clock::now();
+				int scanCount = 0;
+				index.startScan(&low, GTE, &high, LT);
+				RecordId rid;
+				try
+				{
+					while (true)
+					{
+						index.scanNext(rid);
+						scanCount++;
+					}
+				}
+				catch (IndexScanCompletedException& e)
+				{
+				}
+				index.endScan();
+				const double scanUs = elapsedNs(start) / 1000;
+
+				start = Clock::now();
+				std::vector<RIDKeyPair<int>> samples;
+				index.sample(&low, GTE, &high, LT, numSamples, samples);
+				const double sampleUs = elapsedNs(start) / 1000;
+
+				double sum = 0;
+				int tenths[10] = {};
+				for (const RIDKeyPair<int>& sample : samples)
+				{
+					sum += sample.key;
+					tenths[(std::int64_t) (sample.key - low) * 10 / (high - low)]++;
+				}
+				double worstTenth = 0;
+				for (int tenth : tenths)
+					worstTenth = std::max(worstTenth, std::abs((double) tenth / numSamples - 0.1));
+
+				if (pass == 0)
+					std::cout << "full scan of " << scanCount << " entries: " << scanUs << " us" << std::endl;
+				std::cout << (pass ? "sample from counts:       " : "sample without counts:    ")
+					<< numSamples << " entries in " << sampleUs << " us, mean key off by "
+					<< std::abs(sum / numSamples - (low + high - 1) / 2.0) / (high - low) * 100 << "% of the range, "
+					<< "worst tenth off by " << worstTenth * 100 << " points" << std::endl;
+			}
+		}
+		removeFile(indexName);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	createRelation();
+
+	if (argc > 1 && std::string(argv[1]) == "page-size")
+	{
+		benchPageSize();
+		removeFile(relationName);
+		return 0;
+	}
+
+	std::cout << "--- PageHandle ---" << std::endl;
+	benchPageHandle();
+	benchDescent();
+
+	std::cout << "--- Pointer swizzling ---" << std::endl;
+	benchSwizzling();
+
+	std::cout << "--- Resident levels ---" << std::endl;
+	benchResidentLevels();
+
+	std::cout << "--- Buffer pool warm-up ---" << std::endl;
+	benchWarmup();
+
+	std::cout << "--- Buffer pool resizing ---" << std::endl;
+	benchResize();
+
+	std::cout << "--- Page tier ---" << std::endl;
+	benchPageTier();
+
+	std::cout << "--- Compressed memory tier ---" << std::endl;
+	benchCompressedTier();
+
+	std::cout << "--- Compressed index file ---" << std::endl;
+	benchCompressedFile();
+
+	std::cout << "--- Page mapping ---" << std::endl;
+	benchDefragment();
+
+	std::cout << "--- Shadow paging ---" << std::endl;
+	benchShadow();
+
+	std::cout << "--- B-epsilon tree ---" << std::endl;
+	benchBEpsilonTree();
+
+	std::cout << "--- Bw-tree ---" << std::endl;
+	benchBwTree();
+
+	std::cout << "--- Hash index ---" << std::endl;
+	benchHashIndex();
+
+	std::cout << "--- Bloom filter ---" << std::endl;
+	benchBloomFilter();
+
+	std::cout << "--- Learned model ---" << std::endl;
+	benchLearnedModel();
+
+	std::cout << "--- ART ---" << std::endl;
+	benchArt();
+
+	std::cout << "--- Inner node layout ---" << std::endl;
+	benchNodeLayout();
+
+	std::cout << "--- Subtree counts ---" << std::endl;
+	benchSubtreeCounts();
+
+	std::cout << "--- Sampling ---" << std::endl;
+	benchSampling();
+
+	std::cout << "--- File extension ---" << std::endl;
+	benchFileExtension();
+
+	std::cout << "--- Page size ---" << std::endl;
+	benchPageSize();
+
+	removeFile(relationName);
+	return 0;
+}
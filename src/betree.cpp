@@ -0,0 +1,519 @@
+/**
+ * This file contains the implementation of the B-epsilon tree index interface as defined in betree.h
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <climits>
+#include "betree.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_exists_exception.h"
+
+namespace badgerdb
+{
+
+    namespace
+    {
+        bool messageKeyLess(const BufferedMessage& message, const std::int64_t key) {
+            return message.key < key;
+        }
+
+        // Merges newer messages into a sorted buffer, after the older ones with the same key
+        void mergeMessages(std::vector<BufferedMessage>& messages, const std::vector<BufferedMessage>& newer) {
+            std::vector<BufferedMessage> merged;
+            merged.reserve(messages.size() + newer.size());
+            std::size_t i = 0, j = 0;
+            while (i < messages.size() || j < newer.size()) {
+                if (j == newer.size() || (i < messages.size() && messages[i].key <= newer[j].key))
+                    merged.push_back(messages[i++]);
+                else
+                    merged.push_back(newer[j++]);
+            }
+            messages.swap(merged);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::BEpsilonTreeIndex -- Constructor
+    // -----------------------------------------------------------------------------
+    BEpsilonTreeIndex::BEpsilonTreeIndex(
+            const std::string & relationName,
+            std::string & outIndexName,
+            BufMgr *bufMgrIn,
+            const int attrByteOffset,
+            const Datatype attrType) {
+
+        // Create index file name
+        std::ostringstream idxStr;
+        idxStr << relationName << '.' << attrByteOffset;
+        outIndexName = idxStr.str();
+
+        bufMgr = bufMgrIn;
+        flushes = 0;
+        scanExecuting = false;
+
+        try {
+            file = new BlobFile(outIndexName, true);
+
+            // Allocate the meta page, the root and a first, empty leaf below it
+            PageId leafPageNum;
+            PageHandle headerPage = bufMgr->allocPage(file, headerPageNum);
+            PageHandle rootPage = bufMgr->allocPage(file, rootPageNum);
+            PageHandle leafPage = bufMgr->allocPage(file, leafPageNum);
+
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            strcpy(metadata->relationName, relationName.c_str());
+            metadata->attrByteOffset = attrByteOffset;
+            metadata->attrType = attrType;
+            metadata->rootPageNo = rootPageNum;
+            metadata->indexKind = BEPSILON_INDEX;
+            headerPage.markDirty();
+
+            auto root = (BufferedNonLeafNodeInt*) rootPage.page();
+            root->level = 1;
+            root->numKeys = 0;
+            root->numMessages = 0;
+            root->pageNoArray[0] = leafPageNum;
+            rootPage.markDirty();
+
+            auto leaf = (BufferedLeafNodeInt*) leafPage.page();
+            leaf->numEntries = 0;
+            leaf->rightSibPageNo = Page::INVALID_NUMBER;
+            leafPage.markDirty();
+
+            headerPage.release();
+            rootPage.release();
+            leafPage.release();
+
+            // Scan relation and insert entries for all tuples into index
+            try {
+                FileScan fileScan(relationName, bufMgr);
+                RecordId rid = {};
+                while (true) {
+                    fileScan.scanNext(rid);
+                    insertEntry((int*) fileScan.getRecord().c_str() + attrByteOffset, rid);
+                }
+            } catch (EndOfFileException& e) {
+                // Do nothing. Finished scanning file.
+            }
+        } catch (FileExistsException& e) {
+            file = new BlobFile(outIndexName, false);
+            headerPageNum = file->getFirstPageNo();
+
+            PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            if (strcmp(metadata->relationName, relationName.c_str()) != 0
+                || metadata->attrByteOffset != attrByteOffset
+                || metadata->attrType != attrType
+                || metadata->indexKind != BEPSILON_INDEX) {
+                headerPage.release();
+                bufMgr->flushFile(file);
+                delete file;
+                throw BadIndexInfoException("Error: Existing index metadata does not match parameters passed.");
+            }
+            rootPageNum = metadata->rootPageNo;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::~BEpsilonTreeIndex -- destructor
+    // -----------------------------------------------------------------------------
+    BEpsilonTreeIndex::~BEpsilonTreeIndex() {
+        scanExecuting = false;
+        currentPage.release();
+        bufMgr->flushFile(file);
+        delete file;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::insertEntry
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::insertEntry(const void *key, const RecordId rid) {
+        if (key == nullptr)
+            return;
+
+        const BufferedMessage message = {*((int*) key), rid};
+        {
+            // Most inserts only touch the buffer of the root
+            PageHandle rootPage = bufMgr->readPage(file, rootPageNum);
+            auto root = (BufferedNonLeafNodeInt*) rootPage.page();
+            BufferedMessage* end = root->messages + root->numMessages;
+            BufferedMessage* pos = std::lower_bound(root->messages, end, (std::int64_t) message.key + 1, messageKeyLess);
+            rootPage.markDirty();
+            std::copy_backward(pos, end, end + 1);
+            *pos = message;
+            if (++root->numMessages < BEPSILON_BUFFER_SIZE)
+                return;
+        }
+
+        // The root buffer is full, so flush it until it has room again
+        NodeImage root;
+        readNode(rootPageNum, root);
+        std::vector<PageKeyPair<int> > siblings;
+        while (root.messages.size() >= (std::size_t) BEPSILON_BUFFER_SIZE)
+            flushChild(root, -1, false, INT_MIN, INT_MAX);
+        writeNode(rootPageNum, root, siblings);
+        growRoot(siblings);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::lookup
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::lookup(const void *key, RecordId& outRid) {
+        const int intKey = *((int*) key);
+
+        PageHandle page = bufMgr->readPage(file, rootPageNum);
+        while (true) {
+            auto node = (const BufferedNonLeafNodeInt*) page.page();
+
+            // A buffered message is newer than anything below it
+            const BufferedMessage* end = node->messages + node->numMessages;
+            const BufferedMessage* pos = std::lower_bound(node->messages, end, (std::int64_t) intKey, messageKeyLess);
+            if (pos != end && pos->key == intKey) {
+                outRid = pos->rid;
+                return;
+            }
+
+            const int idx = std::upper_bound(node->keyArray, node->keyArray + node->numKeys, intKey) - node->keyArray;
+            const bool leafLevel = node->level == 1;
+            page = bufMgr->readPage(file, node->pageNoArray[idx]);
+            if (leafLevel)
+                break;
+        }
+
+        auto leaf = (const BufferedLeafNodeInt*) page.page();
+        const int* end = leaf->keyArray + leaf->numEntries;
+        const int* pos = std::lower_bound(leaf->keyArray, end, intKey);
+        if (pos == end || *pos != intKey)
+            throw NoSuchKeyFoundException();
+        outRid = leaf->ridArray[pos - leaf->keyArray];
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::readNode
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::readNode(const PageId pageNo, NodeImage& node) {
+        PageHandle page = bufMgr->readPage(file, pageNo);
+        auto stored = (const BufferedNonLeafNodeInt*) page.page();
+        node.level = stored->level;
+        node.keys.assign(stored->keyArray, stored->keyArray + stored->numKeys);
+        node.children.assign(stored->pageNoArray, stored->pageNoArray + stored->numKeys + 1);
+        node.messages.assign(stored->messages, stored->messages + stored->numMessages);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::writeNode
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::writeNode(const PageId pageNo, const NodeImage& node,
+                                      std::vector<PageKeyPair<int> >& siblings) {
+        // Split the children evenly over as few nodes as hold them; the key between two
+        // nodes moves up to the parent
+        const int numChildren = node.children.size();
+        const int parts = (numChildren + BEPSILON_PIVOTS) / (BEPSILON_PIVOTS + 1);
+        std::size_t message = 0;
+        for (int part = 0; part < parts; part++) {
+            const int first = part * numChildren / parts;
+            const int last = (part + 1) * numChildren / parts;
+
+            PageId partPageNo = pageNo;
+            PageHandle page = part == 0 ? bufMgr->readPage(file, pageNo) : bufMgr->allocPage(file, partPageNo);
+            auto stored = (BufferedNonLeafNodeInt*) page.page();
+            stored->level = node.level;
+            stored->numKeys = last - first - 1;
+            std::copy(node.keys.begin() + first, node.keys.begin() + last - 1, stored->keyArray);
+            std::copy(node.children.begin() + first, node.children.begin() + last, stored->pageNoArray);
+
+            const std::size_t end = last == numChildren ? node.messages.size()
+                : std::lower_bound(node.messages.begin(), node.messages.end(),
+                                   (std::int64_t) node.keys[last - 1], messageKeyLess) - node.messages.begin();
+            stored->numMessages = end - message;
+            std::copy(node.messages.begin() + message, node.messages.begin() + end, stored->messages);
+            message = end;
+            page.markDirty();
+
+            if (part > 0) {
+                PageKeyPair<int> sibling;
+                sibling.set(partPageNo, node.keys[first - 1]);
+                siblings.push_back(sibling);
+            }
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::applyToLeaf
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::applyToLeaf(const PageId pageNo, const std::vector<BufferedMessage>& messages,
+                                        std::vector<PageKeyPair<int> >& siblings) {
+        PageHandle page = bufMgr->readPage(file, pageNo);
+        auto leaf = (BufferedLeafNodeInt*) page.page();
+        std::vector<BufferedMessage> entries(leaf->numEntries);
+        for (int i = 0; i < leaf->numEntries; i++) {
+            entries[i].key = leaf->keyArray[i];
+            entries[i].rid = leaf->ridArray[i];
+        }
+        mergeMessages(entries, messages);
+
+        // Spread the entries evenly over as few leaves as hold them
+        const int numEntries = entries.size();
+        const int parts = (numEntries + BEPSILON_LEAF_SIZE - 1) / BEPSILON_LEAF_SIZE;
+        PageId rightSibPageNo = leaf->rightSibPageNo;
+        std::vector<PageHandle> pages;
+        std::vector<PageId> pageNos(1, pageNo);
+        pages.push_back(std::move(page));
+        for (int part = 1; part < parts; part++) {
+            PageId partPageNo;
+            pages.push_back(bufMgr->allocPage(file, partPageNo));
+            pageNos.push_back(partPageNo);
+        }
+
+        for (int part = 0; part < (int) pages.size(); part++) {
+            const int first = part * numEntries / (int) pages.size();
+            const int last = (part + 1) * numEntries / (int) pages.size();
+            auto partLeaf = (BufferedLeafNodeInt*) pages[part].page();
+            partLeaf->numEntries = last - first;
+            for (int i = first; i < last; i++) {
+                partLeaf->keyArray[i - first] = entries[i].key;
+                partLeaf->ridArray[i - first] = entries[i].rid;
+            }
+            partLeaf->rightSibPageNo = part + 1 < (int) pages.size() ? pageNos[part + 1] : rightSibPageNo;
+            pages[part].markDirty();
+
+            if (part > 0) {
+                PageKeyPair<int> sibling;
+                sibling.set(pageNos[part], entries[first].key);
+                siblings.push_back(sibling);
+            }
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::applyToNode
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::applyToNode(const PageId pageNo, const std::vector<BufferedMessage>& messages,
+                                        std::vector<PageKeyPair<int> >& siblings) {
+        NodeImage node;
+        readNode(pageNo, node);
+        mergeMessages(node.messages, messages);
+        while (node.messages.size() >= (std::size_t) BEPSILON_BUFFER_SIZE)
+            flushChild(node, -1, false, INT_MIN, INT_MAX);
+        writeNode(pageNo, node, siblings);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::flushChild
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::flushChild(NodeImage& node, int idx, const bool toLeaves,
+                                       const std::int64_t low, const std::int64_t high) {
+        if (idx < 0) {
+            // Pick the child with the most messages, so every flush moves a large batch
+            int count = 0, best = 0;
+            std::size_t child = 0;
+            for (std::size_t i = 0; i < node.messages.size(); i++) {
+                while (child < node.keys.size() && node.messages[i].key >= node.keys[child]) {
+                    child++;
+                    count = 0;
+                }
+                if (++count > best) {
+                    best = count;
+                    idx = child;
+                }
+            }
+        }
+
+        // Take the messages bound for the child out of the node
+        const std::int64_t from = std::max(low, idx > 0 ? (std::int64_t) node.keys[idx - 1] : (std::int64_t) INT_MIN);
+        const std::int64_t to = std::min(high + 1, idx < (int) node.keys.size() ? (std::int64_t) node.keys[idx] : (std::int64_t) INT_MAX + 1);
+        const auto first = std::lower_bound(node.messages.begin(), node.messages.end(), from, messageKeyLess);
+        const auto last = std::lower_bound(first, node.messages.end(), to, messageKeyLess);
+        const std::vector<BufferedMessage> batch(first, last);
+        node.messages.erase(first, last);
+
+        std::vector<PageKeyPair<int> > siblings;
+        if (node.level == 1) {
+            if (!batch.empty())
+                applyToLeaf(node.children[idx], batch, siblings);
+        } else if (toLeaves) {
+            flushRange(node.children[idx], batch, low, high, siblings);
+        } else {
+            applyToNode(node.children[idx], batch, siblings);
+        }
+        flushes++;
+
+        for (std::size_t i = 0; i < siblings.size(); i++) {
+            node.keys.insert(node.keys.begin() + idx + i, siblings[i].key);
+            node.children.insert(node.children.begin() + idx + i + 1, siblings[i].pageNo);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::flushRange
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::flushRange(const PageId pageNo, const std::vector<BufferedMessage>& messages,
+                                       const int low, const int high, std::vector<PageKeyPair<int> >& siblings) {
+        NodeImage node;
+        readNode(pageNo, node);
+        mergeMessages(node.messages, messages);
+
+        // Right to left, so siblings added to the node do not move the children still to be visited
+        const int first = std::upper_bound(node.keys.begin(), node.keys.end(), low) - node.keys.begin();
+        const int last = std::upper_bound(node.keys.begin(), node.keys.end(), high) - node.keys.begin();
+        for (int idx = last; idx >= first; idx--)
+            flushChild(node, idx, true, low, high);
+        writeNode(pageNo, node, siblings);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::growRoot
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::growRoot(std::vector<PageKeyPair<int> > siblings) {
+        if (siblings.empty())
+            return;
+
+        while (!siblings.empty()) {
+            NodeImage root;
+            {
+                PageHandle oldRoot = bufMgr->readPage(file, rootPageNum);
+                root.level = ((const BufferedNonLeafNodeInt*) oldRoot.page())->level + 1;
+            }
+            root.children.push_back(rootPageNum);
+            for (const PageKeyPair<int>& sibling : siblings) {
+                root.keys.push_back(sibling.key);
+                root.children.push_back(sibling.pageNo);
+            }
+            bufMgr->allocPage(file, rootPageNum).release();
+            siblings.clear();
+            writeNode(rootPageNum, root, siblings);
+        }
+
+        // Record the new root in the meta page so it is found on reopening
+        PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+        ((IndexMetaInfo*) headerPage.page())->rootPageNo = rootPageNum;
+        headerPage.markDirty();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::findLeaf
+    // -----------------------------------------------------------------------------
+    PageHandle BEpsilonTreeIndex::findLeaf(const int key) {
+        PageHandle page = bufMgr->readPage(file, rootPageNum);
+        while (true) {
+            // A leaf split inside a run of equal keys leaves some of them left of the separator
+            auto node = (const BufferedNonLeafNodeInt*) page.page();
+            const int idx = std::lower_bound(node->keyArray, node->keyArray + node->numKeys, key) - node->keyArray;
+            const bool leafLevel = node->level == 1;
+            page = bufMgr->readPage(file, node->pageNoArray[idx]);
+            if (leafLevel)
+                return page;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::startScan
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::startScan(const void* lowValParm,
+                                      const Operator lowOpParm,
+                                      const void* highValParm,
+                                      const Operator highOpParm) {
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+            throw BadOpcodesException();
+        }
+
+        lowValInt = *(int *)lowValParm;
+        highValInt = *(int *)highValParm;
+        if (lowValInt > highValInt)
+            throw BadScanrangeException();
+
+        if (scanExecuting) {
+            endScan();
+        }
+        lowOp = lowOpParm;
+        highOp = highOpParm;
+
+        // The leaves hold every entry in the range once its messages have been moved down
+        std::vector<PageKeyPair<int> > siblings;
+        flushRange(rootPageNum, std::vector<BufferedMessage>(), lowValInt, highValInt, siblings);
+        growRoot(siblings);
+
+        // Leaves right of the first one that may hold firstKey hold no smaller keys
+        const int firstKey = lowOp == GT && lowValInt < INT_MAX ? lowValInt + 1 : lowValInt;
+        currentPage = findLeaf(firstKey);
+        auto leaf = (const BufferedLeafNodeInt*) currentPage.page();
+        nextEntry = std::lower_bound(leaf->keyArray, leaf->keyArray + leaf->numEntries, firstKey) - leaf->keyArray;
+        scanExecuting = true;
+
+        // Make sure the scan finds anything at all
+        RecordId rid;
+        try {
+            scanNext(rid);
+        } catch (IndexScanCompletedException& e) {
+            endScan();
+            throw NoSuchKeyFoundException();
+        }
+        nextEntry--;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::scanNext
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::scanNext(RecordId& outRid) {
+        if (!scanExecuting)
+            throw ScanNotInitializedException();
+
+        auto leaf = (const BufferedLeafNodeInt*) currentPage.page();
+        while (nextEntry >= leaf->numEntries) {
+            const PageId rightSibPageNo = leaf->rightSibPageNo;
+            if (rightSibPageNo == Page::INVALID_NUMBER) {
+                currentPage.release();
+                throw IndexScanCompletedException();
+            }
+            nextEntry = 0;
+            currentPage = bufMgr->readPage(file, rightSibPageNo);
+            leaf = (const BufferedLeafNodeInt*) currentPage.page();
+        }
+
+        const int key = leaf->keyArray[nextEntry];
+        if ((lowOp == GT && key <= lowValInt) || (highOp == LT && key >= highValInt)
+            || (highOp == LTE && key > highValInt))
+            throw IndexScanCompletedException();
+
+        outRid = leaf->ridArray[nextEntry];
+        nextEntry++;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BEpsilonTreeIndex::endScan
+    // -----------------------------------------------------------------------------
+    void BEpsilonTreeIndex::endScan() {
+        if (!scanExecuting)
+            throw ScanNotInitializedException();
+        scanExecuting = false;
+        currentPage.release();
+    }
+
+}
@@ -0,0 +1,360 @@
+/**
+ * This is the header file for a write-optimized B-epsilon tree index over a single INTEGER attribute.
+ * It offers the interface of BTreeIndex, but its non-leaf nodes keep few keys and use the rest of their
+ * page to buffer inserts that have not reached the leaves yet.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of keys in a B-epsilon tree non-leaf node. About a sixteenth of a B+Tree non-leaf node,
+ * the rest of the page buffers messages.
+ */
+    constexpr int BEPSILON_PIVOTS = INTARRAYNONLEAFSIZE / 16;
+
+/**
+ * @brief A pending insert, buffered in a non-leaf node on its way down to a leaf.
+ */
+    struct BufferedMessage {
+        /**
+         * Key to insert.
+         */
+        int key;
+
+        /**
+         * Record ID to insert with the key.
+         */
+        RecordId rid;
+    };
+
+/**
+ * @brief Number of messages buffered in a B-epsilon tree non-leaf node.
+ */
+//                                                            level, key count, message count     keys                                  page numbers
+    constexpr int BEPSILON_BUFFER_SIZE = ( Page::SIZE - 3 * sizeof( int ) - BEPSILON_PIVOTS * sizeof( int ) - ( BEPSILON_PIVOTS + 1 ) * sizeof( PageId ) )
+                                         / sizeof( BufferedMessage );
+
+/**
+ * @brief Number of entries in a B-epsilon tree leaf node.
+ */
+//                                                           entry count      sibling ptr             key               rid
+    constexpr int BEPSILON_LEAF_SIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief Structure for non-leaf nodes of a B-epsilon tree.
+ * Child i holds the keys from keyArray[i-1] up to but excluding keyArray[i], except that a leaf split inside a
+ * run of equal keys leaves some of them in the child left of the separator. Messages are sorted by key, and
+ * messages with the same key in the order they arrived.
+ */
+    struct BufferedNonLeafNodeInt {
+        /**
+         * Height of the node above the leaves; 1 if the children are leaves.
+         */
+        int level;
+
+        /**
+         * Number of keys in use; the node has one child more.
+         */
+        int numKeys;
+
+        /**
+         * Number of buffered messages.
+         */
+        int numMessages;
+
+        /**
+         * Stores keys.
+         */
+        int keyArray[ BEPSILON_PIVOTS ];
+
+        /**
+         * Stores page numbers of the children.
+         */
+        PageId pageNoArray[ BEPSILON_PIVOTS + 1 ];
+
+        /**
+         * Messages not yet flushed to the children.
+         */
+        BufferedMessage messages[ BEPSILON_BUFFER_SIZE ];
+    };
+
+/**
+ * @brief Structure for leaf nodes of a B-epsilon tree. Entries are sorted by key.
+ */
+    struct BufferedLeafNodeInt {
+        /**
+         * Number of entries in use.
+         */
+        int numEntries;
+
+        /**
+         * Stores keys.
+         */
+        int keyArray[ BEPSILON_LEAF_SIZE ];
+
+        /**
+         * Stores RecordIds.
+         */
+        RecordId ridArray[ BEPSILON_LEAF_SIZE ];
+
+        /**
+         * Page number of the leaf on the right side.
+         */
+        PageId rightSibPageNo;
+    };
+
+    static_assert(sizeof(BufferedNonLeafNodeInt) <= Page::SIZE && sizeof(BufferedLeafNodeInt) <= Page::SIZE,
+                  "B-epsilon tree nodes must fit into a page.");
+
+
+/**
+ * @brief BEpsilonTreeIndex class. It implements a B-epsilon tree index on a single INTEGER attribute of a
+ * relation. Inserts are added to the buffer of the root and moved down a level in batches when a buffer
+ * fills, so a random insert costs a fraction of a leaf write instead of a descent and a dirty leaf.
+ * Lookups check the buffers on their way down. This index supports only one scan at a time.
+ */
+    class BEpsilonTreeIndex {
+
+    private:
+
+        /**
+         * Non-leaf node copied out of its page while messages are moved through it.
+         */
+        struct NodeImage {
+            int level;
+            std::vector<int> keys;
+            std::vector<PageId> children;
+            std::vector<BufferedMessage> messages;
+        };
+
+        /**
+         * File object for the index file.
+         */
+        File		*file;
+
+        /**
+         * Buffer Manager Instance.
+         */
+        BufMgr	*bufMgr;
+
+        /**
+         * Page number of meta page.
+         */
+        PageId	headerPageNum;
+
+        /**
+         * Page number of root page of the tree inside index file.
+         */
+        PageId	rootPageNum;
+
+        /**
+         * Number of times a batch of messages was moved down a level.
+         */
+        std::uint64_t	flushes;
+
+
+        // MEMBERS SPECIFIC TO SCANNING
+
+        /**
+         * True if an index scan has been started.
+         */
+        bool		scanExecuting;
+
+        /**
+         * Index of next entry to be scanned in current leaf being scanned.
+         */
+        int			nextEntry;
+
+        /**
+         * Handle of the current page being scanned. The page stays pinned while the scan is on it.
+         */
+        PageHandle	currentPage;
+
+        /**
+         * Low INTEGER value for scan.
+         */
+        int			lowValInt;
+
+        /**
+         * High INTEGER value for scan.
+         */
+        int			highValInt;
+
+        /**
+         * Low Operator. Can only be GT(>) or GTE(>=).
+         */
+        Operator	lowOp;
+
+        /**
+         * High Operator. Can only be LT(<) or LTE(<=).
+         */
+        Operator	highOp;
+
+
+        /**
+         * Copies a non-leaf node out of its page.
+         * @param pageNo	Page of the node
+         * @param node		Set to the node
+         */
+        void readNode(PageId pageNo, NodeImage& node);
+
+        /**
+         * Writes a non-leaf node to its page, splitting it into siblings if it has too many keys.
+         * @param pageNo	Page of the node
+         * @param node		The node
+         * @param siblings	New right siblings are appended to this, each with the smallest key it holds
+         */
+        void writeNode(PageId pageNo, const NodeImage& node, std::vector<PageKeyPair<int> >& siblings);
+
+        /**
+         * Applies messages to a leaf, splitting it into siblings if the entries do not fit.
+         * @param pageNo	Page of the leaf
+         * @param messages	Messages sorted by key
+         * @param siblings	New right siblings are appended to this, each with the smallest key it holds
+         */
+        void applyToLeaf(PageId pageNo, const std::vector<BufferedMessage>& messages,
+                         std::vector<PageKeyPair<int> >& siblings);
+
+        /**
+         * Adds messages to the buffer of a non-leaf node, flushing the buffer until it has room.
+         * @param pageNo	Page of the node
+         * @param messages	Messages sorted by key
+         * @param siblings	New right siblings are appended to this, each with the smallest key it holds
+         */
+        void applyToNode(PageId pageNo, const std::vector<BufferedMessage>& messages,
+                         std::vector<PageKeyPair<int> >& siblings);
+
+        /**
+         * Moves the messages of a node that belong to one child down to the child, and adds any siblings
+         * the child split into to the node.
+         * @param node		The node
+         * @param idx		Index of the child, -1 for the child with the most messages
+         * @param toLeaves	Whether to move the messages on through all levels down to the leaves
+         * @param low		Smallest key to move
+         * @param high		Largest key to move
+         */
+        void flushChild(NodeImage& node, int idx, bool toLeaves, std::int64_t low, std::int64_t high);
+
+        /**
+         * Moves the messages of a node with keys in a range down to the leaves, through all levels below.
+         * @param pageNo	Page of the node
+         * @param messages	Messages sorted by key, all in the range, to add to the node first
+         * @param low		Smallest key of the range
+         * @param high		Largest key of the range
+         * @param siblings	New right siblings are appended to this, each with the smallest key it holds
+         */
+        void flushRange(PageId pageNo, const std::vector<BufferedMessage>& messages, int low, int high,
+                        std::vector<PageKeyPair<int> >& siblings);
+
+        /**
+         * Puts new roots above the root while it has split, and records the root in the meta page.
+         * @param siblings	Siblings the root split into
+         */
+        void growRoot(std::vector<PageKeyPair<int> > siblings);
+
+        /**
+         * Descends from the root to the leftmost leaf that may hold the key, ignoring buffered messages.
+         * @param key		Key to search for
+         * @return Handle of the pinned leaf
+         */
+        PageHandle findLeaf(int key);
+
+    public:
+
+        /**
+         * BEpsilonTreeIndex Constructor.
+         * Check to see if the corresponding index file exists. If so, open the file.
+         * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+         *
+         * @param relationName        Name of file.
+         * @param outIndexName        Return the name of index file.
+         * @param bufMgrIn			  Buffer Manager Instance
+         * @param attrByteOffset	  Offset of attribute, over which index is to be built, in the record
+         * @param attrType			  Datatype of attribute over which index is built
+         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters, or the file holds another kind of index.
+         */
+        BEpsilonTreeIndex(const std::string & relationName, std::string & outIndexName,
+                          BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+
+        /**
+         * BEpsilonTreeIndex Destructor.
+         * End any initialized scan, flush index file from the buffer manager and delete file instance thereby
+         * closing the index file. Buffered messages stay in the non-leaf nodes.
+         */
+        ~BEpsilonTreeIndex();
+
+
+        /**
+         * Insert a new entry using the pair <value,rid>.
+         * The entry is buffered in the root. A full buffer moves the largest batch of messages bound for one
+         * child down to it, which may fill the buffer of the child in turn or split leaves.
+         * Entries with the same key are all kept.
+         * @param key			Key to insert, pointer to integer
+         * @param rid			Record ID of a record whose entry is getting inserted into the index.
+         */
+        void insertEntry(const void* key, RecordId rid);
+
+
+        /**
+         * Find the record id of the entry with the given key. Buffers on the way down are checked first, as
+         * they hold entries newer than those below them.
+         * @param key			Key to search for, pointer to integer
+         * @param outRid		RecordId of the entry returned in this
+         * @throws  NoSuchKeyFoundException If there is no entry with the key in the tree.
+         */
+        void lookup(const void* key, RecordId& outRid);
+
+
+        /**
+         * Returns the number of times a batch of messages was moved down a level.
+         */
+        std::uint64_t flushCount() const { return flushes; }
+
+
+        /**
+         * Begin a filtered scan of the index. Messages buffered for keys in the range are moved down to the
+         * leaves first, then the leaves are read in order.
+         * @param lowVal	Low value of range, pointer to integer
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer
+         * @param highOp	High operator (LT/LTE)
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+         * @throws  NoSuchKeyFoundException If there is no key in the tree that satisfies the scan criteria.
+         */
+        void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+        /**
+         * Fetch the record id of the next index entry that matches the scan.
+         * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+         * @throws ScanNotInitializedException If no scan has been initialized.
+         * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+         */
+        void scanNext(RecordId& outRid);
+
+
+        /**
+         * Terminate the current scan. Unpin any pinned pages. Reset scan specific variables.
+         * @throws ScanNotInitializedException If no scan has been initialized.
+         */
+        void endScan();
+
+    };
+
+}
@@ -0,0 +1,114 @@
+/**
+ * This file contains the implementation of the Bloom filter as defined in bloom_filter.h
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstring>
+#include "bloom_filter.h"
+
+namespace badgerdb
+{
+
+    namespace
+    {
+        // Odd multipliers that pick the bit in each word of a block
+        const std::uint32_t SALTS[BLOOM_BLOCK_WORDS] = {
+                0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+                0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+#if defined(__GNUC__)
+        typedef std::uint32_t BlockVector __attribute__((vector_size(BLOOM_BLOCK_WORDS * sizeof(std::uint32_t))));
+#endif
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BloomFilter::BloomFilter -- Constructor
+    // -----------------------------------------------------------------------------
+    BloomFilter::BloomFilter(const std::uint64_t capacity) : capacity(capacity), keys(0) {
+        const std::uint64_t blockBits = BLOOM_BLOCK_WORDS * 32;
+        std::uint64_t blocks = (capacity * BLOOM_BITS_PER_KEY + blockBits - 1) / blockBits;
+        if (blocks == 0)
+            blocks = 1;
+        words.assign(blocks * BLOOM_BLOCK_WORDS, 0);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BloomFilter::hash
+    // -----------------------------------------------------------------------------
+    std::uint64_t BloomFilter::hash(const int key) {
+        // Finalizer of MurmurHash3
+        std::uint64_t h = (std::uint32_t) key;
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BloomFilter::blockOf
+    // -----------------------------------------------------------------------------
+    std::size_t BloomFilter::blockOf(const std::uint64_t h) const {
+        // Maps the high half of the hash onto the blocks without a division
+        const std::uint64_t blocks = words.size() / BLOOM_BLOCK_WORDS;
+        return (std::size_t) (((h >> 32) * blocks) >> 32) * BLOOM_BLOCK_WORDS;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BloomFilter::insert
+    // -----------------------------------------------------------------------------
+    void BloomFilter::insert(const int key) {
+        const std::uint64_t h = hash(key);
+        std::uint32_t* block = &words[blockOf(h)];
+        for (int i = 0; i < BLOOM_BLOCK_WORDS; i++)
+            block[i] |= (std::uint32_t) 1 << (((std::uint32_t) h * SALTS[i]) >> 27);
+        keys++;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BloomFilter::mayContain
+    // -----------------------------------------------------------------------------
+    bool BloomFilter::mayContain(const int key) const {
+        const std::uint64_t h = hash(key);
+        const std::uint32_t* block = &words[blockOf(h)];
+
+#if defined(__GNUC__)
+        // All eight bits are computed and tested at once
+        BlockVector salts, bits, stored;
+        std::memcpy(&salts, SALTS, sizeof(salts));
+        std::memcpy(&stored, block, sizeof(stored));
+        bits = (BlockVector{} + 1) << (((BlockVector{} + (std::uint32_t) h) * salts) >> 27);
+        const BlockVector missing = (stored & bits) ^ bits;
+        std::uint64_t lanes[sizeof(missing) / sizeof(std::uint64_t)];
+        std::memcpy(lanes, &missing, sizeof(lanes));
+        return (lanes[0] | lanes[1] | lanes[2] | lanes[3]) == 0;
+#else
+        for (int i = 0; i < BLOOM_BLOCK_WORDS; i++) {
+            const std::uint32_t bit = (std::uint32_t) 1 << (((std::uint32_t) h * SALTS[i]) >> 27);
+            if ((block[i] & bit) == 0)
+                return false;
+        }
+        return true;
+#endif
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BloomFilter::load
+    // -----------------------------------------------------------------------------
+    void BloomFilter::load(const std::vector<std::uint32_t>& bits, const std::uint64_t count) {
+        words = bits;
+        keys = count;
+    }
+
+}
@@ -0,0 +1,118 @@
+/**
+ * This is the header file for a blocked Bloom filter over INTEGER keys, used by indexes to answer
+ * probes for missing keys without reading any page.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of filter bits per key the filter is sized for. About 1% of the probes for missing
+ * keys pass the filter at this size.
+ */
+    constexpr int BLOOM_BITS_PER_KEY = 10;
+
+/**
+ * @brief Number of 32-bit words in a filter block. A key sets one bit in every word of its block.
+ */
+    constexpr int BLOOM_BLOCK_WORDS = 8;
+
+
+/**
+ * @brief BloomFilter class. It implements a blocked Bloom filter: each key maps to one block of
+ * 256 bits, half a cache line, and sets one bit in each of its eight words. A probe reads a
+ * single block and tests the eight bits at once with vector instructions where the compiler offers
+ * them. The filter has no false negatives; it cannot be resized, so indexes build a larger one from
+ * their entries once it holds as many keys as it was sized for.
+ */
+    class BloomFilter {
+
+    private:
+
+        /**
+         * Filter bits, BLOOM_BLOCK_WORDS words per block.
+         */
+        std::vector<std::uint32_t>	words;
+
+        /**
+         * Number of keys the filter is sized for.
+         */
+        std::uint64_t	capacity;
+
+        /**
+         * Number of keys inserted.
+         */
+        std::uint64_t	keys;
+
+        /**
+         * Hashes a key; the high half selects the block, the low half the bits in it.
+         */
+        static std::uint64_t hash(int key);
+
+        /**
+         * Returns the first word of the block of a hash.
+         */
+        std::size_t blockOf(std::uint64_t h) const;
+
+    public:
+
+        /**
+         * Creates an empty filter.
+         * @param capacity	Number of keys to size the filter for
+         */
+        explicit BloomFilter(std::uint64_t capacity);
+
+        /**
+         * Adds a key to the filter.
+         * @param key		Key to add
+         */
+        void insert(int key);
+
+        /**
+         * Checks whether a key may have been added to the filter.
+         * @param key		Key to look for
+         * @return False only if the key was never added
+         */
+        bool mayContain(int key) const;
+
+        /**
+         * Returns true if the filter holds as many keys as it was sized for.
+         */
+        bool full() const { return keys >= capacity; }
+
+        /**
+         * Returns the number of keys added to the filter.
+         */
+        std::uint64_t keyCount() const { return keys; }
+
+        /**
+         * Returns the number of keys the filter is sized for.
+         */
+        std::uint64_t keyCapacity() const { return capacity; }
+
+        /**
+         * Returns the filter bits, to be written to a file.
+         */
+        const std::vector<std::uint32_t>& data() const { return words; }
+
+        /**
+         * Replaces the filter bits and key count with ones read from a file.
+         * @param bits		Filter bits, as returned by data() of a filter with the same capacity
+         * @param count		Number of keys added to that filter
+         */
+        void load(const std::vector<std::uint32_t>& bits, std::uint64_t count);
+
+    };
+
+}
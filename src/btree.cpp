@@ -12,9 +12,9 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
 #include <climits>
-#include <stack>
-#include <climits>
+#include <vector>
 #include "btree.h"
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
@@ -26,8 +26,6 @@
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/end_of_file_exception.h"
 #include "exceptions/file_exists_exception.h"
-#include "exceptions/page_not_pinned_exception.h"
-#include "exceptions/hash_not_found_exception.h"
 #include "exceptions/page_pinned_exception.h"
 
 
@@ -36,6 +34,16 @@
 namespace badgerdb
 {
 
+    namespace {
+
+        // Nodes of an index without subtree counts read a count of 0 for every child and ignore new counts
+        inline std::uint32_t childCount(const NonLeafNodeInt*, int) { return 0; }
+        inline std::uint32_t childCount(const CountedNonLeafNodeInt* node, const int idx) { return node->countArray[idx]; }
+        inline void setChildCount(NonLeafNodeInt*, int, std::uint32_t) {}
+        inline void setChildCount(CountedNonLeafNodeInt* node, const int idx, const std::uint32_t count) { node->countArray[idx] = count; }
+
+    }
+
     // -----------------------------------------------------------------------------
     // BTreeIndex::BTreeIndex -- Constructor
     // -----------------------------------------------------------------------------
@@ -44,7 +52,10 @@ namespace badgerdb
             std::string & outIndexName,
             BufMgr *bufMgrIn,
             const int attrByteOffset,
-            const Datatype attrType) {
+            const Datatype attrType,
+            const IndexFileFormat format,
+            const bool bloom,
+            const bool counts) {
 
         // Create index file name
         std::ostringstream idxStr;
@@ -57,35 +68,58 @@ namespace badgerdb
         this->attrByteOffset = attrByteOffset;
         leafOccupancy = 0;
         nodeOccupancy = 0;
+        residentLevels = 0;
+        readOnly = false;
+        bloomRejects = 0;
+        learnedLookups = 0;
+        directorySearch = true;
+        subtreeCounts = false;
         scanExecuting = false;
 
         IndexMetaInfo* metadata;
-        Page* headerPage;
-        Page* rootPage;
 
         try {
             // Create file, check if it exists
-            file = new BlobFile(outIndexName, true);
+            if (format == COMPRESSED_FILE) {
+                file = new CompressedBlobFile(outIndexName, true);
+            } else if (format == MAPPED_FILE || format == SHADOW_FILE) {
+                file = new MappedBlobFile(outIndexName, true, format == SHADOW_FILE);
+            } else {
+                file = new BlobFile(outIndexName, true);
+            }
             // File does not exist, so new index file has been created
 
             // Allocate index meta info page and btree root page
-            bufMgr->allocPage(file, headerPageNum, headerPage);
-            bufMgr->allocPage(file, rootPageNum, rootPage);
+            PageHandle headerPage = bufMgr->allocPage(file, headerPageNum);
+            PageHandle rootPage = bufMgr->allocPage(file, rootPageNum);
 
             // Set up index meta info
-            metadata = (IndexMetaInfo*) headerPage;
+            metadata = (IndexMetaInfo*) headerPage.page();
             strcpy(metadata->relationName, relationName.c_str());
             metadata->attrByteOffset = attrByteOffset;
             metadata->attrType = attrType;
             metadata->rootPageNo = rootPageNum;
+            metadata->bloomPageNo = Page::INVALID_NUMBER;
+            metadata->subtreeCounts = counts;
+            metadata->indexKind = BTREE_INDEX;
+            metadata->layoutVersion = BTREE_LAYOUT_VERSION;
+            headerPage.markDirty();
+            subtreeCounts = counts;
 
             // Set up the root of the btree
-            auto root = (NonLeafNodeInt*) rootPage;
-            root->level = 1;
-            for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-                clearNonLeafNodeAtIdx(root, i);
-            }
-            root->pageNoArray[INTARRAYNONLEAFSIZE] = Page::INVALID_NUMBER;
+            if (subtreeCounts)
+                initNonLeafNode((CountedNonLeafNodeInt*) rootPage.page(), 1);
+            else
+                initNonLeafNode((NonLeafNodeInt*) rootPage.page(), 1);
+            rootPage.markDirty();
+
+            // Header page and root page are no longer in use
+            headerPage.release();
+            rootPage.release();
+
+            // The filter grows with the index, starting small
+            if (bloom)
+                bloomFilter.reset(new BloomFilter(1024));
 
             // Scan relation and insert entries for all tuples into index
             try {
@@ -98,54 +132,81 @@ namespace badgerdb
             } catch (EndOfFileException& e) {
                 // Do nothing. Finished scanning file.
             }
-
-            // Unpin header page and root page as they are no longer in use
-            try {
-                bufMgr->unPinPage(file, headerPageNum, true);
-            } catch (PageNotPinnedException& e) {
-                // Do nothing.
-            }
-            try {
-                bufMgr->unPinPage(file, rootPageNum, true);
-            } catch (PageNotPinnedException& e) {
-                // Do nothing.
-            }
         } catch (FileExistsException& e) {  // File exists
             // Open the file
-            file = new BlobFile(outIndexName, false);
+            if (CompressedBlobFile::isCompressed(outIndexName)) {
+                file = new CompressedBlobFile(outIndexName, false);
+            } else if (MappedBlobFile::isMapped(outIndexName)) {
+                file = new MappedBlobFile(outIndexName, false);
+            } else {
+                file = new BlobFile(outIndexName, false);
+            }
 
             // Get the meta page number fom the file
             headerPageNum = file->getFirstPageNo();
 
             // Get index meta info for value checking
-            bufMgr->readPage(file, headerPageNum, headerPage);
-            metadata = (IndexMetaInfo*) headerPage;
+            PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+            metadata = (IndexMetaInfo*) headerPage.page();
 
             // Check that values in (relationName, attribute byte, attribute type etc.) match parameters
             if (strcmp(metadata->relationName, relationName.c_str()) != 0
                 || metadata->attrByteOffset != attrByteOffset
-                || metadata->attrType != attrType) {
-                // Metadata does not match the parameters
-                // Unpin header page before exiting
-                try {
-                    bufMgr->unPinPage(file, headerPageNum, false);
-                } catch (PageNotPinnedException& e) {
-                    // Do nothing.
-                }
+                || metadata->attrType != attrType
+                || metadata->indexKind != BTREE_INDEX
+                || metadata->layoutVersion != BTREE_LAYOUT_VERSION) {
+                // Metadata does not match the parameters; close the file again before giving up
+                headerPage.release();
+                bufMgr->flushFile(file);
+                delete file;
                 throw BadIndexInfoException("Error: Existing index metadata does not match parameters passed.");
             }
             // Metatdata matches
 
             // Set root page for the index
             rootPageNum = metadata->rootPageNo;
+            const PageId bloomPageNum = metadata->bloomPageNo;
+            subtreeCounts = metadata->subtreeCounts;
+            headerPage.release();
+            if (bloomPageNum != Page::INVALID_NUMBER)
+                readBloomFilter(bloomPageNum);
+        }
+    }
 
-            // Unpin header page
-            try {
-                bufMgr->unPinPage(file, headerPageNum, false);
-            } catch (PageNotPinnedException& e) {
-                // Do nothing.
-            }
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::BTreeIndex -- Snapshot constructor
+    // -----------------------------------------------------------------------------
+    BTreeIndex::BTreeIndex(const BTreeIndex& index, SnapshotFile* snapshot) {
+        file = snapshot;
+        bufMgr = index.bufMgr;
+        attributeType = index.attributeType;
+        attrByteOffset = index.attrByteOffset;
+        leafOccupancy = index.leafOccupancy;
+        nodeOccupancy = index.nodeOccupancy;
+        residentLevels = 0;
+        readOnly = true;
+        bloomRejects = 0;
+        learnedLookups = 0;
+        directorySearch = true;
+        subtreeCounts = index.subtreeCounts;
+        scanExecuting = false;
+
+        // Keys are only ever added to the filter, so the one of the index also covers the snapshot
+        if (index.bloomFilter)
+            bloomFilter.reset(new BloomFilter(*index.bloomFilter));
+
+        // A model of the index is as old as the checkpoint at the latest, so it fits the snapshot
+        if (index.learnedModel) {
+            learnedModel.reset(new PiecewiseLinearModel(*index.learnedModel));
+            learnedLeaves = index.learnedLeaves;
+            learnedLeafPositions = index.learnedLeafPositions;
         }
+
+        // The root is read from the meta page of the snapshot, as of the checkpoint
+        headerPageNum = file->getFirstPageNo();
+        PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+        rootPageNum = ((IndexMetaInfo*) headerPage.page())->rootPageNo;
     }
 
 
@@ -157,11 +218,12 @@ namespace badgerdb
         scanExecuting = false;
 
         // Unpin any pinned pages
-        try {
-            bufMgr->unPinPage(file, currentPageNum, false);
-        } catch (PageNotPinnedException& e) {
-            // Do nothing.
-        }
+        currentPage.release();
+        residentNodes.clear();
+        residentPages.clear();
+
+        if (bloomFilter && !readOnly)
+            writeBloomFilter();
 
         // Flush index file
         bufMgr->flushFile(file);
@@ -175,188 +237,460 @@ namespace badgerdb
     // BTreeIndex::insertEntry
     // -----------------------------------------------------------------------------
     void BTreeIndex::insertEntry(const void *key, const RecordId rid) {
+        if (readOnly)
+            throw BadIndexInfoException("Error: Index snapshots cannot be modified.");
         if (key == nullptr)
             return;
 
-        // Get the root node
-        Page *currPage;
-        bufMgr->readPage(file, rootPageNum, currPage);
-        auto currNode = (NonLeafNodeInt*) currPage;
+        const int intKey = *((int*) key);
 
-        LeafNodeInt* dataNode;
-        int idx, intKey = *((int*) key);
+        // Lookups descend the tree again until the model is trained anew
+        learnedModel.reset();
+
+        if (bloomFilter) {
+            if (bloomFilter->full())
+                rebuildBloomFilter(2 * bloomFilter->keyCapacity());
+            bloomFilter->insert(intKey);
+        }
+
+        if (subtreeCounts)
+            insertInTree<CountedNonLeafNodeInt>(intKey, rid);
+        else
+            insertInTree<NonLeafNodeInt>(intKey, rid);
+    }
 
-        // Stack to keep track of all parent nodes in the path to the dataNode
-        std::stack<PageId> path;
-        path.push(rootPageNum);
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::insertInTree
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    void BTreeIndex::insertInTree(int intKey, const RecordId rid) {
+        int idx;
+
+        // Handles of all nodes in the path to the data node, starting with the root.
+        // Pages are unpinned as their handles are popped or go out of scope.
+        std::vector<PageHandle> path;
+        path.push_back(bufMgr->readPage(file, rootPageNum));
+        auto currNode = (Node*) path.back().page();
 
         // Traverse the b-tree to find the data node for insertion
         while (true) {
 
             // Traverse the current level of the tree to get the next page index
-            for (idx = 0;
-                 idx < INTARRAYNONLEAFSIZE &&
-                 currNode->pageNoArray[idx+1] != Page::INVALID_NUMBER &&
-                 currNode->keyArray[idx] < intKey;
-                 idx++);
+            idx = searchNonLeafNode(currNode, intKey, false);
 
             // The node is a newly created b-tree root node
             if (idx == 0 && currNode->pageNoArray[0] == Page::INVALID_NUMBER) {
 
                 // Allocate a page for the new data node
-                Page *pageRight, *pageLeft;
                 PageId pageIdLeft, pageIdRight;
-                bufMgr->allocPage(file, pageIdLeft, pageLeft);
-                bufMgr->allocPage(file, pageIdRight, pageRight);
+                PageHandle pageLeft = bufMgr->allocPage(file, pageIdLeft);
+                PageHandle pageRight = bufMgr->allocPage(file, pageIdRight);
 
                 // Point the root to the data node
                 currNode->keyArray[0] = intKey;
                 currNode->pageNoArray[0] = pageIdLeft;
                 currNode->pageNoArray[1] = pageIdRight;
+                path.back().markDirty();
+                updateDirectory(currNode);
+                setChildCount(currNode, 1, 1);
 
                 // Initialize the data node
-                dataNode = (LeafNodeInt*) pageRight;
-                auto leftDataNode = (LeafNodeInt*) pageLeft;
+                auto dataNode = (LeafNodeInt*) pageRight.page();
+                auto leftDataNode = (LeafNodeInt*) pageLeft.page();
                 leftDataNode->rightSibPageNo = pageIdRight;
 
                 for (int i = 0; i < INTARRAYLEAFSIZE; ++i) {
                     clearLeafNodeAtIdx(dataNode, i);
                     clearLeafNodeAtIdx(leftDataNode, i);
                 }
+                pageLeft.markDirty();
 
-                try {
-                    bufMgr->unPinPage(file, pageIdLeft, true);
-                } catch(PageNotPinnedException& e) {
-                    // Do nothing.
-                }
-
-                path.push(pageIdRight);
+                path.push_back(std::move(pageRight));
                 break;
             }
 
+            // The entry will be below the child, wherever splits move it
+            if (subtreeCounts) {
+                setChildCount(currNode, idx, childCount(currNode, idx) + 1);
+                path.back().markDirty();
+            }
+
             // Read the next page that contains the next node 1 level deeper in the b-tree
-            bufMgr->readPage(file, currNode->pageNoArray[idx], currPage);
-            path.push(currNode->pageNoArray[idx]);
+            const bool leafLevel = currNode->level == 1;
+            path.push_back(readChild<Node>(path.back(), idx));
 
-            // If the next level is the leaf level, set dataNode and break.
+            // If the next level is the leaf level, stop.
             // Otherwise, Set the current node and continue traversal
-            if (currNode->level == 1) {
-                dataNode = (LeafNodeInt*) currPage;
+            if (leafLevel) {
                 break;
-            } else {
-                currNode = (NonLeafNodeInt*) currPage;
             }
+            currNode = (Node*) path.back().page();
         }
 
         // Checks if data node has space for the key to be inserted without creating node splits
-        if (!insertKeyInLeafNode(dataNode, intKey, rid)) {
-
-            // Split the leaf node and copy the middle key upwards in the b-tree
-            PageId newPageId = splitLeafNode(dataNode, intKey, rid);
+        auto dataNode = (LeafNodeInt*) path.back().page();
+        path.back().markDirty();
+        if (insertKeyInLeafNode(dataNode, intKey, rid)) {
+            return;
+        }
 
-            try {
-                bufMgr->unPinPage(file, path.top(), true);
-            } catch(PageNotPinnedException& e) {
-                // Do nothing.
+        // Split the leaf node and copy the middle key upwards in the b-tree
+        PageId newPageId = splitLeafNode(dataNode, intKey, rid);
+        std::uint32_t leftCount = subtreeCounts ? leafEntryCount(dataNode) : 0;
+        PageId currPageId = path.back().pageNo();
+        path.pop_back();
+
+        // Keep splitting parents until a parent has empty space available
+        bool nonLeafSplit = false;
+        while (!path.empty()) {
+            currNode = (Node*) path.back().page();
+            path.back().markDirty();
+            if (insertKeyInNonLeafNode(currNode, intKey, newPageId, leftCount)) {
+                if (nonLeafSplit) {
+                    refreshResidentLevels();
+                }
+                return;
             }
-            path.pop();
 
-            PageId currPageId = path.top();
+            // Child references move between nodes in a split, so they must not be swizzled
+            bufMgr->unswizzleChildren(path.back());
+            newPageId = splitNonLeafNode(currNode, intKey, newPageId, leftCount);
+            if (subtreeCounts)
+                leftCount = nodeEntryCount(currNode);
+            nonLeafSplit = true;
+            currPageId = path.back().pageNo();
+            path.pop_back();
+        }
 
-            // Read the parent non-leaf node
-            bufMgr->readPage(file, currPageId, currPage);
-            try {
-                bufMgr->unPinPage(file, currPageId, true);
-            } catch (PageNotPinnedException& e) {
-                // Do nothing.
-            }
-            currNode = (NonLeafNodeInt*) currPage;
+        // No empty non-leaf node found, so create a new root
+        PageId pageId;
+        PageHandle rootPage = bufMgr->allocPage(file, pageId);
+
+        // Create the new root node
+        auto root = (Node*) rootPage.page();
+        initNonLeafNode(root, 0);
+
+        // Copy the middle key and the page numbers of child nodes
+        root->keyArray[0] = intKey;
+        root->pageNoArray[0] = currPageId;
+        root->pageNoArray[1] = newPageId;
+        updateDirectory(root);
+        setChildCount(root, 0, leftCount);
+        setChildCount(root, 1, subtreeCounts ? nodeEntryCount((const Node*) bufMgr->readPage(file, newPageId).page()) : 0);
+        rootPage.markDirty();
+
+        // Update the root page no of the b-tree, in the meta page too so it is found on reopening
+        rootPageNum = pageId;
+        rootPage.release();
+        PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+        ((IndexMetaInfo*) headerPage.page())->rootPageNo = rootPageNum;
+        headerPage.markDirty();
+        headerPage.release();
+        refreshResidentLevels();
+    }
 
-            // Keep splitting parents until a parent has empty space available
-            while (!insertKeyInNonLeafNode(currNode, intKey, newPageId)) {
 
-                newPageId = splitNonLeafNode(currNode, intKey, newPageId);
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::lookup
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::lookup(const void *key, RecordId& outRid) {
+        const int intKey = *((int*) key);
+        if (bloomFilter && !bloomFilter->mayContain(intKey)) {
+            bloomRejects++;
+            throw NoSuchKeyFoundException();
+        }
 
-                // Unpin the page before popping it from the stack
-                try {
-                    bufMgr->unPinPage(file, currPageId, true);
-                } catch (PageNotPinnedException& e) {
-                    // Do nothing.
-                }
-                path.pop();
+        if (learnedModel) {
+            learnedLookup(intKey, outRid);
+            return;
+        }
 
-                if (!path.empty()) {
-                    currPageId = path.top();
-                    bufMgr->readPage(file, currPageId, currPage);
-                    currNode = (NonLeafNodeInt*) currPage;
-                } else {
-                    break;
-                }
+        PageHandle page = findLeaf(intKey);
+        if (!page.valid())
+            throw NoSuchKeyFoundException();
+
+        // Binary search over the used entries of the leaf node
+        auto node = (LeafNodeInt*) page.page();
+        int low = 0, high = INTARRAYLEAFSIZE - 1;
+        while (low <= high) {
+            const int mid = (low + high) / 2;
+            if (node->ridArray[mid].page_number == Page::INVALID_NUMBER || node->keyArray[mid] > intKey) {
+                high = mid - 1;
+            } else if (node->keyArray[mid] < intKey) {
+                low = mid + 1;
+            } else {
+                outRid = node->ridArray[mid];
+                return;
             }
+        }
+        throw NoSuchKeyFoundException();
+    }
 
-            try {
-                bufMgr->unPinPage(file, currPageId, true);
-            } catch(PageNotPinnedException& e) {
-                // Do nothing.
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::countRange
+    // -----------------------------------------------------------------------------
+    std::uint64_t BTreeIndex::countRange(const void* lowValParm,
+                                         const Operator lowOpParm,
+                                         const void* highValParm,
+                                         const Operator highOpParm) {
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+            throw BadOpcodesException();
+        }
+
+        const int lowVal = *(int *)lowValParm;
+        const int highVal = *(int *)highValParm;
+        if (lowVal > highVal)
+            throw BadScanrangeException();
+        if (!subtreeCounts)
+            throw BadIndexInfoException("Error: The index does not keep subtree counts.");
+
+        // Entries up to the high end of the range minus those below its low end
+        const std::uint64_t below = countBelow(lowVal, lowOpParm == GT);
+        const std::uint64_t upTo = countBelow(highVal, highOpParm == LTE);
+        return upTo > below ? upTo - below : 0;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::rank
+    // -----------------------------------------------------------------------------
+    std::uint64_t BTreeIndex::rank(const void* key) {
+        if (!subtreeCounts)
+            throw BadIndexInfoException("Error: The index does not keep subtree counts.");
+        return countBelow(*((int*) key), false);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::select
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::select(std::uint64_t k, void* outKey, RecordId& outRid) {
+        if (!subtreeCounts)
+            throw BadIndexInfoException("Error: The index does not keep subtree counts.");
+
+        // Skip the children holding fewer entries than are left to skip
+        PageHandle page = bufMgr->readPage(file, rootPageNum);
+        while (true) {
+            auto node = (const CountedNonLeafNodeInt*) page.page();
+            if (node->pageNoArray[0] == Page::INVALID_NUMBER)
+                throw NoSuchKeyFoundException();
+
+            int idx = 0;
+            while (idx < INTARRAYCOUNTEDNONLEAFSIZE
+                   && node->pageNoArray[idx+1] != Page::INVALID_NUMBER
+                   && k >= node->countArray[idx]) {
+                k -= node->countArray[idx];
+                idx++;
             }
 
-            // No empty non-leaf node found, so create a new root
-            if (path.empty()) {
-                Page* rootPage;
-                PageId pageId;
+            const bool leafLevel = node->level == 1;
+            page = readChild<CountedNonLeafNodeInt>(page, idx);
+            if (leafLevel)
+                break;
+        }
 
-                // Allocate a new page for the root node
-                bufMgr->allocPage(file, pageId, rootPage);
+        // k is past the last entry if it was not below the number of entries in the index
+        auto leaf = (const LeafNodeInt*) page.page();
+        if (k >= (std::uint64_t) INTARRAYLEAFSIZE || leaf->ridArray[k].page_number == Page::INVALID_NUMBER)
+            throw NoSuchKeyFoundException();
+        *((int*) outKey) = leaf->keyArray[k];
+        outRid = leaf->ridArray[k];
+    }
 
-                // Create the new root node
-                auto root = (NonLeafNodeInt*) rootPage;
-                root->level = 0;
 
-                for (int i = 1; i < INTARRAYNONLEAFSIZE; i++) {
-                    clearNonLeafNodeAtIdx(root, i);
-                }
-                root->pageNoArray[INTARRAYNONLEAFSIZE] = Page::INVALID_NUMBER;
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::sample
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::sample(const void* lowValParm,
+                            const Operator lowOpParm,
+                            const void* highValParm,
+                            const Operator highOpParm,
+                            const std::size_t n,
+                            std::vector<RIDKeyPair<int>>& outSamples) {
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+            throw BadOpcodesException();
+        }
 
-                // Copy the middle key and the page numbers of child nodes
-                root->keyArray[0] = intKey;
-                root->pageNoArray[0] = currPageId;
-                root->pageNoArray[1] = newPageId;
+        const int lowVal = *(int *)lowValParm;
+        const int highVal = *(int *)highValParm;
+        if (lowVal > highVal)
+            throw BadScanrangeException();
 
-                // Update the root page no of the b-tree
-                rootPageNum = pageId;
+        // Bounds of the range, both included
+        if ((lowOpParm == GT && lowVal == INT_MAX) || (highOpParm == LT && highVal == INT_MIN))
+            throw NoSuchKeyFoundException();
+        const int lowKey = lowOpParm == GT ? lowVal + 1 : lowVal;
+        const int highKey = highOpParm == LT ? highVal - 1 : highVal;
+        if (lowKey > highKey)
+            throw NoSuchKeyFoundException();
+
+        outSamples.clear();
+        outSamples.reserve(n);
+        RIDKeyPair<int> entry;
+
+        if (subtreeCounts) {
+            const std::uint64_t first = countBelow(lowKey, false);
+            const std::uint64_t end = countBelow(highKey, true);
+            if (end <= first)
+                throw NoSuchKeyFoundException();
+
+            std::uniform_int_distribution<std::uint64_t> position(first, end - 1);
+            while (outSamples.size() < n) {
+                select(position(sampleGenerator), &entry.key, entry.rid);
+                outSamples.push_back(entry);
+            }
+            return;
+        }
 
-                // Unpin the new root page and the newly split child node
-                try {
-                    bufMgr->unPinPage(file, newPageId, true);
-                } catch (PageNotPinnedException& e) {
-                    // Do nothing.
-                }
-                try {
-                    bufMgr->unPinPage(file, pageId, true);
-                } catch (PageNotPinnedException& e) {
-                    // Do nothing.
+        // A range within a few leaves is sampled from its entries, random slots in them would mostly miss it
+        {
+            std::vector<RIDKeyPair<int>> entries;
+            PageHandle page = findLeaf(lowKey);
+            bool complete = !page.valid();
+            for (int leaves = 0; page.valid() && leaves < SAMPLE_SCAN_LEAVES; leaves++) {
+                auto leaf = (const LeafNodeInt*) page.page();
+                int i = 0;
+                for (; i < INTARRAYLEAFSIZE && leaf->ridArray[i].page_number != Page::INVALID_NUMBER
+                       && leaf->keyArray[i] <= highKey; i++) {
+                    if (leaf->keyArray[i] >= lowKey) {
+                        entry.set(leaf->ridArray[i], leaf->keyArray[i]);
+                        entries.push_back(entry);
+                    }
                 }
-            }
-            while (!path.empty()) {
-                try {
-                    bufMgr->unPinPage(file, path.top(), true);
-                } catch(PageNotPinnedException& e) {
-                    // Do nothing.
+                // The range ends in this leaf
+                if ((i < INTARRAYLEAFSIZE && leaf->ridArray[i].page_number != Page::INVALID_NUMBER)
+                    || leaf->rightSibPageNo == Page::INVALID_NUMBER) {
+                    complete = true;
+                    break;
                 }
-                path.pop();
+                page = bufMgr->readPage(file, leaf->rightSibPageNo);
             }
-        } else {
-            while (!path.empty()) {
-                try {
-                    bufMgr->unPinPage(file, path.top(), true);
-                } catch (PageNotPinnedException& e) {
-                    // Do nothing.
-                } catch (HashNotFoundException &e) {
-                    // Do nothing.
-                }
-                path.pop();
+
+            if (complete) {
+                if (entries.empty())
+                    throw NoSuchKeyFoundException();
+                std::uniform_int_distribution<std::size_t> position(0, entries.size() - 1);
+                while (outSamples.size() < n)
+                    outSamples.push_back(entries[position(sampleGenerator)]);
+                return;
             }
         }
+
+        // Pick a leaf of the range and a slot in it, every entry of the range is equally likely
+        std::vector<SampleLeafRun> runs;
+        std::uint64_t leaves = 0;
+        {
+            PageHandle root = bufMgr->readPage(file, rootPageNum);
+            appendLeafRuns(root, lowKey, highKey, runs, leaves);
+        }
+        if (leaves == 0)
+            throw NoSuchKeyFoundException();
+
+        std::uniform_int_distribution<std::uint64_t> leafNo(0, leaves - 1);
+        std::uniform_int_distribution<int> leafSlot(0, INTARRAYLEAFSIZE - 1);
+        while (outSamples.size() < n) {
+            const std::uint64_t pick = leafNo(sampleGenerator);
+            auto run = std::upper_bound(runs.begin(), runs.end(), pick,
+                [](const std::uint64_t leaf, const SampleLeafRun& r) { return leaf < r.leavesBefore; }) - 1;
+
+            PageHandle page = bufMgr->readPage(file, run->parentPageNo);
+            page = readChild<NonLeafNodeInt>(page, run->firstChild + (int) (pick - run->leavesBefore));
+            auto leaf = (const LeafNodeInt*) page.page();
+            const int slot = leafSlot(sampleGenerator);
+            if (leaf->ridArray[slot].page_number == Page::INVALID_NUMBER
+                || leaf->keyArray[slot] < lowKey || leaf->keyArray[slot] > highKey)
+                continue;
+            entry.set(leaf->ridArray[slot], leaf->keyArray[slot]);
+            outSamples.push_back(entry);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::appendLeafRuns
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::appendLeafRuns(const PageHandle& page, const int lowKey, const int highKey,
+                                    std::vector<SampleLeafRun>& runs, std::uint64_t& leaves) {
+        auto node = (const NonLeafNodeInt*) page.page();
+        const int firstChild = searchNonLeafNode(node, lowKey, false);
+        const int lastChild = searchNonLeafNode(node, highKey, true);
+        if (node->pageNoArray[firstChild] == Page::INVALID_NUMBER)
+            return;
+
+        if (node->level == 1) {
+            SampleLeafRun run = {page.pageNo(), firstChild, leaves};
+            runs.push_back(run);
+            leaves += lastChild - firstChild + 1;
+            return;
+        }
+
+        // Only the path down to the current node stays pinned
+        for (int i = firstChild; i <= lastChild; i++) {
+            PageHandle child = readChild<NonLeafNodeInt>(page, i);
+            appendLeafRuns(child, lowKey, highKey, runs, leaves);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::countBelow
+    // -----------------------------------------------------------------------------
+    std::uint64_t BTreeIndex::countBelow(const int key, const bool inclusive) {
+        // Children left of the one the key would go to hold only smaller keys, those right of it only larger ones
+        std::uint64_t count = 0;
+        PageHandle page = bufMgr->readPage(file, rootPageNum);
+        while (true) {
+            auto node = (const CountedNonLeafNodeInt*) page.page();
+            if (node->pageNoArray[0] == Page::INVALID_NUMBER)
+                return 0;
+
+            const int idx = searchNonLeafNode(node, key, inclusive);
+            for (int i = 0; i < idx; i++)
+                count += node->countArray[i];
+
+            const bool leafLevel = node->level == 1;
+            page = readChild<CountedNonLeafNodeInt>(page, idx);
+            if (leafLevel)
+                break;
+        }
+
+        // Binary search for the first used entry of the leaf node that is not counted
+        auto leaf = (const LeafNodeInt*) page.page();
+        int low = 0, high = INTARRAYLEAFSIZE;
+        while (low < high) {
+            const int mid = (low + high) / 2;
+            if (leaf->ridArray[mid].page_number != Page::INVALID_NUMBER
+                && (leaf->keyArray[mid] < key || (inclusive && leaf->keyArray[mid] == key)))
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        return count + low;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::nodeEntryCount
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    std::uint32_t BTreeIndex::nodeEntryCount(const Node* node) const {
+        std::uint32_t count = 0;
+        for (int i = 0; i <= Node::SIZE && node->pageNoArray[i] != Page::INVALID_NUMBER; i++)
+            count += childCount(node, i);
+        return count;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::leafEntryCount
+    // -----------------------------------------------------------------------------
+    std::uint32_t BTreeIndex::leafEntryCount(const LeafNodeInt* node) const {
+        std::uint32_t count = 0;
+        while (count < (std::uint32_t) INTARRAYLEAFSIZE && node->ridArray[count].page_number != Page::INVALID_NUMBER)
+            count++;
+        return count;
     }
 
 
@@ -365,10 +699,9 @@ namespace badgerdb
     // -----------------------------------------------------------------------------
     PageId BTreeIndex::splitLeafNode(LeafNodeInt *dataNode, int& intKey, const RecordId rid) {
         // Create and allocate the page (and leaf node)
-        Page* page;
         PageId pageId;
-        bufMgr->allocPage(file, pageId, page);
-        auto newLeafNode = (LeafNodeInt*) page;
+        PageHandle page = bufMgr->allocPage(file, pageId);
+        auto newLeafNode = (LeafNodeInt*) page.page();
 
         // Initialize the node with default values
         for (int i = 0; i < INTARRAYLEAFSIZE; i++)
@@ -395,12 +728,8 @@ namespace badgerdb
 
         intKey = newLeafNode->keyArray[0];
 
-        // Unpin the newly split child node
-        try {
-            bufMgr->unPinPage(file, pageId, true);
-        } catch (PageNotPinnedException& e) {
-            // Do nothing.
-        }
+        // The newly split child node is unpinned when its handle goes out of scope
+        page.markDirty();
 
         return pageId;
     }
@@ -409,76 +738,86 @@ namespace badgerdb
     // -----------------------------------------------------------------------------
     // BTreeIndex::splitNonLeafNode
     // -----------------------------------------------------------------------------
-    PageId BTreeIndex::splitNonLeafNode(NonLeafNodeInt* node, int &intKey, const PageId pageId) {
+    template<class Node>
+    PageId BTreeIndex::splitNonLeafNode(Node* node, int &intKey, const PageId pageId, const std::uint32_t leftCount) {
         // Create and allocate the page (and new node)
-        Page* page;
         PageId pageId_;
-        bufMgr->allocPage(file, pageId_, page);
-        auto newNode = (NonLeafNodeInt*) page;
+        PageHandle page = bufMgr->allocPage(file, pageId_);
+        auto newNode = (Node*) page.page();
 
         // Initialize the node with default values
-        for (int i = 0; i < INTARRAYNONLEAFSIZE; i++) {
-            clearNonLeafNodeAtIdx(newNode, i);
-        }
-        newNode->pageNoArray[INTARRAYNONLEAFSIZE] = Page::INVALID_NUMBER;
+        initNonLeafNode(newNode, node->level);
 
         // Get the middle index value and create sorted key and rid array
-        int midIdx = (INTARRAYNONLEAFSIZE + 1) / 2, prevKey = INT_MIN, i, j;
-        int keyArr[INTARRAYNONLEAFSIZE+1];
-        PageId pageNoArr[INTARRAYNONLEAFSIZE+2];
+        int midIdx = (Node::SIZE + 1) / 2, prevKey = INT_MIN, i, j, newIdx = -1;
+        int keyArr[Node::SIZE+1];
+        PageId pageNoArr[Node::SIZE+2];
+        std::uint32_t countArr[Node::SIZE+2];
 
         // The first page number won't be changed during a split as we always
         // create the new leaf (or non-leaf) node to the right side of the
         // existing node.
         pageNoArr[0] = node->pageNoArray[0];
+        countArr[0] = childCount(node, 0);
 
         // Create a sorted array of all keys with new key in its position
-        for (i = 0, j = 0; j < INTARRAYNONLEAFSIZE; i++) {
+        for (i = 0, j = 0; j < Node::SIZE; i++) {
             if (prevKey <= intKey && intKey < node->keyArray[j]) {
                 keyArr[i] = intKey;
                 pageNoArr[i+1] = pageId;
+                newIdx = i;
                 prevKey = node->keyArray[j];
                 continue;
             }
             prevKey = keyArr[i] = node->keyArray[j];
             pageNoArr[i+1] = node->pageNoArray[j+1];
+            countArr[i+1] = childCount(node, j+1);
             j++;
         }
         // Special case where the key is the last key in the sorted key list
         if (i == j) {
             keyArr[i] = intKey;
             pageNoArr[i+1] = pageId;
+            newIdx = i;
         }
 
+        // The new child takes the entries its left neighbour gave up in its split
+        countArr[newIdx+1] = countArr[newIdx] - leftCount;
+        countArr[newIdx] = leftCount;
+
         node->pageNoArray[0] = pageNoArr[0];
+        setChildCount(node, 0, countArr[0]);
         // Update keys of dataNode (left split) to the first half of keys
         for (i = 0; i < midIdx; ++i) {
             node->keyArray[i] = keyArr[i];
             node->pageNoArray[i+1] = pageNoArr[i+1];
+            setChildCount(node, i+1, countArr[i+1]);
         }
 
         newNode->pageNoArray[0] = pageNoArr[midIdx+1];
+        setChildCount(newNode, 0, countArr[midIdx+1]);
         // Update keys of newNode (right split) with second half of keys
-        for (i = midIdx; i < INTARRAYNONLEAFSIZE; ++i) {
+        for (i = midIdx; i < Node::SIZE; ++i) {
             newNode->keyArray[i-midIdx] = keyArr[i+1];
             newNode->pageNoArray[i-midIdx+1] = pageNoArr[i+2];
+            setChildCount(newNode, i-midIdx+1, countArr[i+2]);
             // Invalidate corresponding indices in node as second half of that
-            // array is now empty
-            clearNonLeafNodeAtIdx(node, i);
+            // array is now empty. The child left of key i stays with node.
+            node->keyArray[i] = -1;
+            node->pageNoArray[i+1] = Page::INVALID_NUMBER;
+            setChildCount(node, i+1, 0);
             clearNonLeafNodeAtIdx(newNode, i-1);
         }
-        node->pageNoArray[INTARRAYNONLEAFSIZE] = Page::INVALID_NUMBER;
+        node->pageNoArray[Node::SIZE] = Page::INVALID_NUMBER;
+        setChildCount(node, Node::SIZE, 0);
 
-        newNode->level = node->level;
+        updateDirectory(node);
+        updateDirectory(newNode);
 
         intKey = keyArr[midIdx];
 
-        // Unpin the newly split child node
-        try {
-            bufMgr->unPinPage(file, pageId_, true);
-        } catch (PageNotPinnedException& e) {
-            // Do nothing.
-        }
+        // The newly split child node is unpinned when its handle goes out of scope
+        page.markDirty();
 
         return pageId_;
     }
@@ -521,32 +860,38 @@ namespace badgerdb
     // -----------------------------------------------------------------------------
     // BTreeIndex::insertKeyInNonLeafNode
     // -----------------------------------------------------------------------------
-    bool BTreeIndex::insertKeyInNonLeafNode(NonLeafNodeInt* node, int key, PageId pageId) {
+    template<class Node>
+    bool BTreeIndex::insertKeyInNonLeafNode(Node* node, int key, PageId pageId, const std::uint32_t leftCount) {
         // Checks if the node contains any empty space for insertion
-        if (node->pageNoArray[INTARRAYNONLEAFSIZE] != Page::INVALID_NUMBER)
+        if (node->pageNoArray[Node::SIZE] != Page::INVALID_NUMBER)
             return false;
 
         int idx, newKey = key;
         PageId newPageId = pageId;
 
         // Find the index to insert the key-pageId pair
-        for (idx = 0;
-             idx < INTARRAYNONLEAFSIZE &&
-             node->pageNoArray[idx+1] != Page::INVALID_NUMBER &&
-             node->keyArray[idx] < key;
-             idx++);
+        idx = searchNonLeafNode(node, key, false);
+
+        // The new child takes the entries its left neighbour gave up in its split
+        std::uint32_t newCount = childCount(node, idx) - leftCount;
+        setChildCount(node, idx, leftCount);
 
         // Insert the key at position idx and shift everything else right
         for (; node->pageNoArray[idx+1] != Page::INVALID_NUMBER; idx++) {
             int oldKey = node->keyArray[idx];
             PageId oldPageId = node->pageNoArray[idx+1];
+            std::uint32_t oldCount = childCount(node, idx+1);
             node->keyArray[idx] = newKey;
             node->pageNoArray[idx+1] = newPageId;
+            setChildCount(node, idx+1, newCount);
             newKey = oldKey;
             newPageId = oldPageId;
+            newCount = oldCount;
         }
         node->keyArray[idx] = newKey;
         node->pageNoArray[idx+1] = newPageId;
+        setChildCount(node, idx+1, newCount);
+        updateDirectory(node);
 
         return true;
     }
@@ -565,9 +910,61 @@ namespace badgerdb
     // -----------------------------------------------------------------------------
     // BTreeIndex::clearNonLeafNodeAtIdx
     // -----------------------------------------------------------------------------
-    void BTreeIndex::clearNonLeafNodeAtIdx(NonLeafNodeInt* node, int idx) {
+    template<class Node>
+    void BTreeIndex::clearNonLeafNodeAtIdx(Node* node, int idx) {
         node->keyArray[idx] = -1;
         node->pageNoArray[idx] = Page::INVALID_NUMBER;
+        setChildCount(node, idx, 0);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::initNonLeafNode
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    void BTreeIndex::initNonLeafNode(Node* node, const int level) {
+        node->level = level;
+        for (int i = 0; i < Node::SIZE; i++) {
+            clearNonLeafNodeAtIdx(node, i);
+        }
+        node->pageNoArray[Node::SIZE] = Page::INVALID_NUMBER;
+        setChildCount(node, Node::SIZE, 0);
+        updateDirectory(node);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::updateDirectory
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    void BTreeIndex::updateDirectory(Node* node) {
+        for (int block = 0; block < Node::DIRECTORY_SIZE; block++) {
+            const int last = (block + 1) * NONLEAF_BLOCK_KEYS - 1;
+            node->directory[block] = node->pageNoArray[last+1] != Page::INVALID_NUMBER ? node->keyArray[last] : INT_MAX;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::searchNonLeafNode
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    int BTreeIndex::searchNonLeafNode(const Node* node, const int key, const bool pastEqual) const {
+        int idx = 0;
+        if (directorySearch) {
+            // All keys of the blocks whose last key is below the key are below it too. Counting them
+            // without branches reads the directory front to back, which the compiler can vectorize.
+            int blocks = 0;
+            for (int block = 0; block < Node::DIRECTORY_SIZE; block++)
+                blocks += node->directory[block] < key;
+            idx = blocks * NONLEAF_BLOCK_KEYS;
+        }
+
+        while (idx < Node::SIZE
+               && node->pageNoArray[idx+1] != Page::INVALID_NUMBER
+               && (node->keyArray[idx] < key || (pastEqual && node->keyArray[idx] == key)))
+            idx++;
+        return idx;
     }
 
 
@@ -594,70 +991,436 @@ namespace badgerdb
             endScan();
         }
 
+        if (bloomFilter && lowOpParm == GTE && highOpParm == LTE && lowValInt == highValInt
+            && !bloomFilter->mayContain(lowValInt)) {
+            bloomRejects++;
+            throw NoSuchKeyFoundException();
+        }
+
         // Set up variables for scan
         scanExecuting = true;
         lowOp = lowOpParm;
         highOp = highOpParm;
 
-        // Scan the tree from root to find the parent of the first leaf node to be scanned
-        getFirstParent(rootPageNum);
+        // Scan the tree from root to find the first leaf node to be scanned
+        getFirstParent();
     }
 
 
     // -----------------------------------------------------------------------------
     // BTreeIndex::getFirstParent
     // -----------------------------------------------------------------------------
-    void BTreeIndex::getFirstParent(PageId pageNum) {
-        currentPageNum = pageNum;
-        bufMgr->readPage(file, currentPageNum, currentPageData);
-        auto nonLeafNode = (NonLeafNodeInt*) currentPageData;
+    void BTreeIndex::getFirstParent() {
+        currentPage = findLeaf(lowValInt);
 
-        int i = 0;
-        while (i < INTARRAYNONLEAFSIZE
-               && lowValInt >= nonLeafNode->keyArray[i]
-               && nonLeafNode->pageNoArray[i+1] != Page::INVALID_NUMBER)
-            i++;
+        // The index is empty
+        if (!currentPage.valid()) {
+            scanExecuting = false;
+            throw NoSuchKeyFoundException();
+        }
 
-        // A level above leaf node
-        if (nonLeafNode->level == 1) {
-            try {
-                bufMgr->unPinPage(file, currentPageNum, false);
-            } catch (PageNotPinnedException& e) {
-                // Do nothing.
+        // Use binary search to set the value of nextEntry to read the first record that is in the scan range
+        auto currentNode = (LeafNodeInt*) currentPage.page();
+        int low = 0, high = INTARRAYLEAFSIZE - 1;
+        int mid;
+        while (low <= high) {
+          mid  = (low + high) / 2;
+
+          if (currentNode->ridArray[mid].page_number == Page::INVALID_NUMBER) {
+            high = mid - 1;
+          } else if ((lowOp == GT && currentNode->keyArray[mid] == lowValInt + 1) ||
+              (lowOp == GTE && currentNode->keyArray[mid] == lowValInt)) {
+            break;
+          } else if ((lowOp == GT && currentNode->keyArray[mid] <= lowValInt) ||
+              (lowOp == GTE && currentNode->keyArray[mid] < lowValInt)) {
+            low = mid + 1;
+          } else {
+            high = mid - 1;
+          }
+        }
+        nextEntry = mid;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::findLeaf
+    // -----------------------------------------------------------------------------
+    PageHandle BTreeIndex::findLeaf(const int key) {
+        if (subtreeCounts)
+            return findLeafIn<CountedNonLeafNodeInt>(key);
+        return findLeafIn<NonLeafNodeInt>(key);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::findLeafIn
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    PageHandle BTreeIndex::findLeafIn(const int key) {
+        PageHandle page;
+        const Node* node = (const Node*) residentNode(rootPageNum);
+        if (node == NULL) {
+            page = bufMgr->readPage(file, rootPageNum);
+            node = (const Node*) page.page();
+        }
+
+        while (true) {
+            const int i = searchNonLeafNode(node, key, true);
+            const PageId childRef = node->pageNoArray[i];
+            if (childRef == Page::INVALID_NUMBER)
+                return PageHandle();
+
+            // Resident children are read directly, without going through the buffer manager
+            const bool leafLevel = node->level == 1;
+            if (!leafLevel) {
+                auto child = (const Node*) residentNode(childRef);
+                if (child != NULL) {
+                    page.release();
+                    node = child;
+                    continue;
+                }
             }
 
-            // Search for the key in leaf node
-            currentPageNum = nonLeafNode->pageNoArray[i];
-            bufMgr->readPage(file, currentPageNum, currentPageData);
+            // The parent is unpinned once the child is pinned
+            if (page.valid())
+                page = readChild<Node>(page, i);
+            else
+                page = (childRef & SWIZZLED_BIT) ? bufMgr->readSwizzled(childRef) : bufMgr->readPage(file, childRef);
+            if (leafLevel)
+                return page;
+            node = (const Node*) page.page();
+        }
+    }
 
-            // Use binary search to set the value of nextEntry to read the first record that is in the scan range
-            auto currentNode = (LeafNodeInt*) currentPageData;
-            int low = 0, high = INTARRAYLEAFSIZE - 1;
-            int mid;
-            while (low <= high) {
-              mid  = (low + high) / 2;
 
-              if (currentNode->ridArray[mid].page_number == Page::INVALID_NUMBER) {
-                high = mid - 1;
-              } else if ((lowOp == GT && currentNode->keyArray[mid] == lowValInt + 1) ||
-                  (lowOp == GTE && currentNode->keyArray[mid] == lowValInt)) {
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::residentNode
+    // -----------------------------------------------------------------------------
+    const Page* BTreeIndex::residentNode(const PageId ref) const {
+        if (residentNodes.empty())
+            return NULL;
+        auto resident = residentNodes.find(ref);
+        return resident != residentNodes.end() ? resident->second : NULL;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::defragment
+    // -----------------------------------------------------------------------------
+    bool BTreeIndex::defragment() {
+        auto mappedFile = dynamic_cast<MappedBlobFile*>(file);
+        if (mappedFile == nullptr)
+            return false;
+
+        std::vector<PageId> order(1, headerPageNum);
+        if (subtreeCounts)
+            appendTreePages<CountedNonLeafNodeInt>(order);
+        else
+            appendTreePages<NonLeafNodeInt>(order);
+
+        // Pages cached in the buffer pool keep their logical page numbers, so
+        // the move is invisible to the pool
+        mappedFile->reorganize(order);
+        return true;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::appendTreePages
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    void BTreeIndex::appendTreePages(std::vector<PageId>& order) {
+        // Walk the tree level by level; children are collected left to right,
+        // so the leaves end up in key order
+        std::vector<PageId> level(1, rootPageNum);
+        while (!level.empty()) {
+            order.insert(order.end(), level.begin(), level.end());
+            std::vector<PageId> children;
+            bool leafChildren = false;
+            for (const PageId pageNo : level) {
+                PageHandle page = bufMgr->readPage(file, pageNo);
+                auto node = (const Node*) page.page();
+                leafChildren = node->level == 1;
+                for (int i = 0; i <= Node::SIZE && node->pageNoArray[i] != Page::INVALID_NUMBER; i++) {
+                    const PageId ref = node->pageNoArray[i];
+                    children.push_back((ref & SWIZZLED_BIT) ? bufMgr->readSwizzled(ref).pageNo() : ref);
+                }
+            }
+            if (leafChildren) {
+                order.insert(order.end(), children.begin(), children.end());
                 break;
-              } else if ((lowOp == GT && currentNode->keyArray[mid] <= lowValInt) ||
-                  (lowOp == GTE && currentNode->keyArray[mid] < lowValInt)) {
-                low = mid + 1;
-              } else {
-                high = mid - 1;
-              }
             }
-            nextEntry = mid;
-        } else {
-            // No record found here, unpin page and move on to the next page
-            try {
-                bufMgr->unPinPage(file, currentPageNum, false);
-            } catch (PageNotPinnedException& e) {
-                // Do nothing.
+            level.swap(children);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::checkpoint
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::checkpoint() {
+        if (bloomFilter && !readOnly)
+            writeBloomFilter();
+        bufMgr->checkpointFile(file);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::trainLearnedModel
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::trainLearnedModel(const int maxError) {
+        std::vector<int> keys;
+        learnedLeaves.clear();
+        learnedLeafPositions.clear();
+        PageHandle page = findLeaf(INT_MIN);
+        while (page.valid()) {
+            auto node = (const LeafNodeInt*) page.page();
+            learnedLeaves.push_back(page.pageNo());
+            learnedLeafPositions.push_back(keys.size());
+            for (int i = 0; i < INTARRAYLEAFSIZE && node->ridArray[i].page_number != Page::INVALID_NUMBER; i++)
+                keys.push_back(node->keyArray[i]);
+            if (node->rightSibPageNo == Page::INVALID_NUMBER)
+                break;
+            page = bufMgr->readPage(file, node->rightSibPageNo);
+        }
+        learnedLeafPositions.push_back(keys.size());
+        learnedModel.reset(new PiecewiseLinearModel(keys, maxError));
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::learnedLookup
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::learnedLookup(const int key, RecordId& outRid) {
+        learnedLookups++;
+        std::uint64_t low, high;
+        if (!learnedModel->bounds(key, low, high))
+            throw NoSuchKeyFoundException();
+
+        // The predicted positions usually lie in one leaf, at most in a few neighbours
+        std::size_t leaf = std::upper_bound(learnedLeafPositions.begin(), learnedLeafPositions.end(), low)
+                           - learnedLeafPositions.begin() - 1;
+        for (; leaf < learnedLeaves.size() && learnedLeafPositions[leaf] <= high; leaf++) {
+            const std::uint64_t first = learnedLeafPositions[leaf];
+            if (learnedLeafPositions[leaf + 1] == first)
+                continue;
+            int lowSlot = (int) (std::max(low, first) - first);
+            int highSlot = (int) (std::min(high, learnedLeafPositions[leaf + 1] - 1) - first);
+
+            PageHandle page = bufMgr->readPage(file, learnedLeaves[leaf]);
+            auto node = (const LeafNodeInt*) page.page();
+            while (lowSlot <= highSlot) {
+                const int mid = (lowSlot + highSlot) / 2;
+                if (node->keyArray[mid] > key) {
+                    highSlot = mid - 1;
+                } else if (node->keyArray[mid] < key) {
+                    lowSlot = mid + 1;
+                } else {
+                    outRid = node->ridArray[mid];
+                    return;
+                }
+            }
+        }
+        throw NoSuchKeyFoundException();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::rebuildBloomFilter
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::rebuildBloomFilter(const std::uint64_t capacity) {
+        bloomFilter.reset(new BloomFilter(capacity));
+        PageHandle page = findLeaf(INT_MIN);
+        while (page.valid()) {
+            auto node = (const LeafNodeInt*) page.page();
+            for (int i = 0; i < INTARRAYLEAFSIZE && node->ridArray[i].page_number != Page::INVALID_NUMBER; i++)
+                bloomFilter->insert(node->keyArray[i]);
+            if (node->rightSibPageNo == Page::INVALID_NUMBER)
+                break;
+            page = bufMgr->readPage(file, node->rightSibPageNo);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::readBloomFilter
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::readBloomFilter(PageId pageNo) {
+        std::uint64_t capacity = 0, keyCount = 0;
+        std::vector<std::uint32_t> words;
+        while (pageNo != Page::INVALID_NUMBER) {
+            PageHandle page = bufMgr->readPage(file, pageNo);
+            auto filterPage = (const BloomFilterPage*) page.page();
+            if (bloomPages.empty()) {
+                capacity = filterPage->capacity;
+                keyCount = filterPage->keyCount;
+                bloomFilter.reset(new BloomFilter(capacity));
+            }
+            const std::size_t count = std::min<std::size_t>(BLOOM_PAGE_WORDS,
+                                                            bloomFilter->data().size() - words.size());
+            words.insert(words.end(), filterPage->words, filterPage->words + count);
+            bloomPages.push_back(pageNo);
+            pageNo = filterPage->nextPageNo;
+        }
+        bloomFilter->load(words, keyCount);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::writeBloomFilter
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::writeBloomFilter() {
+        const std::vector<std::uint32_t>& words = bloomFilter->data();
+        const std::size_t numPages = (words.size() + BLOOM_PAGE_WORDS - 1) / BLOOM_PAGE_WORDS;
+        while (bloomPages.size() < numPages) {
+            PageId pageNo;
+            bufMgr->allocPage(file, pageNo).release();
+            bloomPages.push_back(pageNo);
+        }
+
+        for (std::size_t p = 0; p < numPages; p++) {
+            PageHandle page = bufMgr->readPage(file, bloomPages[p]);
+            auto filterPage = (BloomFilterPage*) page.page();
+            filterPage->capacity = bloomFilter->keyCapacity();
+            filterPage->keyCount = bloomFilter->keyCount();
+            filterPage->nextPageNo = p + 1 < numPages ? bloomPages[p + 1] : Page::INVALID_NUMBER;
+            const std::size_t first = p * BLOOM_PAGE_WORDS;
+            const std::size_t count = std::min<std::size_t>(BLOOM_PAGE_WORDS, words.size() - first);
+            std::copy(words.begin() + first, words.begin() + first + count, filterPage->words);
+            page.markDirty();
+        }
+
+        PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+        ((IndexMetaInfo*) headerPage.page())->bloomPageNo = bloomPages[0];
+        headerPage.markDirty();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::snapshot
+    // -----------------------------------------------------------------------------
+    BTreeIndex* BTreeIndex::snapshot() {
+        auto mappedFile = dynamic_cast<MappedBlobFile*>(file);
+        if (mappedFile == nullptr || !mappedFile->shadowing())
+            throw BadIndexInfoException("Error: Only indexes in shadow files can be snapshotted.");
+
+        // Pages still in the buffer pool are written first, so the snapshot sees all entries
+        checkpoint();
+        return new BTreeIndex(*this, mappedFile->snapshot());
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::setResidentLevels
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::setResidentLevels(const int levels) {
+        residentLevels = levels > 0 ? levels : 0;
+        refreshResidentLevels();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::refreshResidentLevels
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::refreshResidentLevels() {
+        residentNodes.clear();
+        residentPages.clear();
+        if (residentLevels == 0)
+            return;
+
+        const std::size_t maxPages = bufMgr->getNumBufs() / 4;
+        if (maxPages == 0)
+            return;
+        if (subtreeCounts)
+            pinResidentLevels<CountedNonLeafNodeInt>(maxPages);
+        else
+            pinResidentLevels<NonLeafNodeInt>(maxPages);
+
+        // Parents may refer to a resident node by page number or by its swizzled frame
+        for (const PageHandle& page : residentPages) {
+            residentNodes[page.pageNo()] = page.page();
+            residentNodes[page.frameNo() | SWIZZLED_BIT] = page.page();
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::pinResidentLevels
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    void BTreeIndex::pinResidentLevels(const std::size_t maxPages) {
+        residentPages.push_back(bufMgr->readPage(file, rootPageNum));
+
+        std::size_t levelStart = 0;
+        for (int depth = 1; depth < residentLevels; depth++) {
+            const std::size_t levelEnd = residentPages.size();
+
+            // Count the children first, a level is only made resident as a whole
+            std::size_t children = 0;
+            for (std::size_t n = levelStart; n < levelEnd; n++) {
+                auto node = (const Node*) residentPages[n].page();
+                if (node->level == 1) {
+                    children = 0;
+                    break;
+                }
+                for (int i = 0; i <= Node::SIZE && node->pageNoArray[i] != Page::INVALID_NUMBER; i++)
+                    children++;
+            }
+            if (children == 0 || levelEnd + children > maxPages)
+                break;
+
+            residentPages.reserve(levelEnd + children);
+            for (std::size_t n = levelStart; n < levelEnd; n++) {
+                auto node = (const Node*) residentPages[n].page();
+                for (int i = 0; i <= Node::SIZE && node->pageNoArray[i] != Page::INVALID_NUMBER; i++)
+                    residentPages.push_back(readChild<Node>(residentPages[n], i));
+            }
+            levelStart = levelEnd;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::readChild
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    PageHandle BTreeIndex::readChild(const PageHandle& parent, const int idx) {
+        auto node = (Node*) parent.page();
+        const PageId ref = node->pageNoArray[idx];
+
+        // Swizzled references name the frame of the child directly
+        if (ref & SWIZZLED_BIT)
+            return bufMgr->readSwizzled(ref);
+
+        PageHandle child = bufMgr->readPage(file, ref);
+        if (bufMgr->swizzle(parent, child, this))
+            node->pageNoArray[idx] = SWIZZLED_BIT | child.frameNo();
+
+        return child;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::unswizzle
+    // -----------------------------------------------------------------------------
+    void BTreeIndex::unswizzle(Page* parent, const FrameId childFrame, const PageId childPageNo) {
+        if (subtreeCounts)
+            unswizzleChild((CountedNonLeafNodeInt*) parent, childFrame, childPageNo);
+        else
+            unswizzleChild((NonLeafNodeInt*) parent, childFrame, childPageNo);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BTreeIndex::unswizzleChild
+    // -----------------------------------------------------------------------------
+    template<class Node>
+    void BTreeIndex::unswizzleChild(Node* node, const FrameId childFrame, const PageId childPageNo) {
+        for (int i = 0; i <= Node::SIZE; i++) {
+            if (node->pageNoArray[i] == (SWIZZLED_BIT | childFrame)) {
+                node->pageNoArray[i] = childPageNo;
+                return;
             }
-            getFirstParent(nonLeafNode->pageNoArray[i]);
         }
     }
 
@@ -670,33 +1433,33 @@ namespace badgerdb
         if (!scanExecuting)
             throw ScanNotInitializedException();
 
+        // Check that the scan has not already run off the last leaf page
+        if (!currentPage.valid())
+            throw IndexScanCompletedException();
+
         // Keep track of node being evaluated
-        auto currentNode = (LeafNodeInt*) currentPageData;
+        auto currentNode = (LeafNodeInt*) currentPage.page();
 
         // Look for record id of next matching tuple
         while (true) {
             // Validate index of entry to be evaluated
             if (nextEntry == INTARRAYLEAFSIZE) {
-                // Unpin page since no more entries to be scanned on this leaf page
-                try {
-                    bufMgr->unPinPage(file, currentPageNum, false);
-                } catch (PageNotPinnedException& e) {
-                    // Do nothing.
-                }
-
                 // Move to right sibling leaf page
                 PageId rightSibPageNo = currentNode->rightSibPageNo;
 
                 // Check that the right sibling is a valid leaf page
-                if (rightSibPageNo == Page::INVALID_NUMBER)
+                if (rightSibPageNo == Page::INVALID_NUMBER) {
+                    // Unpin page since no more entries to be scanned on this leaf page
+                    currentPage.release();
                     // No more entries to be scanned.
                     throw IndexScanCompletedException();
+                }
 
-                // Update the parameters for the index since leaf page is invalid
+                // Update the parameters for the index since leaf page is invalid.
+                // Assigning the handle unpins the leaf page that has been scanned.
                 nextEntry = 0;
-                currentPageNum = rightSibPageNo;
-                bufMgr->readPage(file, currentPageNum, currentPageData);
-                currentNode = (LeafNodeInt*) currentPageData;
+                currentPage = bufMgr->readPage(file, rightSibPageNo);
+                currentNode = (LeafNodeInt*) currentPage.page();
             }
 
             if (currentNode->ridArray[nextEntry].page_number == Page::INVALID_NUMBER) {
@@ -741,14 +1504,8 @@ namespace badgerdb
         // Terminate the current scan
         scanExecuting = false;
 
-        // Unpin the pages that are currently pinned
-        try {
-            bufMgr->unPinPage(file, currentPageNum, false);
-        } catch (PageNotPinnedException& e) {
-            // Do nothing.
-        } catch (HashNotFoundException& e) {
-            // Do nothing.
-        }
+        // Unpin the page that is currently pinned
+        currentPage.release();
     }
 
 }
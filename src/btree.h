@@ -18,14 +18,20 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
+#include <random>
 #include <string>
 #include "string.h"
 #include <sstream>
+#include <unordered_map>
+#include <vector>
 
 #include "types.h"
 #include "page.h"
 #include "file.h"
 #include "buffer.h"
+#include "bloom_filter.h"
+#include "learned_model.h"
 
 namespace badgerdb
 {
@@ -40,6 +46,30 @@ namespace badgerdb
         STRING = 2
     };
 
+/**
+ * @brief Format of the index file. Passed to the BTreeIndex constructor.
+ */
+    enum IndexFileFormat
+    {
+        PLAIN_FILE = 0,			/* BlobFile */
+        COMPRESSED_FILE = 1,	/* CompressedBlobFile */
+        MAPPED_FILE = 2,		/* MappedBlobFile */
+        SHADOW_FILE = 3			/* MappedBlobFile in shadow mode, for checkpoints and snapshots */
+    };
+
+/**
+ * @brief Kind of index stored in an index file. All kinds name their file after the relation and the
+ * attribute offset, so an index only opens a file holding its own kind.
+ */
+    enum IndexKind
+    {
+        BTREE_INDEX = 1,		/* BTreeIndex */
+        BEPSILON_INDEX = 2,		/* BEpsilonTreeIndex */
+        BWTREE_INDEX = 3,		/* BwTreeIndex */
+        HASH_INDEX = 4,			/* HashIndex */
+        ART_INDEX = 5			/* ArtIndex */
+    };
+
 /**
  * @brief Scan operations enumeration. Passed to BTreeIndex::startScan() method.
  */
@@ -53,16 +83,51 @@ namespace badgerdb
 
 
 /**
- * @brief Number of key slots in B+Tree leaf for INTEGER key.
+ * @brief Number of key slots in B+Tree leaf for INTEGER key, derived from Page::SIZE at compile time.
  */
 //                                                  sibling ptr             key               rid
-    const  int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+    constexpr int INTARRAYLEAFSIZE = ( Page::SIZE - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
 
 /**
- * @brief Number of key slots in B+Tree non-leaf for INTEGER key.
+ * @brief Number of keys in a block of a B+Tree non-leaf node for INTEGER key; a block fills one 64-byte cache line.
  */
-//                                                     level     extra pageNo                  key       pageNo
-    const  int INTARRAYNONLEAFSIZE = ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( PageId ) );
+    constexpr int NONLEAF_BLOCK_KEYS = 16;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for INTEGER key, derived from Page::SIZE at compile time.
+ * It is a multiple of NONLEAF_BLOCK_KEYS; every block of keys also takes a directory entry.
+ */
+//                                                                         level     extra pageNo                                             key       pageNo         directory entry
+    constexpr int INTARRAYNONLEAFSIZE = NONLEAF_BLOCK_KEYS * ( ( Page::SIZE - sizeof( int ) - sizeof( PageId ) ) / ( NONLEAF_BLOCK_KEYS * ( sizeof( int ) + sizeof( PageId ) ) + sizeof( int ) ) );
+
+/**
+ * @brief Number of entries in the directory of a B+Tree non-leaf node for INTEGER key, one per block of keys.
+ */
+    constexpr int NONLEAF_DIRECTORY_SIZE = INTARRAYNONLEAFSIZE / NONLEAF_BLOCK_KEYS;
+
+/**
+ * @brief Number of key slots in B+Tree non-leaf for INTEGER key in an index that keeps subtree counts.
+ * The count of every child takes room from the keys, so only such indexes use this smaller fanout.
+ */
+//                                                                                 level     extra pageNo     extra count                                             key       pageNo            count         directory entry
+    constexpr int INTARRAYCOUNTEDNONLEAFSIZE = NONLEAF_BLOCK_KEYS * ( ( Page::SIZE - sizeof( int ) - sizeof( PageId ) - sizeof( std::uint32_t ) ) / ( NONLEAF_BLOCK_KEYS * ( sizeof( int ) + sizeof( PageId ) + sizeof( std::uint32_t ) ) + sizeof( int ) ) );
+
+/**
+ * @brief Number of entries in the directory of a counted B+Tree non-leaf node for INTEGER key.
+ */
+    constexpr int COUNTED_NONLEAF_DIRECTORY_SIZE = INTARRAYCOUNTEDNONLEAFSIZE / NONLEAF_BLOCK_KEYS;
+
+/**
+ * @brief Version of the layout of B+Tree nodes, recorded in the meta page. It goes up whenever the layout
+ * changes, so a file written with another layout is rejected instead of misread.
+ */
+    constexpr int BTREE_LAYOUT_VERSION = 3;
+
+/**
+ * @brief Number of leaves sample() scans at most for a range in an index without subtree counts. A range within
+ * that many leaves is sampled from its entries, since random slots in so few leaves would mostly miss it.
+ */
+    constexpr int SAMPLE_SCAN_LEAVES = 8;
 
 /**
  * @brief Structure to store a key-rid pair. It is used to pass the pair to functions that
@@ -110,6 +175,27 @@ namespace badgerdb
             return r1.rid.page_number < r2.rid.page_number;
     }
 
+/**
+ * @brief Run of consecutive leaves of a range below one level-1 node. sample() lists the leaves a range
+ * overlaps as runs, so it can pick one of them by its position.
+*/
+    struct SampleLeafRun{
+        /**
+         * Page number of the level-1 node.
+         */
+        PageId parentPageNo;
+
+        /**
+         * Index of the first leaf of the run among the children of the node.
+         */
+        int firstChild;
+
+        /**
+         * Number of leaves of the range in the runs before this one.
+         */
+        std::uint64_t leavesBefore;
+    };
+
 /**
  * @brief The meta page, which holds metadata for Index file, is always first page of the btree index file and is cast
  * to the following structure to store or retrieve information from it.
@@ -138,6 +224,26 @@ namespace badgerdb
          * Page number of root page of the B+ Tree inside the file index file.
          */
         PageId rootPageNo;
+
+        /**
+         * Page number of the first page of the Bloom filter of the B+ Tree, Page::INVALID_NUMBER if it has none.
+         */
+        PageId bloomPageNo;
+
+        /**
+         * True if the non-leaf nodes are CountedNonLeafNodeInt, counting the entries below each of their children.
+         */
+        bool subtreeCounts;
+
+        /**
+         * Kind of index stored in the file.
+         */
+        IndexKind indexKind;
+
+        /**
+         * Version of the node layout the B+Tree was written with.
+         */
+        int layoutVersion;
     };
 
 /*
@@ -149,18 +255,36 @@ at this level are just above the leaf nodes. Otherwise set to 0.
 
 /**
  * @brief Structure for all non-leaf nodes when the key is of INTEGER type.
+ * The keys come first, so each block of NONLEAF_BLOCK_KEYS keys starts at a multiple of 64 bytes into the
+ * page. The directory holds the last key of every block, so a search reads the directory and then a single
+ * block instead of every key before the one it looks for.
 */
     struct NonLeafNodeInt{
         /**
-         * Level of the node in the tree.
+         * Number of key slots.
          */
-        int level;
+        static constexpr int SIZE = INTARRAYNONLEAFSIZE;
+
+        /**
+         * Number of directory entries.
+         */
+        static constexpr int DIRECTORY_SIZE = NONLEAF_DIRECTORY_SIZE;
 
         /**
          * Stores keys.
          */
         int keyArray[ INTARRAYNONLEAFSIZE ];
 
+        /**
+         * Last key of each block of keys, INT_MAX for a block that is not full.
+         */
+        int directory[ NONLEAF_DIRECTORY_SIZE ];
+
+        /**
+         * Level of the node in the tree.
+         */
+        int level;
+
         /**
          * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
          */
@@ -168,6 +292,48 @@ at this level are just above the leaf nodes. Otherwise set to 0.
     };
 
 
+/**
+ * @brief Structure for all non-leaf nodes of an index that keeps subtree counts, when the key is of INTEGER
+ * type. It is laid out like NonLeafNodeInt, with fewer key slots, and counts the entries below each child.
+*/
+    struct CountedNonLeafNodeInt{
+        /**
+         * Number of key slots.
+         */
+        static constexpr int SIZE = INTARRAYCOUNTEDNONLEAFSIZE;
+
+        /**
+         * Number of directory entries.
+         */
+        static constexpr int DIRECTORY_SIZE = COUNTED_NONLEAF_DIRECTORY_SIZE;
+
+        /**
+         * Stores keys.
+         */
+        int keyArray[ INTARRAYCOUNTEDNONLEAFSIZE ];
+
+        /**
+         * Last key of each block of keys, INT_MAX for a block that is not full.
+         */
+        int directory[ COUNTED_NONLEAF_DIRECTORY_SIZE ];
+
+        /**
+         * Level of the node in the tree.
+         */
+        int level;
+
+        /**
+         * Stores page numbers of child pages which themselves are other non-leaf/leaf nodes in the tree.
+         */
+        PageId pageNoArray[ INTARRAYCOUNTEDNONLEAFSIZE + 1 ];
+
+        /**
+         * Number of entries below each child.
+         */
+        std::uint32_t countArray[ INTARRAYCOUNTEDNONLEAFSIZE + 1 ];
+    };
+
+
 /**
  * @brief Structure for all leaf nodes when the key is of INTEGER type.
 */
@@ -189,12 +355,48 @@ at this level are just above the leaf nodes. Otherwise set to 0.
         PageId rightSibPageNo;
     };
 
+/**
+ * @brief Number of Bloom filter words in a Bloom filter page.
+ */
+//                                                     capacity, key count          next page
+    constexpr int BLOOM_PAGE_WORDS = ( Page::SIZE - 2 * sizeof( std::uint64_t ) - sizeof( PageId ) ) / sizeof( std::uint32_t );
+
+/**
+ * @brief Structure for the pages holding the Bloom filter of a B+Tree. The filter words are spread over
+ * a chain of pages; the capacity and key count are kept in the first one.
+*/
+    struct BloomFilterPage{
+        /**
+         * Number of keys the filter is sized for.
+         */
+        std::uint64_t capacity;
+
+        /**
+         * Number of keys added to the filter.
+         */
+        std::uint64_t keyCount;
+
+        /**
+         * Page number of the next page of the filter.
+         */
+        PageId nextPageNo;
+
+        /**
+         * Stores filter words.
+         */
+        std::uint32_t words[ BLOOM_PAGE_WORDS ];
+    };
+
+    static_assert(sizeof(NonLeafNodeInt) <= Page::SIZE && sizeof(CountedNonLeafNodeInt) <= Page::SIZE && sizeof(LeafNodeInt) <= Page::SIZE
+                  && sizeof(IndexMetaInfo) <= Page::SIZE && sizeof(BloomFilterPage) <= Page::SIZE,
+                  "B+Tree nodes must fit into a page.");
+
 
 /**
  * @brief BTreeIndex class. It implements a B+ Tree index on a single attribute of a
  * relation. This index supports only one scan at a time.
 */
-    class BTreeIndex {
+    class BTreeIndex : public SwizzleOwner {
 
     private:
 
@@ -238,6 +440,77 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          */
         int			nodeOccupancy;
 
+        /**
+         * Number of levels, counted from the root, whose non-leaf nodes are kept pinned in the buffer pool.
+         */
+        int			residentLevels;
+
+        /**
+         * Handles pinning the non-leaf nodes of the resident levels.
+         */
+        std::vector<PageHandle>	residentPages;
+
+        /**
+         * Resident non-leaf nodes by page number and by swizzled reference. They are read directly, without going
+         * through the buffer manager.
+         */
+        std::unordered_map<PageId, const Page*>	residentNodes;
+
+        /**
+         * True for an index returned by snapshot(), which cannot be modified.
+         */
+        bool		readOnly;
+
+        /**
+         * Bloom filter over all keys in the index, NULL if the index has none.
+         */
+        std::unique_ptr<BloomFilter>	bloomFilter;
+
+        /**
+         * Pages of the index file holding the Bloom filter, in order.
+         */
+        std::vector<PageId>	bloomPages;
+
+        /**
+         * Number of lookups the Bloom filter answered without a descent.
+         */
+        std::uint64_t	bloomRejects;
+
+        /**
+         * True if searches of non-leaf nodes go through their directory, false to read their keys in order.
+         */
+        bool		directorySearch;
+
+        /**
+         * True if the non-leaf nodes are CountedNonLeafNodeInt, counting the entries below each child, updated by every insert.
+         */
+        bool		subtreeCounts;
+
+        /**
+         * Source of the random choices of sample().
+         */
+        std::mt19937	sampleGenerator;
+
+        /**
+         * Model of the positions of the keys in the leaves, NULL if none was trained or the index changed since.
+         */
+        std::unique_ptr<PiecewiseLinearModel>	learnedModel;
+
+        /**
+         * Leaves in key order, as of training the model.
+         */
+        std::vector<PageId>	learnedLeaves;
+
+        /**
+         * Position of the first entry of each leaf in learnedLeaves, followed by the number of entries.
+         */
+        std::vector<std::uint64_t>	learnedLeafPositions;
+
+        /**
+         * Number of lookups answered through the model.
+         */
+        std::uint64_t	learnedLookups;
+
 
         // MEMBERS SPECIFIC TO SCANNING
 
@@ -252,14 +525,9 @@ at this level are just above the leaf nodes. Otherwise set to 0.
         int			nextEntry;
 
         /**
-         * Page number of current page being scanned.
+         * Handle of the current page being scanned. The page stays pinned while the scan is on it.
          */
-        PageId	currentPageNum;
-
-        /**
-         * Current Page being scanned.
-         */
-        Page		*currentPageData;
+        PageHandle	currentPage;
 
         /**
          * Low INTEGER value for scan.
@@ -313,15 +581,25 @@ at this level are just above the leaf nodes. Otherwise set to 0.
         PageId splitLeafNode(LeafNodeInt* dataNode, int& intKey, RecordId rid);
 
 
+        /**
+         * Inserts an entry into a tree whose non-leaf nodes are of the given type, splitting nodes on the way up.
+         * @param intKey		Integer representation of the key being inserted.
+         * @param rid			Record ID of a record whose entry is getting inserted into the index.
+         */
+        template<class Node>
+        void insertInTree(int intKey, RecordId rid);
+
         /**
          * Splits the non-leaf node and returns pointer to a page containing the new node.
          *
          * @param node			The non-leaf node to be split.
          * @param intKey		Integer representation of the key being inserted.
          * @param pageId		PageId of the page where the new key was inserted.
+         * @param leftCount		Number of entries left in the child that split, for the subtree counts.
          * @return Page Id of the page containing the new node.
          */
-        PageId splitNonLeafNode(NonLeafNodeInt* node, int& intKey, PageId pageId);
+        template<class Node>
+        PageId splitNonLeafNode(Node* node, int& intKey, PageId pageId, std::uint32_t leftCount);
 
         /**
          * Insert a key and record Id pair into a leaf node
@@ -337,9 +615,11 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * @param node   The node to insert the key into
          * @param key    The key to be inserted
          * @param pageId The pageId to be inserted
+         * @param leftCount Number of entries left in the child that split, for the subtree counts
          * @return True if the entry was inserted, false otherwise
          */
-        bool insertKeyInNonLeafNode(NonLeafNodeInt* node, int key, PageId pageId);
+        template<class Node>
+        bool insertKeyInNonLeafNode(Node* node, int key, PageId pageId, std::uint32_t leftCount);
 
         /**
          * Clears the Leaf node entry at index i
@@ -353,13 +633,179 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * @param node The node that contains the entry to be cleared
          * @param i The index of the entry
          */
-        void clearNonLeafNodeAtIdx(NonLeafNodeInt* node, int idx);
+        template<class Node>
+        void clearNonLeafNodeAtIdx(Node* node, int idx);
+
+        /**
+         * Clears all entries of a non-leaf node and sets its level
+         * @param node  The node
+         * @param level Level of the node, 1 if its children are leaves
+         */
+        template<class Node>
+        void initNonLeafNode(Node* node, int level);
+
+        /**
+         * Sets the directory of a non-leaf node from its keys. Must be called after the keys of the node changed.
+         * @param node The node
+         */
+        template<class Node>
+        void updateDirectory(Node* node);
+
+        /**
+         * Finds the first key slot of a non-leaf node that is empty or holds a key above the given one,
+         * or not below it if pastEqual is false. Uses the directory unless directorySearch is false.
+         * @param node		The node
+         * @param key		Key to search for
+         * @param pastEqual	True to pass over slots holding the key
+         * @return Index of the slot; the child left of it covers the key
+         */
+        template<class Node>
+        int searchNonLeafNode(const Node* node, int key, bool pastEqual) const;
+
+        /**
+         * Counts the entries with a key below the given one, or not above it if inclusive is true, from the
+         * subtree counts of the nodes on the path to the leaf the key would go to.
+         * @param key		Key to compare with
+         * @param inclusive	True to count the entries with the key too
+         * @return Number of entries
+         */
+        std::uint64_t countBelow(int key, bool inclusive);
+
+        /**
+         * Returns the number of entries below a non-leaf node, the sum of its subtree counts. 0 without counts.
+         * @param node The node
+         */
+        template<class Node>
+        std::uint32_t nodeEntryCount(const Node* node) const;
+
+        /**
+         * Returns the number of entries in a leaf node.
+         * @param node The node
+         */
+        std::uint32_t leafEntryCount(const LeafNodeInt* node) const;
+
+        /**
+         * Finds the leaf node holding the first entry to be scanned and keeps it pinned as the current page
+         * @throws  NoSuchKeyFoundException If the index is empty
+         */
+        void getFirstParent();
+
+        /**
+         * Descends from the root to the leaf node that may hold the key, pinning each node until its child is pinned.
+         * Resident nodes are read directly, without any buffer pool access.
+         * @param key		Key to search for
+         * @return Handle of the pinned leaf node, empty handle if the index is empty
+         * @throws  BufferExceededException If the buffer pool cannot hold a node and its child at once
+         */
+        PageHandle findLeaf(int key);
+
+        /**
+         * Looks up a resident non-leaf node.
+         * @param ref		Page number of the node, or swizzled reference to its frame
+         * @return The node, NULL if it is not resident
+         */
+        const Page* residentNode(PageId ref) const;
+
+        /**
+         * Descends like findLeaf() through non-leaf nodes of the given type.
+         * @param key		Key to search for
+         * @return Handle of the pinned leaf node, empty handle if the index is empty
+         */
+        template<class Node>
+        PageHandle findLeafIn(int key);
+
+        /**
+         * Appends the page numbers of all nodes, level by level from the root, to a list of pages.
+         * @param order		List to append to
+         */
+        template<class Node>
+        void appendTreePages(std::vector<PageId>& order);
+
+        /**
+         * Appends the leaves of a range below a non-leaf node to a list of runs, in key order.
+         * @param page		Handle of the pinned non-leaf node
+         * @param lowKey	Lowest key of the range
+         * @param highKey	Highest key of the range
+         * @param runs		List of runs to append to
+         * @param leaves	Number of leaves in the list, updated
+         */
+        void appendLeafRuns(const PageHandle& page, int lowKey, int highKey, std::vector<SampleLeafRun>& runs,
+                            std::uint64_t& leaves);
+
+        /**
+         * Pins the non-leaf nodes of the top residentLevels levels again after the structure of the tree
+         * changed. A level is only made resident if all of its nodes fit, together with the levels above,
+         * into a quarter of the buffer pool.
+         */
+        void refreshResidentLevels();
+
+        /**
+         * Pins the nodes of the resident levels into residentPages, level by level from the root.
+         * @param maxPages	Number of pages the resident levels may take
+         */
+        template<class Node>
+        void pinResidentLevels(std::size_t maxPages);
+
+        /**
+         * Finds the entry with the given key in the leaves the model predicts for it.
+         * @param key			Key to search for
+         * @param outRid		RecordId of the entry returned in this
+         * @throws  NoSuchKeyFoundException If there is no entry with the key in the B+ tree.
+         */
+        void learnedLookup(int key, RecordId& outRid);
+
+        /**
+         * Replaces the Bloom filter by one sized for the given number of keys, holding all keys in the leaves.
+         * @param capacity	Number of keys to size the filter for
+         */
+        void rebuildBloomFilter(std::uint64_t capacity);
+
+        /**
+         * Reads the Bloom filter from its pages.
+         * @param pageNo	First page of the filter
+         */
+        void readBloomFilter(PageId pageNo);
 
         /**
-         * Scans the tree to search for first non-leaf node to be scanned
-         * @param pageNum	PageId of the next non-leaf node to be scanned
+         * Writes the Bloom filter to its pages, adding pages as it grows, and records it in the meta page.
          */
-        void getFirstParent(PageId pageNum);
+        void writeBloomFilter();
+
+        /**
+         * Reads the child of a non-leaf node. If the reference to the child is swizzled, the child's frame is
+         * pinned directly. Otherwise the child is read through the buffer manager and, if swizzling is enabled
+         * there, the reference inside the parent is swizzled to the child's frame.
+         * @param parent	Handle of the pinned non-leaf node
+         * @param idx		Index of the child in the pageNoArray of the node
+         * @return Handle of the pinned child
+         */
+        template<class Node>
+        PageHandle readChild(const PageHandle& parent, int idx);
+
+        /**
+         * Restores the page number of a child in a non-leaf node whose reference was swizzled.
+         * Called back by the buffer manager before the child leaves the buffer pool.
+         * @param parent		Non-leaf node holding the swizzled reference
+         * @param childFrame	Frame the child is held in
+         * @param childPageNo	Page number of the child
+         */
+        void unswizzle(Page* parent, FrameId childFrame, PageId childPageNo) override;
+
+        /**
+         * Restores the page number of a swizzled child in a non-leaf node of the given type.
+         * @param node			Non-leaf node holding the swizzled reference
+         * @param childFrame	Frame the child is held in
+         * @param childPageNo	Page number of the child
+         */
+        template<class Node>
+        void unswizzleChild(Node* node, FrameId childFrame, PageId childPageNo);
+
+        /**
+         * Constructs a read-only index on a snapshot of the file of another index.
+         * @param index		Index the snapshot was taken of
+         * @param snapshot	Snapshot of its file, owned by the new index
+         */
+        BTreeIndex(const BTreeIndex& index, SnapshotFile* snapshot);
 
     public:
 
@@ -373,10 +819,14 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * @param bufMgrIn			  Buffer Manager Instance
          * @param attrByteOffset	  Offset of attribute, over which index is to be built, in the record
          * @param attrType			  Datatype of attribute over which index is built
-         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters.
+         * @param format			  Format of a newly created index file. An existing file is opened in the format it was created in.
+         * @param bloom				  Whether a newly created index keeps a Bloom filter over its keys. An existing file keeps the filter it was created with.
+         * @param counts			  Whether a newly created index keeps subtree counts for countRange(), rank() and select(). An existing file keeps them if it was created with them.
+         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters, or the file holds another kind of index or was written with another node layout.
          */
         BTreeIndex(const std::string & relationName, std::string & outIndexName,
-                   BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+                   BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+                   const IndexFileFormat format = PLAIN_FILE, const bool bloom = false, const bool counts = false);
 
 
         /**
@@ -396,10 +846,184 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * Make sure to unpin pages as soon as you can.
          * @param key			Key to insert, pointer to integer/double/char string
          * @param rid			Record ID of a record whose entry is getting inserted into the index.
+         * Drops the model trained by trainLearnedModel(), if any.
+         * @throws  BadIndexInfoException If the index is a read-only snapshot
          */
         void insertEntry(const void* key, RecordId rid);
 
 
+        /**
+         * Find the record id of the entry with the given key.
+         * If the index has a Bloom filter, keys it rules out are not searched for. If a model was trained,
+         * the leaves it predicts are searched directly. Otherwise
+         * non-leaf nodes on the way down are pinned until their child is pinned, unless they are resident.
+         * @param key			Key to search for, pointer to integer/double/char string
+         * @param outRid		RecordId of the entry returned in this
+         * @throws  NoSuchKeyFoundException If there is no entry with the key in the B+ tree.
+         */
+        void lookup(const void* key, RecordId& outRid);
+
+
+        /**
+         * Count the entries in a range from the subtree counts, reading one path from the root to a leaf
+         * for each end of the range rather than the entries in it.
+         * @param lowVal	Low value of range, pointer to integer
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer
+         * @param highOp	High operator (LT/LTE)
+         * @return Number of entries in the range
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+         * @throws  BadIndexInfoException If the index does not keep subtree counts
+         */
+        std::uint64_t countRange(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+        /**
+         * Returns the number of entries with a key below the given one, its position among the entries in key order.
+         * @param key			Key to search for, pointer to integer
+         * @throws  BadIndexInfoException If the index does not keep subtree counts
+         */
+        std::uint64_t rank(const void* key);
+
+
+        /**
+         * Find the entry at a position among the entries in key order, counting from 0.
+         * @param k				Position of the entry
+         * @param outKey		Key of the entry returned in this, pointer to integer
+         * @param outRid		RecordId of the entry returned in this
+         * @throws  NoSuchKeyFoundException If the index holds no more than k entries.
+         * @throws  BadIndexInfoException If the index does not keep subtree counts
+         */
+        void select(std::uint64_t k, void* outKey, RecordId& outRid);
+
+
+        /**
+         * Draw entries from a range uniformly at random, with replacement. With subtree counts, each sample
+         * is the entry at a random position in the range, found by select(), reading one path from the root
+         * to a leaf. Without, a range within SAMPLE_SCAN_LEAVES leaves is scanned once and the samples are
+         * drawn from its entries. For a wider range, the non-leaf nodes overlapping it are read once to list
+         * the leaves it overlaps. Each attempt then picks one of these leaves and a slot in it uniformly, reads
+         * the leaf through its level-1 node, and is rejected if the slot holds no entry of the range. Entries
+         * are never deleted, so all leaves but the first and the two at the ends of the range are at least half
+         * full, and a sample takes at most three attempts on average.
+         * @param lowVal	Low value of range, pointer to integer
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer
+         * @param highOp	High operator (LT/LTE)
+         * @param n			Number of entries to draw
+         * @param outSamples	Drawn entries returned in this, in the order they were drawn
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+         * @throws  NoSuchKeyFoundException If there is no key in the index that satisfies the range.
+         */
+        void sample(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp,
+                    std::size_t n, std::vector<RIDKeyPair<int>>& outSamples);
+
+
+        /**
+         * Returns true if the index keeps subtree counts.
+         */
+        bool hasSubtreeCounts() const { return subtreeCounts; }
+
+
+        /**
+         * Lay the index file out for sequential reads: the meta page, the non-leaf nodes level by level
+         * and then the leaves in key order are moved to consecutive pages at the end of the file. Only
+         * files in MAPPED_FILE format can move pages without rewriting the nodes that refer to them.
+         * @return	True if the file was reorganized, false if it is not a mapped file
+         */
+        bool defragment();
+
+
+        /**
+         * Writes the index to its file and, for files in SHADOW_FILE format, commits it: the file opens
+         * in this state after a crash until the next checkpoint. Pinned pages stay in the buffer pool.
+         */
+        void checkpoint();
+
+
+        /**
+         * Checkpoints the index and returns a read-only copy of it as of the checkpoint. The copy reads
+         * the pages of the checkpoint, which the index does not overwrite, so it can be scanned while
+         * entries are inserted into the index. Pages replaced since are reclaimed at the first checkpoint
+         * after the copy is deleted. The copy has to be deleted before the index.
+         * @return	The copy, owned by the caller
+         * @throws  BadIndexInfoException If the index file is not in SHADOW_FILE format
+         */
+        BTreeIndex* snapshot();
+
+
+        /**
+         * Keep the non-leaf nodes of the top levels of the tree pinned in the buffer pool, so they cannot be
+         * evicted and descents read them without any buffer pool access. The resident levels are refreshed
+         * when non-leaf nodes split. Levels that do not fit into a quarter of the buffer pool stay unpinned.
+         * @param levels		Number of levels, counted from the root; 0 unpins all of them
+         */
+        void setResidentLevels(int levels);
+
+
+        /**
+         * Returns the number of non-leaf nodes currently kept pinned by setResidentLevels().
+         */
+        std::size_t residentPageCount() const { return residentPages.size(); }
+
+
+        /**
+         * Returns the file holding the index, e.g. to give it a quota in the buffer manager.
+         */
+        const File* indexFile() const { return file; }
+
+
+        /**
+         * Chooses how non-leaf nodes are searched: through their directory, the default, or by reading
+         * their keys in order until the one searched for. Both find the same child; the directory is
+         * kept up to date either way.
+         * @param enabled		True to search through the directory
+         */
+        void setDirectorySearch(bool enabled) { directorySearch = enabled; }
+
+
+        /**
+         * Trains a piecewise-linear model of the positions of the keys in the leaves, read in key order.
+         * Until the index is modified, lookups find the leaf and the slots that may hold a key from the
+         * model, without reading any non-leaf node. Meant for indexes that no longer change, such as
+         * snapshots; the model is kept in memory only and dropped by the next insert.
+         * @param maxError		Largest distance between the predicted and the actual position of a key
+         */
+        void trainLearnedModel(int maxError = LEARNED_MAX_ERROR);
+
+
+        /**
+         * Returns true if lookups go through a trained model.
+         */
+        bool hasLearnedModel() const { return learnedModel != nullptr; }
+
+
+        /**
+         * Returns the number of segments of the trained model, 0 if there is none.
+         */
+        std::size_t learnedSegmentCount() const { return learnedModel ? learnedModel->segmentCount() : 0; }
+
+
+        /**
+         * Returns the number of lookups answered through a trained model.
+         */
+        std::uint64_t learnedLookupCount() const { return learnedLookups; }
+
+
+        /**
+         * Returns true if the index keeps a Bloom filter over its keys.
+         */
+        bool hasBloomFilter() const { return bloomFilter != nullptr; }
+
+
+        /**
+         * Returns the number of lookups and point scans the Bloom filter answered without a descent.
+         */
+        std::uint64_t bloomRejectCount() const { return bloomRejects; }
+
+
         /**
          * Begin a filtered scan of the index.  For instance, if the method is called
          * using ("a",GT,"d",LTE) then we should seek all entries with a value
@@ -407,6 +1031,7 @@ at this level are just above the leaf nodes. Otherwise set to 0.
          * If another scan is already executing, that needs to be ended here.
          * Set up all the variables for scan. Start from root to find out the leaf page that contains the first RecordID
          * that satisfies the scan parameters. Keep that page pinned in the buffer pool.
+         * A scan for a single key that the Bloom filter rules out fails without a descent.
          * @param lowVal	Low value of range, pointer to integer / double / char string
          * @param lowOp		Low operator (GT/GTE)
          * @param highVal	High value of range, pointer to integer / double / char string
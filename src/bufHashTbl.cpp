@@ -45,6 +45,30 @@ BufHashTbl::~BufHashTbl()
   delete [] ht;
 }
 
+void BufHashTbl::resize(const int htSize)
+{
+  hashBucket** oldHt = ht;
+  const int oldSize = HTSIZE;
+
+  ht = new hashBucket* [htSize];
+  HTSIZE = htSize;
+  for(int i=0; i < HTSIZE; i++)
+    ht[i] = NULL;
+
+  // relink the existing buckets, no entry is copied
+  for(int i = 0; i < oldSize; i++) {
+    while (oldHt[i]) {
+      hashBucket* tmpBuc = oldHt[i];
+      oldHt[i] = tmpBuc->next;
+
+      int index = hash(tmpBuc->file, tmpBuc->pageNo);
+      tmpBuc->next = ht[index];
+      ht[index] = tmpBuc;
+    }
+  }
+  delete [] oldHt;
+}
+
 void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
 {
   int index = hash(file, pageNo);
@@ -104,6 +104,13 @@ class BufHashTbl
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
   void remove(const File* file, const PageId pageNo);  
+
+	/**
+   * Change the number of buckets of the hash table, moving every entry to its new bucket.
+	 *
+	 * @param htSize  New size of the hash table
+	 */
+  void resize(const int htSize);
 };
 
 }
@@ -5,14 +5,21 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <cstdio>
 #include <memory>
 #include <iostream>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/file_open_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/invalid_page_exception.h"
 
 namespace badgerdb { 
 
@@ -21,40 +28,32 @@ namespace badgerdb {
 //----------------------------------------
 
 BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
-
+	: numBufs(bufs), bufDescTable(bufs), useCounter(0), swizzling(false), pageTier(NULL), bufPool(bufs) {
   for (FrameId i = 0; i < bufs; i++) 
   {
   	bufDescTable[i].frameNo = i;
   	bufDescTable[i].valid = false;
   }
 
-  bufPool = new Page[bufs];
-
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  hashTable = new BufHashTbl (hashTableSize(bufs));  // allocate the buffer hash table
 
   clockHand = bufs - 1;
 }
 
 
 BufMgr::~BufMgr() {
-  //Flush out all unwritten pages
-  for (std::uint32_t i = 0; i < numBufs; i++) 
+  //Pages must not reach the disk with swizzled references in them
+  setSwizzling(false);
+
+  //Flush out all unwritten pages, one file at a time
+  for (std::map<const File*, std::set<FrameId> >::iterator it = fileFrameTable.begin();
+       it != fileFrameTable.end(); ++it)
   {
-  	BufDesc* tmpbuf = &bufDescTable[i];
-  	if (tmpbuf->valid == true && tmpbuf->dirty == true)
-		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-  	}
+  	writeDirtyFrames(std::vector<FrameId>(it->second.begin(), it->second.end()));
   }
-
-  delete [] bufDescTable;
-  delete [] bufPool;
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::allocBuf(FrameId & frame, const File* file) 
 {
   // perform first part of clock algorithm to search for 
   // open buffer frame
@@ -62,6 +61,9 @@ void BufMgr::allocBuf(FrameId & frame)
   std::uint32_t numScanned = 0;
   bool found = 0;
 
+  // a file at its quota has to replace one of its own pages
+  const bool atMax = atMaxFrames(file);
+
   while (numScanned < 2*numBufs)	//Need to scn twice
   {
     // advance the clock
@@ -71,18 +73,28 @@ void BufMgr::allocBuf(FrameId & frame)
     // if invalid, use frame
     if (! bufDescTable[clockHand].valid)
     {
+      if (atMax)
+        continue;
+      found = true;
       break;
     }
 
+    // skip frames of other files the quotas do not allow to take
+    if (atMax ? bufDescTable[clockHand].file != file : isReserved(bufDescTable[clockHand].file, file))
+      continue;
+
     // is valid, check referenced bit
     if (! bufDescTable[clockHand].refbit)
     {
-      // check to see if someone has it pinned
-      if (bufDescTable[clockHand].pinCnt == 0)
+      // check to see if someone has it pinned, or if it holds swizzled references to other frames
+      if (bufDescTable[clockHand].pinCnt == 0 && bufDescTable[clockHand].swizzledChildren == 0)
       {
         // hasn't been referenced and is not pinned, use it
+        // turn any swizzled reference to it back into a page number
+        unswizzleFrame(clockHand);
         // remove previous entry from hash table
         hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
+        untrackFrame(clockHand);
         found = true;
         break;
       }
@@ -105,10 +117,16 @@ void BufMgr::allocBuf(FrameId & frame)
   if (bufDescTable[clockHand].dirty)
   {
     bufStats.diskwrites++;
+    if (FileQuota* quota = quotaOf(bufDescTable[clockHand].file))
+      quota->stats.diskwrites++;
     //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
     bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
   }
 
+  // the page is clean now, offer it to the page tier
+  if (pageTier != NULL && bufDescTable[clockHand].valid)
+    pageTier->admit(*bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+
 	//Reset all the BufDesc entry for the frame before returning the frame
   bufDescTable[clockHand].Clear();
 
@@ -117,7 +135,7 @@ void BufMgr::allocBuf(FrameId & frame)
 } // end allocBuf
 
 	
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+FrameId BufMgr::pinPage(File* file, const PageId pageNo)
 {
   // check to see if it is already in the buffer pool
   // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
@@ -128,26 +146,58 @@ void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
 
     // set the referenced bit
     bufDescTable[frameNo].refbit = true;
+    bufDescTable[frameNo].lastUsed = ++useCounter;
     bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
+    if (FileQuota* quota = quotaOf(file))
+      quota->stats.accesses++;
   }
   catch(HashNotFoundException e) //not in the buffer pool, must allocate a new page
   {
     // alloc a new frame
-    allocBuf(frameNo);
+    allocBuf(frameNo, file);
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+    // read the page into the new frame, from the page tier if it holds a copy
+    FileQuota* quota = quotaOf(file);
+    if (quota != NULL)
+      quota->stats.accesses++;
+    if (pageTier != NULL && pageTier->fetch(*file, pageNo, bufPool[frameNo]))
+    {
+      bufStats.tierreads++;
+      if (quota != NULL)
+        quota->stats.tierreads++;
+    }
+    else
+    {
+      bufStats.diskreads++;
+      if (quota != NULL)
+        quota->stats.diskreads++;
+      //status = file->readPage(pageNo, &bufPool[frameNo]);
+      bufPool[frameNo] = file->readPage(pageNo);
+    }
 
     // set up the entry properly
     bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+    bufDescTable[frameNo].lastUsed = ++useCounter;
+    trackFrame(frameNo);
 
     // insert in the hash table
     hashTable->insert(file, pageNo, frameNo);
   }
+
+  return frameNo;
+}
+
+
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+{
+  page = &bufPool[pinPage(file, pageNo)];
+}
+
+
+PageHandle BufMgr::readPage(File* file, const PageId pageNo)
+{
+  const FrameId frameNo = pinPage(file, pageNo);
+  return PageHandle(this, frameNo, pageNo, &bufPool[frameNo]);
 }
 
 
@@ -157,60 +207,168 @@ void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty)
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
 
+  unPinFrame(frameNo, dirty);
+}
+
+
+void BufMgr::unPinFrame(const FrameId frameNo, const bool dirty)
+{
   if (dirty == true) bufDescTable[frameNo].dirty = dirty;
 
   // make sure the page is actually pinned
   if (bufDescTable[frameNo].pinCnt == 0)
   {
-  	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
+  	// the exception keeps a reference to the file name, so it must outlive the exception
+  	static const std::string noFile;
+  	const File* file = bufDescTable[frameNo].file;
+  	throw PageNotPinnedException(file != NULL ? file->filename() : noFile, bufDescTable[frameNo].pageNo, frameNo);
   }
   else bufDescTable[frameNo].pinCnt--;
 }
 
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
+FrameId BufMgr::pinNewPage(File* file, PageId &pageNo)
 {
   FrameId frameNo;
 
   // alloc a new frame
-  allocBuf(frameNo);
+  allocBuf(frameNo, file);
+  if (FileQuota* quota = quotaOf(file))
+    quota->stats.accesses++;
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
   bufPool[frameNo] = file->allocatePage(pageNo);
-  page = &bufPool[frameNo];
 
-  // set up the entry properly
+  // set up the entry properly; the new page may not be on disk yet, so it is
+  // written back even if the caller never changes it
   bufDescTable[frameNo].Set(file, pageNo);
+  bufDescTable[frameNo].dirty = true;
+  bufDescTable[frameNo].lastUsed = ++useCounter;
+  trackFrame(frameNo);
 
   // insert in the hash table
   hashTable->insert(file, pageNo, frameNo);
+
+  return frameNo;
+}
+
+void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
+{
+  page = &bufPool[pinNewPage(file, pageNo)];
+}
+
+PageHandle BufMgr::allocPage(File* file, PageId &pageNo)
+{
+  const FrameId frameNo = pinNewPage(file, pageNo);
+  return PageHandle(this, frameNo, pageNo, &bufPool[frameNo]);
 }
 
 void BufMgr::flushFile(const File* file) 
 {
-  for (std::uint32_t i = 0; i < numBufs; i++)
+  std::map<const File*, std::set<FrameId> >::iterator it = fileFrameTable.find(file);
+  if (it == fileFrameTable.end())
+    return;
+
+  const std::vector<FrameId> frames(it->second.begin(), it->second.end());
+
+  // Make sure every frame can be released before writing anything out
+  for (std::size_t i = 0; i < frames.size(); i++)
 	{
-  	BufDesc* tmpbuf = &(bufDescTable[i]);
-  	if(tmpbuf->valid == true && tmpbuf->file == file)
-		{
-	    if (tmpbuf->pinCnt > 0)
-  			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
-
-	    if (tmpbuf->dirty == true)
-			{
-				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
-    	}
-
-    	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
-  	}
-		else if (tmpbuf->valid == false && tmpbuf->file == file)
+  	BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+  	if (tmpbuf->valid == false)
   		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
+    if (tmpbuf->pinCnt > 0)
+  		throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
+  }
+
+  unswizzleFile(file);
+  writeDirtyFrames(frames);
+  file->sync();
+
+  // the file may be removed or rewritten once it is flushed, so the page tier forgets it
+  if (pageTier != NULL)
+    pageTier->invalidateFile(*file);
+
+  for (std::size_t i = 0; i < frames.size(); i++)
+	{
+  	BufDesc* tmpbuf = &(bufDescTable[frames[i]]);
+    hashTable->remove(file, tmpbuf->pageNo);
+    tmpbuf->Clear();
+  }
+  fileFrameTable.erase(it);
+}
+
+void BufMgr::checkpointFile(const File* file)
+{
+  std::map<const File*, std::set<FrameId> >::iterator it = fileFrameTable.find(file);
+  if (it != fileFrameTable.end())
+  {
+    unswizzleFile(file);
+    writeDirtyFrames(std::vector<FrameId>(it->second.begin(), it->second.end()));
+  }
+  file->sync();
+}
+
+void BufMgr::writeDirtyFrames(const std::vector<FrameId>& frames)
+{
+  std::vector<FrameId> dirtyFrames;
+  for (std::size_t i = 0; i < frames.size(); i++)
+  {
+    if (bufDescTable[frames[i]].dirty)
+      dirtyFrames.push_back(frames[i]);
+  }
+  if (dirtyFrames.empty())
+    return;
+
+  // Sort by page number so runs of consecutive pages can be written together
+  std::sort(dirtyFrames.begin(), dirtyFrames.end(),
+            [this](const FrameId a, const FrameId b)
+            { return bufDescTable[a].pageNo < bufDescTable[b].pageNo; });
+
+  File* file = bufDescTable[dirtyFrames[0]].file;
+  std::vector<const Page*> run;
+  std::size_t start = 0;
+  while (start < dirtyFrames.size())
+  {
+    const PageId firstPageNo = bufDescTable[dirtyFrames[start]].pageNo;
+    std::size_t end = start;
+    run.clear();
+    while (end < dirtyFrames.size() &&
+           bufDescTable[dirtyFrames[end]].pageNo == firstPageNo + (end - start))
+    {
+      run.push_back(&bufPool[dirtyFrames[end]]);
+      end++;
+    }
+
+    file->writePages(firstPageNo, run);
+    for (std::size_t i = start; i < end; i++)
+    {
+      bufDescTable[dirtyFrames[i]].dirty = false;
+      // copies of the old contents are stale now
+      if (pageTier != NULL)
+        pageTier->invalidate(*file, bufDescTable[dirtyFrames[i]].pageNo);
+    }
+
+    start = end;
   }
 }
 
+void BufMgr::trackFrame(const FrameId frame)
+{
+  fileFrameTable[bufDescTable[frame].file].insert(frame);
+}
+
+void BufMgr::untrackFrame(const FrameId frame)
+{
+  std::map<const File*, std::set<FrameId> >::iterator it = fileFrameTable.find(bufDescTable[frame].file);
+  if (it == fileFrameTable.end())
+    return;
+
+  it->second.erase(frame);
+  if (it->second.empty())
+    fileFrameTable.erase(it);
+}
+
 void BufMgr::disposePage(File* file, const PageId pageNo)
 {
 	//Deallocate from file altogether
@@ -218,15 +376,438 @@ void BufMgr::disposePage(File* file, const PageId pageNo)
   FrameId frameNo = 0;
   hashTable->lookup(file, pageNo, frameNo);
 
+	// drop swizzled references from and to the page
+	unswizzleChildren(frameNo);
+	unswizzleFrame(frameNo);
+
 	// clear the page
+	untrackFrame(frameNo);
 	bufDescTable[frameNo].Clear();
 
 	hashTable->remove(file, pageNo);
 
+  // the page must not come back from the page tier
+  if (pageTier != NULL)
+    pageTier->invalidate(*file, pageNo);
+
   // deallocate it in the file	
   file->deletePage(pageNo);
 }
 
+void BufMgr::setSwizzling(const bool enable)
+{
+  if (!enable)
+  {
+    for (std::uint32_t i = 0; i < numBufs; i++)
+      unswizzleFrame(i);
+  }
+  swizzling = enable;
+}
+
+bool BufMgr::swizzle(const PageHandle& parent, const PageHandle& child, SwizzleOwner* owner)
+{
+  if (!swizzling || bufDescTable[child.frameNo()].swizzleParent != NO_FRAME)
+    return false;
+
+  bufDescTable[child.frameNo()].swizzleParent = parent.frameNo();
+  bufDescTable[child.frameNo()].swizzleOwner = owner;
+  bufDescTable[parent.frameNo()].swizzledChildren++;
+  return true;
+}
+
+PageHandle BufMgr::readSwizzled(const PageId ref)
+{
+  const FrameId frameNo = ref & ~SWIZZLED_BIT;
+
+  // set the referenced bit
+  bufDescTable[frameNo].refbit = true;
+  bufDescTable[frameNo].lastUsed = ++useCounter;
+  bufDescTable[frameNo].pinCnt++;
+  if (FileQuota* quota = quotaOf(bufDescTable[frameNo].file))
+    quota->stats.accesses++;
+  return PageHandle(this, frameNo, bufDescTable[frameNo].pageNo, &bufPool[frameNo]);
+}
+
+void BufMgr::unswizzleChildren(const PageHandle& parent)
+{
+  if (parent.valid())
+    unswizzleChildren(parent.frameNo());
+}
+
+void BufMgr::unswizzleChildren(const FrameId parentFrame)
+{
+  if (bufDescTable[parentFrame].swizzledChildren == 0)
+    return;
+
+  // children always belong to the same file as their parent
+  std::map<const File*, std::set<FrameId> >::iterator it =
+      fileFrameTable.find(bufDescTable[parentFrame].file);
+  if (it == fileFrameTable.end())
+    return;
+
+  for (std::set<FrameId>::iterator frame = it->second.begin(); frame != it->second.end(); ++frame)
+  {
+    if (bufDescTable[*frame].swizzleParent == parentFrame)
+      unswizzleFrame(*frame);
+  }
+}
+
+bool BufMgr::atMaxFrames(const File* file) const
+{
+  if (fileQuotas.empty())
+    return false;
+  std::map<const File*, FileQuota>::const_iterator quota = fileQuotas.find(file);
+  return quota != fileQuotas.end() && quota->second.maxFrames > 0
+    && numFramesOf(file) >= quota->second.maxFrames;
+}
+
+bool BufMgr::isReserved(const File* owner, const File* file) const
+{
+  if (fileQuotas.empty() || owner == file)
+    return false;
+  std::map<const File*, FileQuota>::const_iterator quota = fileQuotas.find(owner);
+  return quota != fileQuotas.end() && numFramesOf(owner) <= quota->second.minFrames;
+}
+
+void BufMgr::setFileQuota(const File* file, const std::uint32_t minFrames, const std::uint32_t maxFrames)
+{
+  FileQuota& quota = fileQuotas[file];
+  quota.maxFrames = maxFrames;
+  quota.minFrames = (maxFrames > 0 && minFrames > maxFrames) ? maxFrames : minFrames;
+  quota.stats.clear();
+}
+
+void BufMgr::removeFileQuota(const File* file)
+{
+  fileQuotas.erase(file);
+}
+
+BufStats BufMgr::getFileStats(const File* file) const
+{
+  std::map<const File*, FileQuota>::const_iterator quota = fileQuotas.find(file);
+  return quota != fileQuotas.end() ? quota->second.stats : BufStats();
+}
+
+std::uint32_t BufMgr::numFramesOf(const File* file) const
+{
+  std::map<const File*, std::set<FrameId> >::const_iterator it = fileFrameTable.find(file);
+  return it != fileFrameTable.end() ? it->second.size() : 0;
+}
+
+void BufMgr::setPageTier(PageTier* tier)
+{
+  pageTier = tier;
+}
+
+void BufMgr::resize(const std::uint32_t bufs)
+{
+  if (bufs == 0)
+    throw BufferExceededException();
+
+  if (bufs > numBufs)
+  {
+    // new frames go to the end, the deques keep existing frames in place
+    for (FrameId i = numBufs; i < bufs; i++)
+    {
+      bufDescTable.emplace_back();
+      bufDescTable[i].frameNo = i;
+      bufPool.emplace_back();
+    }
+    numBufs = bufs;
+    hashTable->resize(hashTableSize(bufs));
+    return;
+  }
+
+  // Make sure every frame to be removed can be released before changing anything
+  for (FrameId i = bufs; i < numBufs; i++)
+  {
+    if (bufDescTable[i].valid && bufDescTable[i].pinCnt > 0)
+      throw PagePinnedException(bufDescTable[i].file->filename(), bufDescTable[i].pageNo, i);
+  }
+
+  // Drain the frames: no swizzled reference may point into or out of the removed region,
+  // and dirty pages are written back one file at a time
+  std::map<const File*, std::vector<FrameId> > drained;
+  for (FrameId i = bufs; i < numBufs; i++)
+  {
+    if (!bufDescTable[i].valid)
+      continue;
+    unswizzleChildren(i);
+    unswizzleFrame(i);
+    drained[bufDescTable[i].file].push_back(i);
+  }
+  for (std::map<const File*, std::vector<FrameId> >::iterator it = drained.begin(); it != drained.end(); ++it)
+  {
+    writeDirtyFrames(it->second);
+    for (std::size_t i = 0; i < it->second.size(); i++)
+    {
+      const FrameId frameNo = it->second[i];
+      hashTable->remove(bufDescTable[frameNo].file, bufDescTable[frameNo].pageNo);
+      untrackFrame(frameNo);
+      bufDescTable[frameNo].Clear();
+    }
+  }
+
+  numBufs = bufs;
+  while (bufDescTable.size() > bufs)
+  {
+    bufDescTable.pop_back();
+    bufPool.pop_back();
+  }
+  if (clockHand >= numBufs)
+    clockHand = numBufs - 1;
+  hashTable->resize(hashTableSize(bufs));
+}
+
+std::uint32_t BufMgr::dumpHotPages(const std::string& dumpName) const
+{
+  std::vector<FrameId> frames;
+  for (FrameId i = 0; i < numBufs; i++)
+  {
+    if (bufDescTable[i].valid)
+      frames.push_back(i);
+  }
+
+  // most recently used first
+  std::sort(frames.begin(), frames.end(), [this](const FrameId a, const FrameId b) {
+    return bufDescTable[a].lastUsed > bufDescTable[b].lastUsed;
+  });
+
+  // write to a temporary file first, so a crash never leaves a torn dump behind
+  const std::string tmpName = dumpName + ".tmp";
+  {
+    std::ofstream out(tmpName.c_str(), std::ios::out | std::ios::trunc);
+    if (!out)
+      throw FileOpenException(tmpName);
+
+    out << HOT_PAGES_MAGIC << "\n";
+    for (FrameId frameNo : frames)
+      out << bufDescTable[frameNo].pageNo << " " << bufDescTable[frameNo].file->filename() << "\n";
+    out.flush();
+    if (!out)
+      throw FileOpenException(tmpName);
+  }
+  if (std::rename(tmpName.c_str(), dumpName.c_str()) != 0)
+    throw FileOpenException(dumpName);
+
+  return frames.size();
+}
+
+std::uint32_t BufMgr::restoreHotPages(const std::string& dumpName, const std::vector<File*>& files)
+{
+  std::ifstream in(dumpName.c_str());
+  if (!in)
+    throw FileNotFoundException(dumpName);
+
+  std::string line;
+  if (!std::getline(in, line) || line != HOT_PAGES_MAGIC)
+    return 0;
+
+  // restored pages only go to free frames, nothing resident is evicted
+  std::vector<FrameId> freeFrames;
+  for (FrameId i = numBufs; i > 0; i--)
+  {
+    if (!bufDescTable[i - 1].valid)
+      freeFrames.push_back(i - 1);
+  }
+
+  // pages to restore, with their rank in the dump (0 = most recently used)
+  struct HotPage
+  {
+    File* file;
+    PageId pageNo;
+    std::uint32_t rank;
+  };
+  std::vector<HotPage> hotPages;
+  std::map<const File*, std::uint32_t> planned;
+  std::uint32_t rank = 0;
+  while (hotPages.size() < freeFrames.size() && std::getline(in, line))
+  {
+    std::istringstream fields(line);
+    PageId pageNo;
+    if (!(fields >> pageNo) || fields.get() != ' ')
+      continue;
+    std::string name;
+    std::getline(fields, name);
+
+    File* file = NULL;
+    for (File* candidate : files)
+    {
+      if (candidate->filename() == name)
+        file = candidate;
+    }
+    rank++;
+
+    FrameId frameNo;
+    if (file == NULL)
+      continue;
+    try
+    {
+      hashTable->lookup(file, pageNo, frameNo);
+      continue;
+    }
+    catch (HashNotFoundException&)
+    {
+    }
+    // stay within the quota of the file
+    if (const FileQuota* quota = quotaOf(file))
+    {
+      if (quota->maxFrames > 0 && numFramesOf(file) + planned[file] >= quota->maxFrames)
+        continue;
+    }
+    planned[file]++;
+    HotPage hotPage = {file, pageNo, rank};
+    hotPages.push_back(hotPage);
+  }
+
+  // read the pages back file by file in page number order, consecutive pages with a single read
+  std::sort(hotPages.begin(), hotPages.end(), [](const HotPage& a, const HotPage& b) {
+    return a.file != b.file ? a.file < b.file : a.pageNo < b.pageNo;
+  });
+  hotPages.erase(std::unique(hotPages.begin(), hotPages.end(), [](const HotPage& a, const HotPage& b) {
+    return a.file == b.file && a.pageNo == b.pageNo;
+  }), hotPages.end());
+
+  std::uint32_t restored = 0;
+  std::size_t start = 0;
+  while (start < hotPages.size())
+  {
+    std::size_t end = start + 1;
+    while (end < hotPages.size() && end - start < RESTORE_BATCH_PAGES
+           && hotPages[end].file == hotPages[start].file
+           && hotPages[end].pageNo == hotPages[end - 1].pageNo + 1)
+      end++;
+
+    std::vector<Page*> pages;
+    for (std::size_t i = start; i < end; i++)
+      pages.push_back(&bufPool[freeFrames[restored + i - start]]);
+
+    std::size_t loaded = 0;
+    try
+    {
+      hotPages[start].file->readPages(hotPages[start].pageNo, pages);
+      loaded = pages.size();
+      for (std::size_t i = start; i < end; i++)
+        restoreFrame(freeFrames[restored + i - start], hotPages[i].file, hotPages[i].pageNo, hotPages[i].rank);
+    }
+    catch (InvalidPageException&)
+    {
+      // some page of the run is gone; read the run page by page and skip the missing ones
+      for (std::size_t i = start; i < end; i++)
+      {
+        const FrameId frameNo = freeFrames[restored + loaded];
+        try
+        {
+          hotPages[i].file->readPages(hotPages[i].pageNo, std::vector<Page*>(1, &bufPool[frameNo]));
+        }
+        catch (InvalidPageException&)
+        {
+          continue;
+        }
+        restoreFrame(frameNo, hotPages[i].file, hotPages[i].pageNo, hotPages[i].rank);
+        loaded++;
+      }
+    }
+
+    restored += loaded;
+    start = end;
+  }
+
+  // keep the recency order of the dump: more recently used pages get larger stamps
+  const std::uint64_t base = useCounter;
+  for (std::uint32_t i = 0; i < restored; i++)
+  {
+    const FrameId frameNo = freeFrames[i];
+    bufDescTable[frameNo].lastUsed = base + rank - bufDescTable[frameNo].lastUsed + 1;
+  }
+  useCounter = base + rank + 1;
+
+  return restored;
+}
+
+void BufMgr::restoreFrame(const FrameId frameNo, File* file, const PageId pageNo, const std::uint32_t rank)
+{
+  bufStats.diskreads++;
+  bufDescTable[frameNo].Set(file, pageNo);
+  bufDescTable[frameNo].pinCnt = 0;
+  bufDescTable[frameNo].lastUsed = rank;
+  trackFrame(frameNo);
+  hashTable->insert(file, pageNo, frameNo);
+}
+
+void BufMgr::unswizzleFrame(const FrameId frameNo)
+{
+  BufDesc* child = &bufDescTable[frameNo];
+  if (child->swizzleParent == NO_FRAME)
+    return;
+
+  child->swizzleOwner->unswizzle(&bufPool[child->swizzleParent], frameNo, child->pageNo);
+  bufDescTable[child->swizzleParent].swizzledChildren--;
+  child->swizzleParent = NO_FRAME;
+  child->swizzleOwner = NULL;
+}
+
+void BufMgr::unswizzleFile(const File* file)
+{
+  std::map<const File*, std::set<FrameId> >::iterator it = fileFrameTable.find(file);
+  if (it == fileFrameTable.end())
+    return;
+
+  for (std::set<FrameId>::iterator frame = it->second.begin(); frame != it->second.end(); ++frame)
+    unswizzleFrame(*frame);
+}
+
+PageHandle& PageHandle::operator=(PageHandle&& rhs) noexcept
+{
+  if (this != &rhs)
+  {
+    try
+    {
+      release();
+    }
+    catch (BadgerDbException& e)
+    {
+      // The frame was released behind our back. Nothing left to unpin.
+    }
+    mgr = rhs.mgr;
+    frame = rhs.frame;
+    pageNum = rhs.pageNum;
+    pagePtr = rhs.pagePtr;
+    dirty = rhs.dirty;
+    rhs.mgr = NULL;
+    rhs.pagePtr = NULL;
+    rhs.pageNum = Page::INVALID_NUMBER;
+    rhs.dirty = false;
+  }
+  return *this;
+}
+
+PageHandle::~PageHandle()
+{
+  try
+  {
+    release();
+  }
+  catch (BadgerDbException& e)
+  {
+    // Destructor must not throw.
+  }
+}
+
+void PageHandle::release()
+{
+  if (mgr == NULL)
+    return;
+
+  BufMgr* owner = mgr;
+  mgr = NULL;
+  pagePtr = NULL;
+  pageNum = Page::INVALID_NUMBER;
+  const bool wasDirty = dirty;
+  dirty = false;
+  owner->unPinFrame(frame, wasDirty);
+}
+
 void BufMgr::printSelf(void) 
 {
   BufDesc* tmpbuf;
@@ -9,7 +9,13 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "page_tier.h"
+#include <deque>
 #include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
 
 namespace badgerdb {
 
@@ -18,6 +24,49 @@ namespace badgerdb {
 */
 class BufMgr;
 
+/**
+* @brief Flag bit marking a child reference inside a page as swizzled. The remaining bits of a swizzled
+* reference hold the frame number of the child instead of its page number.
+*/
+const PageId SWIZZLED_BIT = 0x80000000u;
+
+/**
+* @brief Frame number used when no frame is meant
+*/
+const FrameId NO_FRAME = 0xffffffffu;
+
+/**
+* @brief First line of a hot page list written by BufMgr::dumpHotPages()
+*/
+const std::string HOT_PAGES_MAGIC = "badgerdb hot pages 1";
+
+/**
+* @brief Maximum number of consecutive pages read back with a single read by BufMgr::restoreHotPages()
+*/
+const std::uint32_t RESTORE_BATCH_PAGES = 64;
+
+/**
+* @brief Interface for owners of swizzled child references.
+*
+* A page held in the buffer pool may replace the page number of a resident child by a direct reference to
+* the child's frame (SWIZZLED_BIT | frame). Only the owner knows where such references live inside its
+* pages, so the buffer manager calls back into the owner whenever a reference has to be turned back into
+* a page number, e.g. before the child is evicted or the file is flushed.
+*/
+class SwizzleOwner {
+ public:
+	virtual ~SwizzleOwner() {}
+
+	/**
+	 * Replace the swizzled reference to the child frame inside the parent page by the child's page number.
+	 *
+	 * @param parent   	  Parent page, inside the buffer pool, holding the swizzled reference
+	 * @param childFrame  Frame the child is held in
+	 * @param childPageNo Page number of the child
+	 */
+	virtual void unswizzle(Page* parent, const FrameId childFrame, const PageId childPageNo) = 0;
+};
+
 /**
 * @brief Class for maintaining information about buffer pool frames
 */
@@ -61,6 +110,26 @@ class BufDesc {
 	 */
   bool refbit;
 
+	/**
+   * Frame of the parent page holding a swizzled reference to this frame, NO_FRAME if none
+	 */
+  FrameId swizzleParent;
+
+	/**
+   * Owner to call back to unswizzle the reference held by swizzleParent
+	 */
+  SwizzleOwner* swizzleOwner;
+
+	/**
+   * Number of swizzled references to other frames held by this page. Such a page cannot be evicted.
+	 */
+  std::uint32_t swizzledChildren;
+
+	/**
+   * Value of the buffer manager's use counter when the page was last referenced
+	 */
+  std::uint64_t lastUsed;
+
 	/**
    * Initialize buffer frame for a new user
 	 */
@@ -72,6 +141,10 @@ class BufDesc {
     dirty = false;
     refbit = false;
 		valid = false;
+    swizzleParent = NO_FRAME;
+    swizzleOwner = NULL;
+    swizzledChildren = 0;
+    lastUsed = 0;
   };
 
 	/**
@@ -89,6 +162,9 @@ class BufDesc {
     dirty = false;
     valid = true;
     refbit = true;
+    swizzleParent = NO_FRAME;
+    swizzleOwner = NULL;
+    swizzledChildren = 0;
   }
 
   void Print()
@@ -107,8 +183,9 @@ class BufDesc {
 		std::cout << "refbit:" << refbit << "\n";
   }
 
+ public:
 	/**
-   * Constructor of BufDesc class
+   * Constructor of BufDesc class. Public so the descriptor table can construct frames in place.
 	 */
   BufDesc()
 	{
@@ -117,6 +194,125 @@ class BufDesc {
 };
 
 
+/**
+* @brief Movable handle to a page pinned in the buffer pool.
+*
+* A handle is returned by BufMgr::readPage() and BufMgr::allocPage(). It remembers the frame the page
+* was pinned in, so releasing the pin is a direct update of that frame's descriptor instead of another
+* hash table lookup. The pin is released when the handle is destroyed or release() is called. Handles
+* cannot be copied; moving a handle transfers the pin.
+*/
+class PageHandle {
+
+	friend class BufMgr;
+
+ private:
+	/**
+   * Buffer manager the page is pinned in, NULL for an empty handle
+	 */
+  BufMgr* mgr;
+
+	/**
+   * Frame the page is pinned in
+	 */
+  FrameId frame;
+
+	/**
+   * Page number of the pinned page within its file
+	 */
+  PageId pageNum;
+
+	/**
+   * Pointer to the pinned page inside the buffer pool
+	 */
+  Page* pagePtr;
+
+	/**
+   * True if the page has to be marked dirty when the pin is released
+	 */
+  bool dirty;
+
+	/**
+	 * Constructs a handle for a page that has just been pinned in a frame.
+	 *
+	 * @param mgrIn    	Buffer manager the page is pinned in
+	 * @param frameIn   Frame the page is pinned in
+	 * @param pageNumIn Page number of the page
+	 * @param pageIn    Pointer to the page inside the buffer pool
+	 */
+  PageHandle(BufMgr* mgrIn, FrameId frameIn, PageId pageNumIn, Page* pageIn)
+    : mgr(mgrIn), frame(frameIn), pageNum(pageNumIn), pagePtr(pageIn), dirty(false)
+  {
+  }
+
+ public:
+	/**
+   * Constructs an empty handle that holds no pin
+	 */
+  PageHandle()
+    : mgr(NULL), frame(0), pageNum(Page::INVALID_NUMBER), pagePtr(NULL), dirty(false)
+  {
+  }
+
+	/**
+   * Move constructor. The pin held by other is transferred to the new handle.
+	 */
+  PageHandle(PageHandle&& other) noexcept
+    : mgr(other.mgr), frame(other.frame), pageNum(other.pageNum), pagePtr(other.pagePtr), dirty(other.dirty)
+  {
+    other.mgr = NULL;
+    other.pagePtr = NULL;
+    other.pageNum = Page::INVALID_NUMBER;
+    other.dirty = false;
+  }
+
+	/**
+   * Move assignment. Releases the pin currently held, then takes over the pin held by rhs.
+	 */
+  PageHandle& operator=(PageHandle&& rhs) noexcept;
+
+  PageHandle(const PageHandle&) = delete;
+  PageHandle& operator=(const PageHandle&) = delete;
+
+	/**
+   * Destructor. Releases the pin, if any. Never throws.
+	 */
+  ~PageHandle();
+
+	/**
+   * Returns true if the handle holds a pin
+	 */
+  bool valid() const { return mgr != NULL; }
+
+	/**
+   * Returns the pinned page, NULL for an empty handle
+	 */
+  Page* page() const { return pagePtr; }
+
+	/**
+   * Returns the page number of the pinned page
+	 */
+  PageId pageNo() const { return pageNum; }
+
+	/**
+   * Returns the frame the page is pinned in
+	 */
+  FrameId frameNo() const { return frame; }
+
+	/**
+   * Marks the page dirty. It is written back to disk before its frame is reused.
+	 */
+  void markDirty() { dirty = true; }
+
+	/**
+	 * Releases the pin held by the handle, leaving it empty. Does nothing on an empty handle.
+	 *
+   * @throws  PageNotPinnedException If the page is not pinned anymore
+	 */
+  void release();
+};
+
+
 /**
 * @brief Class to maintain statistics of buffer usage
 */
@@ -132,6 +328,11 @@ struct BufStats
 	 */
   int diskreads;
 
+	/**
+   * Number of pages read from the page tier instead of disk
+	 */
+  int tierreads;
+
 	/**
    * Number of pages written back to disk
 	 */
@@ -142,7 +343,7 @@ struct BufStats
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = diskreads = tierreads = diskwrites = 0;
   }
 
 	/**
@@ -155,8 +356,40 @@ struct BufStats
 };
 
 
+/**
+* @brief Frame quota of a file within a buffer pool
+*/
+struct FileQuota
+{
+	/**
+   * Number of frames reserved for the file. Its pages are not replaced by pages of other files while it holds no more frames than this.
+	 */
+  std::uint32_t minFrames;
+
+	/**
+   * Maximum number of frames the file may hold, 0 for no limit
+	 */
+  std::uint32_t maxFrames;
+
+	/**
+   * Buffer pool usage statistics of the file
+	 */
+  BufStats stats;
+
+	/**
+   * Constructor of FileQuota class
+	 */
+  FileQuota()
+    : minFrames(0), maxFrames(0)
+  {
+  }
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file
+*
+* @warning This class is not threadsafe.
 */
 class BufMgr
 {
@@ -177,15 +410,40 @@ class BufMgr
   BufHashTbl *hashTable;
 
 	/**
-   * Array of BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool)
+   * BufDesc objects to hold information corresponding to every frame allocation from 'bufPool' (the buffer pool).
+   * Kept in a deque so resizing the pool never moves the descriptors of the remaining frames.
 	 */
-  BufDesc *bufDescTable;
+  std::deque<BufDesc> bufDescTable;
 
 	/**
    * Maintains Buffer pool usage statistics
 	 */
   BufStats bufStats;
 
+	/**
+   * Quotas and statistics of the files that have a quota
+	 */
+  std::map<const File*, FileQuota> fileQuotas;
+
+	/**
+   * Counter stamped into BufDesc::lastUsed on every reference, so frames can be ordered by recency
+	 */
+  std::uint64_t useCounter;
+
+	/**
+   * Frames currently assigned to each file, so per-file operations such as flushFile()
+   * only visit the frames of that file instead of the whole pool
+	 */
+  std::map<const File*, std::set<FrameId> > fileFrameTable;
+
+	/**
+   * Number of buckets of the hash table for a pool of the given number of frames
+	 */
+  static int hashTableSize(const std::uint32_t bufs)
+  {
+		return ((((int) (bufs * 1.2))*2)/2)+1;
+  }
+
 	/**
    * Advance clock to next frame in the buffer pool
 	 */
@@ -195,18 +453,142 @@ class BufMgr
   }
 
 	/**
-	 * Allocate a free frame.
+	 * Allocate a free frame. Frames are only taken as far as the file quotas allow: a file at its maximum
+	 * replaces one of its own pages, and the frames of a file at or below its minimum are left alone.
 	 *
 	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param file   	File the frame is allocated for
 	 * @throws BufferExceededException If no such buffer is found which can be allocated
 	 */
-  void allocBuf(FrameId & frame);
+  void allocBuf(FrameId & frame, const File* file);
+
+	/**
+	 * Returns true if the file holds as many frames as its quota allows.
+	 *
+	 * @param file   	File object
+	 */
+  bool atMaxFrames(const File* file) const;
+
+	/**
+	 * Returns true if the frames of the owner file are reserved against replacement by pages of another file.
+	 *
+	 * @param owner   File holding a frame
+	 * @param file   	File a frame is needed for
+	 */
+  bool isReserved(const File* owner, const File* file) const;
+
+	/**
+	 * Returns the quota of the file, NULL if the file has none.
+	 *
+	 * @param file   	File object
+	 */
+  FileQuota* quotaOf(const File* file)
+  {
+		if (fileQuotas.empty())
+			return NULL;
+		std::map<const File*, FileQuota>::iterator quota = fileQuotas.find(file);
+		return quota != fileQuotas.end() ? &quota->second : NULL;
+  }
+
+	/**
+	 * Record that a frame has been assigned to a page of its file. Called right after BufDesc::Set().
+	 *
+	 * @param frame   	Frame ID of the frame
+	 */
+  void trackFrame(const FrameId frame);
+
+	/**
+	 * Forget the assignment of a frame to its file. Called right before BufDesc::Clear() on a valid frame.
+	 *
+	 * @param frame   	Frame ID of the frame
+	 */
+  void untrackFrame(const FrameId frame);
+
+	/**
+	 * Writes the dirty pages among the given frames back to their file. Pages are sorted by page number
+	 * and runs of consecutive pages are handed to File::writePages() together, so the write-back is
+	 * mostly sequential. All frames must be valid and belong to the same file.
+	 *
+	 * @param frames  Frames to consider
+	 */
+  void writeDirtyFrames(const std::vector<FrameId>& frames);
+
+	/**
+	 * Pins the given page of the file in a frame, reading it from the file if it is not in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file to be read
+	 * @return  			Frame ID of the frame the page is pinned in
+	 */
+  FrameId pinPage(File* file, const PageId pageNo);
+
+	/**
+	 * Allocates a new page in the file and pins it in a frame.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @return  			Frame ID of the frame the page is pinned in
+	 */
+  FrameId pinNewPage(File* file, PageId &pageNo);
+
+	/**
+	 * Unpin the page held in a frame, without looking it up in the hash table.
+	 *
+	 * @param frame   Frame ID of the frame
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty
+   * @throws  PageNotPinnedException If the page is not already pinned
+	 */
+  void unPinFrame(const FrameId frame, const bool dirty);
+
+	/**
+	 * Assigns a free frame, whose page has just been read in, to the page without pinning it.
+	 *
+	 * @param frame   Frame ID of the frame
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param rank  	Position of the page in the hot page list, kept in lastUsed until all pages are restored
+	 */
+  void restoreFrame(const FrameId frame, File* file, const PageId pageNo, const std::uint32_t rank);
+
+	/**
+	 * Turn the swizzled reference to the given frame back into a page number.
+	 *
+	 * @param frame   Frame ID of a frame referenced by a swizzled reference
+	 */
+  void unswizzleFrame(const FrameId frame);
+
+	/**
+	 * Unswizzle the references held by the page in the given frame.
+	 *
+	 * @param parentFrame   Frame ID of the parent page
+	 */
+  void unswizzleChildren(const FrameId parentFrame);
+
+	/**
+	 * Unswizzle every swizzled reference held by pages of the file.
+	 *
+	 * @param file   	File object
+	 */
+  void unswizzleFile(const File* file);
+
+	/**
+   * True if pages may swizzle references to their children
+	 */
+  bool swizzling;
+
+	/**
+   * Second-level cache consulted on misses and offered evicted pages, NULL if there is none
+	 */
+  PageTier* pageTier;
+
+  friend class PageHandle;
 
  public:
 	/**
-   * Actual buffer pool from which frames are allocated
+   * Actual buffer pool from which frames are allocated. Frame i is bufPool[i]. Growing or shrinking
+   * the pool with resize() never moves the pages held by the remaining frames.
 	 */
-  Page* bufPool;
+  std::deque<Page> bufPool;
 
 	/**
    * Constructor of BufMgr class
@@ -229,6 +611,16 @@ class BufMgr
 	 */
   void readPage(File* file, const PageId PageNo, Page*& page);
 
+	/**
+	 * Reads the given page from the file into a frame and returns a handle holding the pin on it.
+	 * Releasing the handle unpins the page without another hash table lookup.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @return  			Handle to the pinned page
+	 */
+  PageHandle readPage(File* file, const PageId PageNo);
+
 	/**
 	 * Unpin a page from memory since it is no longer required for it to remain in memory.
 	 *
@@ -241,7 +633,8 @@ class BufMgr
 
 	/**
 	 * Allocates a new, empty page in the file and returns the Page object.
-	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 * The newly allocated page is also assigned a frame in the buffer pool, and is marked dirty since the
+	 * file may only have reserved its page number.
 	 *
 	 * @param file   	File object
 	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
@@ -250,9 +643,21 @@ class BufMgr
   void allocPage(File* file, PageId &PageNo, Page*& page);
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
+	 * Allocates a new, empty page in the file and returns a handle holding the pin on it.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @return  			Handle to the pinned page
+	 */
+  PageHandle allocPage(File* file, PageId &PageNo);
+
+	/**
+	 * Writes out all dirty pages of the file to disk and releases the frames assigned to the file.
+	 * Only the frames of the file are visited, and dirty pages are written in page number order with
+	 * consecutive pages coalesced into a single write. Then File::sync() writes any metadata the file
+	 * keeps in memory.
 	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
-	 * Otherwise Error returned.
+	 * Otherwise Error returned, and nothing is written.
 	 *
 	 * @param file   	File object
    * @throws  PagePinnedException If any page of the file is pinned in the buffer pool
@@ -260,6 +665,15 @@ class BufMgr
 	 */
   void flushFile(const File* file);
 
+	/**
+	 * Writes out all dirty pages of the file to disk like flushFile(), then File::sync(), but keeps
+	 * the frames of the file in the pool, pinned or not. Swizzled references held by pages of the
+	 * file are unswizzled first, so no pin may be in the middle of following one.
+	 *
+	 * @param file   	File object
+	 */
+  void checkpointFile(const File* file);
+
 	/**
 	 * Delete page from file and also from buffer pool if present.
 	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
@@ -270,10 +684,144 @@ class BufMgr
   void disposePage(File* file, const PageId PageNo);
 
 	/**
+	 * Enables or disables pointer swizzling. Disabling it unswizzles all swizzled references in the pool.
+	 *
+	 * @param enable  	True to let pages swizzle references to their children
+	 */
+  void setSwizzling(const bool enable);
+
+	/**
+   * Returns true if pointer swizzling is enabled
+	 */
+  bool swizzlingEnabled() const { return swizzling; }
+
+	/**
+	 * Records that the parent page now references the child page by its frame. Both pages must be pinned
+	 * by the caller, and on success the caller replaces the child's page number inside the parent with
+	 * SWIZZLED_BIT | child.frameNo(). The child cannot be evicted before the owner has been called back to
+	 * unswizzle the reference, and the parent cannot be evicted while it holds swizzled references.
+	 *
+	 * @param parent   	Handle of the parent page
+	 * @param child   	Handle of the child page
+	 * @param owner   	Owner to call back when the reference has to be unswizzled
+	 * @return  				False if swizzling is disabled or the child is already referenced by a swizzled reference
+	 */
+  bool swizzle(const PageHandle& parent, const PageHandle& child, SwizzleOwner* owner);
+
+	/**
+	 * Pins the page referenced by a swizzled reference. No hash table lookup is needed since the reference
+	 * names the frame directly.
+	 *
+	 * @param ref   		Swizzled reference, SWIZZLED_BIT | frame
+	 * @return  				Handle to the pinned page
+	 */
+  PageHandle readSwizzled(const PageId ref);
+
+	/**
+	 * Unswizzle the references held by the page pinned by the handle, e.g. before its children are moved
+	 * to another page.
+	 *
+	 * @param parent   	Handle of the parent page
+	 */
+  void unswizzleChildren(const PageHandle& parent);
+
+	/**
+	 * Puts a second-level cache behind the buffer pool. Pages leaving the pool are offered to the tier once
+	 * they are clean, and pages missing in the pool are looked up in the tier before they are read from
+	 * their file. Pages written back, disposed of or belonging to a flushed file are invalidated in the tier.
+	 * The tier is not owned by the buffer manager and must outlive it, or be removed first.
+	 *
+	 * @param tier  		Page tier, NULL to remove the current one
+	 */
+  void setPageTier(PageTier* tier);
+
+	/**
+	 * Grows or shrinks the buffer pool to the given number of frames while it is in use.
+	 * Growing appends frames to the end of the pool; pages held by existing frames stay where they are,
+	 * so pointers and handles to them remain valid. Shrinking drains the frames at the end of the pool:
+	 * swizzled references to and from them are unswizzled, dirty pages are written back and the frames
+	 * are released. The hash table is resized along with the pool.
+	 *
+	 * @param bufs  		New number of frames, at least 1
+	 * @throws  PagePinnedException If a page in one of the frames to be removed is pinned. Nothing is changed then.
+	 * @throws  BufferExceededException If bufs is 0
+	 */
+  void resize(std::uint32_t bufs);
+
+	/**
+	 * Sets the frame quota of a file, to isolate the pages of latency critical files from batch work
+	 * sharing the pool. Pages of the file are not replaced by pages of other files while it holds at most
+	 * minFrames frames; the frames are reserved as the file uses them, not up front. A file holding maxFrames
+	 * frames replaces one of its own pages on every miss. The sum of all minimums should leave enough frames
+	 * for the other files. Setting a quota also starts collecting statistics for the file.
+	 * For complete isolation, use a separate BufMgr per group of files; every BufMgr is an independent pool.
+	 *
+	 * @param file   		File object
+	 * @param minFrames Number of frames reserved for the file
+	 * @param maxFrames Maximum number of frames the file may hold, 0 for no limit
+	 */
+  void setFileQuota(const File* file, const std::uint32_t minFrames, const std::uint32_t maxFrames);
+
+	/**
+	 * Removes the quota of a file, along with its statistics.
+	 *
+	 * @param file   		File object
+	 */
+  void removeFileQuota(const File* file);
+
+	/**
+	 * Get buffer pool usage statistics of a file with a quota, collected since its quota was set.
+	 * Disk writes count pages written back when their frames are replaced, as in getBufStats().
+	 *
+	 * @param file   		File object
+	 * @return  				Statistics of the file, all zero if it has no quota
+	 */
+  BufStats getFileStats(const File* file) const;
+
+	/**
+	 * Returns the number of frames holding pages of the file.
+	 *
+	 * @param file   		File object
+	 */
+  std::uint32_t numFramesOf(const File* file) const;
+
+	/**
+	 * Writes the (file, page) pairs of all resident pages to a hot page list, most recently used first.
+	 * Call it at shutdown, and periodically to survive crashes; the list is replaced atomically.
+	 *
+	 * @param dumpName  Name of the hot page list
+	 * @return  				Number of pages written to the list
+	 * @throws  FileOpenException If the list cannot be written
+	 */
+  std::uint32_t dumpHotPages(const std::string& dumpName) const;
+
+	/**
+	 * Warms up the buffer pool from a hot page list written by dumpHotPages(). The most recently used
+	 * pages of the list that belong to one of the given files are read into free frames, sorted by
+	 * page number, with runs of consecutive pages read by a single File::readPages() call. Restored
+	 * pages are unpinned and keep their recency order. Resident pages are never evicted, so the number
+	 * of pages restored is limited by the number of free frames; pages that no longer exist are skipped.
+	 *
+	 * @param dumpName  Name of the hot page list
+	 * @param files  		Open files whose pages may be restored
+	 * @return  				Number of pages restored
+	 * @throws  FileNotFoundException If the list does not exist
+	 */
+  std::uint32_t restoreHotPages(const std::string& dumpName, const std::vector<File*>& files);
+
+	/**
    * Print member variable values.
 	 */
   void  printSelf();
 
+	/**
+   * Returns the number of frames in the buffer pool
+	 */
+  std::uint32_t getNumBufs() const
+  {
+		return numBufs;
+  }
+
 	/**
    * Get buffer pool usage statistics
 	 */
@@ -0,0 +1,787 @@
+/**
+ * This file contains the implementation of the latch-free index interface as defined in bwtree.h
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <climits>
+#include <thread>
+#include "bwtree.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/bad_opcodes_exception.h"
+#include "exceptions/bad_scanrange_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/scan_not_initialized_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_exists_exception.h"
+
+namespace badgerdb
+{
+
+    namespace
+    {
+        // Thread slots are shared by all indexes; a thread keeps its slot until it exits
+        std::atomic<bool> slotTaken[BWTREE_MAX_THREADS];
+
+        struct ThreadSlot {
+            int slot;
+
+            ThreadSlot() : slot(-1) {
+                while (true) {
+                    for (int i = 0; i < BWTREE_MAX_THREADS; i++) {
+                        bool expected = false;
+                        if (slotTaken[i].compare_exchange_strong(expected, true)) {
+                            slot = i;
+                            return;
+                        }
+                    }
+                    std::this_thread::yield();
+                }
+            }
+
+            ~ThreadSlot() {
+                slotTaken[slot].store(false);
+            }
+        };
+
+        int threadSlot() {
+            thread_local ThreadSlot threadSlot;
+            return threadSlot.slot;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::EpochGuard
+    // -----------------------------------------------------------------------------
+    BwTreeIndex::EpochGuard::EpochGuard(BwTreeIndex* index) : index(index), slot(threadSlot()) {
+        index->activeEpochs[slot].store(index->globalEpoch.load());
+    }
+
+    BwTreeIndex::EpochGuard::~EpochGuard() {
+        index->activeEpochs[slot].store(0);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::BwTreeIndex -- Constructor
+    // -----------------------------------------------------------------------------
+    BwTreeIndex::BwTreeIndex(
+            const std::string & relationName,
+            std::string & outIndexName,
+            BufMgr *bufMgrIn,
+            const int attrByteOffset,
+            const Datatype attrType) {
+
+        // Create index file name
+        std::ostringstream idxStr;
+        idxStr << relationName << '.' << attrByteOffset;
+        outIndexName = idxStr.str();
+
+        bufMgr = bufMgrIn;
+        for (int i = 0; i < TABLE_CHUNKS; i++)
+            table[i].store(nullptr);
+        nextId.store(0);
+        globalEpoch.store(1);
+        for (int i = 0; i < BWTREE_MAX_THREADS; i++)
+            activeEpochs[i].store(0);
+        consolidations.store(0);
+        splits.store(0);
+        scanExecuting = false;
+        scanLeaf = nullptr;
+
+        std::vector<BaseNode*> leaves;
+        try {
+            file = new BlobFile(outIndexName, true);
+
+            PageHandle headerPage = bufMgr->allocPage(file, headerPageNum);
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            strcpy(metadata->relationName, relationName.c_str());
+            metadata->attrByteOffset = attrByteOffset;
+            metadata->attrType = attrType;
+            // There are no leaves in the file before the first checkpoint
+            metadata->rootPageNo = Page::INVALID_NUMBER;
+            metadata->indexKind = BWTREE_INDEX;
+            headerPage.markDirty();
+            headerPage.release();
+
+            buildTree(leaves);
+
+            // Scan relation and insert entries for all tuples into index
+            try {
+                FileScan fileScan(relationName, bufMgr);
+                RecordId rid = {};
+                while (true) {
+                    fileScan.scanNext(rid);
+                    insertEntry((int*) fileScan.getRecord().c_str() + attrByteOffset, rid);
+                }
+            } catch (EndOfFileException& e) {
+                // Do nothing. Finished scanning file.
+            }
+        } catch (FileExistsException& e) {
+            file = new BlobFile(outIndexName, false);
+            headerPageNum = file->getFirstPageNo();
+
+            PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            if (strcmp(metadata->relationName, relationName.c_str()) != 0
+                || metadata->attrByteOffset != attrByteOffset
+                || metadata->attrType != attrType
+                || metadata->indexKind != BWTREE_INDEX) {
+                headerPage.release();
+                bufMgr->flushFile(file);
+                delete file;
+                throw BadIndexInfoException("Error: Existing index metadata does not match parameters passed.");
+            }
+
+            // Read the leaves in key order and build the tree over them
+            PageId pageNo = metadata->rootPageNo;
+            headerPage.release();
+            while (pageNo != Page::INVALID_NUMBER) {
+                PageHandle page = bufMgr->readPage(file, pageNo);
+                auto stored = (const LeafNodeInt*) page.page();
+                auto leaf = new BaseNode;
+                leaf->type = LEAF_BASE;
+                for (int i = 0; i < INTARRAYLEAFSIZE && stored->ridArray[i].page_number != Page::INVALID_NUMBER; i++) {
+                    leaf->keys.push_back(stored->keyArray[i]);
+                    leaf->rids.push_back(stored->ridArray[i]);
+                }
+                leaves.push_back(leaf);
+                leafPages.push_back(pageNo);
+                pageNo = stored->rightSibPageNo;
+            }
+            buildTree(leaves);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::~BwTreeIndex -- destructor
+    // -----------------------------------------------------------------------------
+    BwTreeIndex::~BwTreeIndex() {
+        scanExecuting = false;
+        freeChain(scanLeaf);
+
+        checkpoint();
+        bufMgr->flushFile(file);
+        delete file;
+
+        const NodeId numIds = nextId.load();
+        for (NodeId id = 0; id < numIds; id++)
+            freeChain(entry(id).load());
+        for (int i = 0; i < BWTREE_MAX_THREADS; i++) {
+            for (const Retired& chain : retired[i])
+                freeChain(chain.chain);
+        }
+        for (int i = 0; i < TABLE_CHUNKS; i++)
+            delete[] table[i].load();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::entry
+    // -----------------------------------------------------------------------------
+    std::atomic<BwTreeIndex::Node*>& BwTreeIndex::entry(const NodeId id) {
+        return table[id / TABLE_CHUNK].load()[id % TABLE_CHUNK];
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::installNode
+    // -----------------------------------------------------------------------------
+    BwTreeIndex::NodeId BwTreeIndex::installNode(Node* node) {
+        const NodeId id = nextId.fetch_add(1);
+        std::atomic<Node*>* chunk = table[id / TABLE_CHUNK].load();
+        if (chunk == nullptr) {
+            auto fresh = new std::atomic<Node*>[TABLE_CHUNK];
+            for (int i = 0; i < TABLE_CHUNK; i++)
+                fresh[i].store(nullptr);
+            if (table[id / TABLE_CHUNK].compare_exchange_strong(chunk, fresh))
+                chunk = fresh;
+            else
+                delete[] fresh;
+        }
+        chunk[id % TABLE_CHUNK].store(node);
+        return id;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::insertEntry
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::insertEntry(const void *key, const RecordId rid) {
+        if (key == nullptr)
+            return;
+
+        const int intKey = *((int*) key);
+        EpochGuard guard(this);
+        while (true) {
+            Node* head;
+            const NodeId id = findNode(intKey, 0, head);
+
+            auto delta = new InsertDelta;
+            delta->type = INSERT_DELTA;
+            delta->level = 0;
+            delta->depth = head->depth + 1;
+            delta->next = head;
+            delta->key = intKey;
+            delta->rid = rid;
+            if (entry(id).compare_exchange_strong(head, delta)) {
+                if (delta->depth > BWTREE_MAX_CHAIN)
+                    consolidate(id);
+                return;
+            }
+
+            // Another thread changed the leaf first, so look again
+            delete delta;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::lookup
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::lookup(const void *key, RecordId& outRid) {
+        const int intKey = *((int*) key);
+        EpochGuard guard(this);
+
+        Node* head;
+        findNode(intKey, 0, head);
+        for (const Node* node = head; node != nullptr; node = node->next) {
+            if (node->type == INSERT_DELTA) {
+                auto delta = (const InsertDelta*) node;
+                if (delta->key == intKey) {
+                    outRid = delta->rid;
+                    return;
+                }
+            } else if (node->type == LEAF_BASE) {
+                auto base = (const BaseNode*) node;
+                auto pos = std::lower_bound(base->keys.begin(), base->keys.end(), intKey);
+                if (pos != base->keys.end() && *pos == intKey) {
+                    outRid = base->rids[pos - base->keys.begin()];
+                    return;
+                }
+            }
+        }
+        throw NoSuchKeyFoundException();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::findNode
+    // -----------------------------------------------------------------------------
+    BwTreeIndex::NodeId BwTreeIndex::findNode(const int key, const int level, Node*& head) {
+        NodeId id = rootId.load();
+        while (true) {
+            head = entry(id).load();
+
+            // Walk the chain: a split delta or the high key may send us to the right sibling,
+            // otherwise the child is given by the largest separator not above the key
+            NodeId next = INVALID_NODE;
+            bool right = false;
+            std::int64_t bestKey = INT64_MIN;
+            NodeId bestChild = INVALID_NODE;
+            for (const Node* node = head; node != nullptr && !right; node = node->next) {
+                if (node->type == SPLIT_DELTA) {
+                    auto delta = (const SplitDelta*) node;
+                    if (key >= delta->key) {
+                        next = delta->sibling;
+                        right = true;
+                    }
+                } else if (node->type == INDEX_DELTA) {
+                    auto delta = (const IndexDelta*) node;
+                    if (delta->key <= key && delta->key > bestKey) {
+                        bestKey = delta->key;
+                        bestChild = delta->child;
+                    }
+                } else if (node->type == LEAF_BASE || node->type == INNER_BASE) {
+                    auto base = (const BaseNode*) node;
+                    if (base->hasHigh && key >= base->highKey) {
+                        next = base->right;
+                        right = true;
+                    } else if (node->type == INNER_BASE && head->level > level) {
+                        const int idx = std::upper_bound(base->keys.begin(), base->keys.end(), key) - base->keys.begin();
+                        if (bestChild == INVALID_NODE || (idx > 0 && base->keys[idx - 1] > bestKey))
+                            next = base->children[idx];
+                        else
+                            next = bestChild;
+                    }
+                }
+            }
+
+            if (!right && head->level == level)
+                return id;
+            id = next;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::consolidated
+    // -----------------------------------------------------------------------------
+    BwTreeIndex::BaseNode* BwTreeIndex::consolidated(const Node* head) const {
+        std::vector<const Node*> chain;
+        for (const Node* node = head; node != nullptr; node = node->next)
+            chain.push_back(node);
+
+        auto base = new BaseNode(*(const BaseNode*) chain.back());
+        base->depth = 0;
+        base->next = nullptr;
+
+        // Oldest delta first
+        for (int i = (int) chain.size() - 2; i >= 0; i--) {
+            if (chain[i]->type == INSERT_DELTA) {
+                auto delta = (const InsertDelta*) chain[i];
+                auto pos = std::upper_bound(base->keys.begin(), base->keys.end(), delta->key);
+                const std::size_t idx = pos - base->keys.begin();
+                base->keys.insert(pos, delta->key);
+                base->rids.insert(base->rids.begin() + idx, delta->rid);
+            } else if (chain[i]->type == INDEX_DELTA) {
+                auto delta = (const IndexDelta*) chain[i];
+                auto pos = std::upper_bound(base->keys.begin(), base->keys.end(), delta->key);
+                const std::size_t idx = pos - base->keys.begin();
+                base->keys.insert(pos, delta->key);
+                base->children.insert(base->children.begin() + idx + 1, delta->child);
+            } else if (chain[i]->type == SPLIT_DELTA) {
+                auto delta = (const SplitDelta*) chain[i];
+                const std::size_t kept = std::lower_bound(base->keys.begin(), base->keys.end(), delta->key) - base->keys.begin();
+                base->keys.resize(kept);
+                if (base->type == LEAF_BASE)
+                    base->rids.resize(kept);
+                else
+                    base->children.resize(kept + 1);
+                base->hasHigh = true;
+                base->highKey = delta->key;
+                base->right = delta->sibling;
+            }
+        }
+        return base;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::consolidate
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::consolidate(const NodeId id) {
+        Node* head = entry(id).load();
+        BaseNode* base = consolidated(head);
+        if (!entry(id).compare_exchange_strong(head, base)) {
+            // The node changed; whoever changed it consolidates it later
+            freeChain(base);
+            return;
+        }
+        consolidations++;
+        retire(head);
+
+        if (base->type == LEAF_BASE ? base->keys.size() > (std::size_t) BWTREE_LEAF_CAPACITY
+                                    : base->children.size() > (std::size_t) BWTREE_INNER_CAPACITY)
+            split(id);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::split
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::split(const NodeId id) {
+        Node* head = entry(id).load();
+        BaseNode* view = consolidated(head);
+        const bool leaf = view->type == LEAF_BASE;
+        if (leaf ? view->keys.size() <= (std::size_t) BWTREE_LEAF_CAPACITY
+                 : view->children.size() <= (std::size_t) BWTREE_INNER_CAPACITY) {
+            freeChain(view);
+            return;
+        }
+
+        // The upper half moves to a new right sibling, which takes over the high key. All entries with
+        // one key stay in one leaf, so a leaf of a single key grows past its capacity instead
+        std::size_t mid = view->keys.size() / 2;
+        if (leaf) {
+            mid = std::lower_bound(view->keys.begin(), view->keys.end(), view->keys[mid]) - view->keys.begin();
+            if (mid == 0)
+                mid = std::upper_bound(view->keys.begin(), view->keys.end(), view->keys[0]) - view->keys.begin();
+            if (mid == view->keys.size()) {
+                freeChain(view);
+                return;
+            }
+        }
+        const int key = view->keys[mid];
+        auto sibling = new BaseNode;
+        sibling->type = view->type;
+        sibling->level = view->level;
+        sibling->depth = 0;
+        sibling->next = nullptr;
+        sibling->hasHigh = view->hasHigh;
+        sibling->highKey = view->highKey;
+        sibling->right = view->right;
+        if (leaf) {
+            sibling->keys.assign(view->keys.begin() + mid, view->keys.end());
+            sibling->rids.assign(view->rids.begin() + mid, view->rids.end());
+        } else {
+            sibling->keys.assign(view->keys.begin() + mid + 1, view->keys.end());
+            sibling->children.assign(view->children.begin() + mid + 1, view->children.end());
+        }
+        freeChain(view);
+        const NodeId siblingId = installNode(sibling);
+
+        auto delta = new SplitDelta;
+        delta->type = SPLIT_DELTA;
+        delta->level = head->level;
+        delta->depth = head->depth + 1;
+        delta->next = head;
+        delta->key = key;
+        delta->sibling = siblingId;
+        if (!entry(id).compare_exchange_strong(head, delta)) {
+            // Nobody can have seen the sibling yet
+            entry(siblingId).store(nullptr);
+            freeChain(sibling);
+            delete delta;
+            return;
+        }
+        splits++;
+        postSibling(id, head->level, key, siblingId);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::postSibling
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::postSibling(const NodeId id, const int level, const int key, const NodeId sibling) {
+        while (true) {
+            NodeId root = rootId.load();
+            if (root == id) {
+                auto newRoot = new BaseNode;
+                newRoot->type = INNER_BASE;
+                newRoot->level = level + 1;
+                newRoot->depth = 0;
+                newRoot->next = nullptr;
+                newRoot->hasHigh = false;
+                newRoot->highKey = 0;
+                newRoot->right = INVALID_NODE;
+                newRoot->keys.push_back(key);
+                newRoot->children.push_back(id);
+                newRoot->children.push_back(sibling);
+                const NodeId newRootId = installNode(newRoot);
+                if (rootId.compare_exchange_strong(root, newRootId))
+                    return;
+                entry(newRootId).store(nullptr);
+                freeChain(newRoot);
+                continue;
+            }
+
+            // A sibling of the root waits for the thread that splits the root to put a new one above it
+            if (entry(root).load()->level <= level) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            Node* head;
+            const NodeId parent = findNode(key, level + 1, head);
+            auto delta = new IndexDelta;
+            delta->type = INDEX_DELTA;
+            delta->level = level + 1;
+            delta->depth = head->depth + 1;
+            delta->next = head;
+            delta->key = key;
+            delta->child = sibling;
+            if (entry(parent).compare_exchange_strong(head, delta)) {
+                if (delta->depth > BWTREE_MAX_CHAIN)
+                    consolidate(parent);
+                return;
+            }
+            delete delta;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::retire
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::retire(Node* chain) {
+        // Threads that entered before the epoch is advanced may still be reading the chain
+        std::vector<Retired>& list = retired[threadSlot()];
+        Retired entry = {globalEpoch.fetch_add(1), chain};
+        list.push_back(entry);
+        if (list.size() < 32)
+            return;
+
+        std::uint64_t oldest = UINT64_MAX;
+        for (int i = 0; i < BWTREE_MAX_THREADS; i++) {
+            const std::uint64_t epoch = activeEpochs[i].load();
+            if (epoch != 0 && epoch < oldest)
+                oldest = epoch;
+        }
+        std::size_t kept = 0;
+        for (const Retired& item : list) {
+            if (item.epoch < oldest)
+                freeChain(item.chain);
+            else
+                list[kept++] = item;
+        }
+        list.resize(kept);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::freeChain
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::freeChain(Node* chain) {
+        while (chain != nullptr) {
+            Node* next = chain->next;
+            switch (chain->type) {
+                case LEAF_BASE:
+                case INNER_BASE:
+                    delete (BaseNode*) chain;
+                    break;
+                case INSERT_DELTA:
+                    delete (InsertDelta*) chain;
+                    break;
+                case INDEX_DELTA:
+                    delete (IndexDelta*) chain;
+                    break;
+                case SPLIT_DELTA:
+                    delete (SplitDelta*) chain;
+                    break;
+            }
+            chain = next;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::buildTree
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::buildTree(std::vector<BaseNode*>& leaves) {
+        if (leaves.empty()) {
+            auto leaf = new BaseNode;
+            leaf->type = LEAF_BASE;
+            leaves.push_back(leaf);
+        }
+
+        // Entries with one key may span pages of the file; they go to the leaf of the first
+        std::size_t kept = 0;
+        for (BaseNode* leaf : leaves) {
+            BaseNode* last = kept > 0 ? leaves[kept - 1] : nullptr;
+            std::size_t moved = 0;
+            while (last != nullptr && !last->keys.empty() && moved < leaf->keys.size()
+                   && leaf->keys[moved] == last->keys.back())
+                moved++;
+            if (moved > 0) {
+                last->keys.insert(last->keys.end(), leaf->keys.begin(), leaf->keys.begin() + moved);
+                last->rids.insert(last->rids.end(), leaf->rids.begin(), leaf->rids.begin() + moved);
+                leaf->keys.erase(leaf->keys.begin(), leaf->keys.begin() + moved);
+                leaf->rids.erase(leaf->rids.begin(), leaf->rids.begin() + moved);
+            }
+            if (leaf->keys.empty() && kept > 0)
+                delete leaf;
+            else
+                leaves[kept++] = leaf;
+        }
+        leaves.resize(kept);
+
+        // Each level links its nodes left to right; the level above is built over them, with
+        // half full nodes so the first inserts do not split them all
+        std::vector<BaseNode*> nodes(leaves);
+        std::vector<int> lowKeys;
+        for (BaseNode* leaf : leaves)
+            lowKeys.push_back(leaf->keys.empty() ? INT_MIN : leaf->keys[0]);
+        int level = 0;
+        while (true) {
+            std::vector<NodeId> ids;
+            for (BaseNode* node : nodes) {
+                node->level = level;
+                node->depth = 0;
+                node->next = nullptr;
+                ids.push_back(installNode(node));
+            }
+            for (std::size_t i = 0; i < nodes.size(); i++) {
+                nodes[i]->hasHigh = i + 1 < nodes.size();
+                nodes[i]->highKey = nodes[i]->hasHigh ? lowKeys[i + 1] : 0;
+                nodes[i]->right = nodes[i]->hasHigh ? ids[i + 1] : INVALID_NODE;
+            }
+            if (nodes.size() == 1) {
+                rootId.store(ids[0]);
+                return;
+            }
+
+            std::vector<BaseNode*> parents;
+            std::vector<int> parentLowKeys;
+            const std::size_t fanout = BWTREE_INNER_CAPACITY / 2;
+            for (std::size_t first = 0; first < nodes.size(); first += fanout) {
+                const std::size_t last = std::min(first + fanout, nodes.size());
+                auto parent = new BaseNode;
+                parent->type = INNER_BASE;
+                parent->children.assign(ids.begin() + first, ids.begin() + last);
+                parent->keys.assign(lowKeys.begin() + first + 1, lowKeys.begin() + last);
+                parents.push_back(parent);
+                parentLowKeys.push_back(lowKeys[first]);
+            }
+            nodes.swap(parents);
+            lowKeys.swap(parentLowKeys);
+            level++;
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::checkpoint
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::checkpoint() {
+        std::vector<int> keys;
+        std::vector<RecordId> rids;
+        {
+            EpochGuard guard(this);
+            Node* head;
+            findNode(INT_MIN, 0, head);
+            while (true) {
+                BaseNode* leaf = consolidated(head);
+                keys.insert(keys.end(), leaf->keys.begin(), leaf->keys.end());
+                rids.insert(rids.end(), leaf->rids.begin(), leaf->rids.end());
+                const bool last = !leaf->hasHigh;
+                const int highKey = leaf->highKey;
+                freeChain(leaf);
+                if (last)
+                    break;
+                findNode(highKey, 0, head);
+            }
+        }
+
+        // Full pages, reusing the pages of the last checkpoint first
+        const std::size_t numPages = std::max<std::size_t>(1, (keys.size() + INTARRAYLEAFSIZE - 1) / INTARRAYLEAFSIZE);
+        while (leafPages.size() < numPages) {
+            PageId pageNo;
+            bufMgr->allocPage(file, pageNo).release();
+            leafPages.push_back(pageNo);
+        }
+        for (std::size_t p = 0; p < numPages; p++) {
+            PageHandle page = bufMgr->readPage(file, leafPages[p]);
+            auto stored = (LeafNodeInt*) page.page();
+            for (int i = 0; i < INTARRAYLEAFSIZE; i++) {
+                const std::size_t idx = p * INTARRAYLEAFSIZE + i;
+                if (idx < keys.size()) {
+                    stored->keyArray[i] = keys[idx];
+                    stored->ridArray[i] = rids[idx];
+                } else {
+                    stored->keyArray[i] = -1;
+                    stored->ridArray[i].page_number = Page::INVALID_NUMBER;
+                    stored->ridArray[i].slot_number = Page::INVALID_SLOT;
+                }
+            }
+            stored->rightSibPageNo = p + 1 < numPages ? leafPages[p + 1] : Page::INVALID_NUMBER;
+            page.markDirty();
+        }
+
+        PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+        ((IndexMetaInfo*) headerPage.page())->rootPageNo = leafPages[0];
+        headerPage.markDirty();
+        headerPage.release();
+        bufMgr->checkpointFile(file);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::loadScanLeaf
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::loadScanLeaf(const NodeId id) {
+        EpochGuard guard(this);
+        freeChain(scanLeaf);
+        scanLeaf = consolidated(entry(id).load());
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::startScan
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::startScan(const void* lowValParm,
+                                const Operator lowOpParm,
+                                const void* highValParm,
+                                const Operator highOpParm) {
+        if ((lowOpParm != GT && lowOpParm != GTE) || (highOpParm != LT && highOpParm != LTE)) {
+            throw BadOpcodesException();
+        }
+
+        lowValInt = *(int *)lowValParm;
+        highValInt = *(int *)highValParm;
+        if (lowValInt > highValInt)
+            throw BadScanrangeException();
+
+        if (scanExecuting) {
+            endScan();
+        }
+        lowOp = lowOpParm;
+        highOp = highOpParm;
+        if (lowOp == GT && lowValInt == INT_MAX)
+            throw NoSuchKeyFoundException();
+
+        const int firstKey = lowOp == GT ? lowValInt + 1 : lowValInt;
+        NodeId id;
+        {
+            EpochGuard guard(this);
+            Node* head;
+            id = findNode(firstKey, 0, head);
+        }
+        loadScanLeaf(id);
+        nextEntry = std::lower_bound(scanLeaf->keys.begin(), scanLeaf->keys.end(), firstKey) - scanLeaf->keys.begin();
+        scanExecuting = true;
+
+        // Make sure the scan finds anything at all
+        RecordId rid;
+        try {
+            scanNext(rid);
+        } catch (IndexScanCompletedException& e) {
+            endScan();
+            throw NoSuchKeyFoundException();
+        }
+        nextEntry--;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::scanNext
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::scanNext(RecordId& outRid) {
+        if (!scanExecuting)
+            throw ScanNotInitializedException();
+
+        while (nextEntry >= scanLeaf->keys.size()) {
+            if (!scanLeaf->hasHigh)
+                throw IndexScanCompletedException();
+
+            // The leaf holding the high key is found from the root, so splits since are no problem
+            const int highKey = scanLeaf->highKey;
+            NodeId id;
+            {
+                EpochGuard guard(this);
+                Node* head;
+                id = findNode(highKey, 0, head);
+            }
+            loadScanLeaf(id);
+            nextEntry = std::lower_bound(scanLeaf->keys.begin(), scanLeaf->keys.end(), highKey) - scanLeaf->keys.begin();
+        }
+
+        const int key = scanLeaf->keys[nextEntry];
+        if ((highOp == LT && key >= highValInt) || (highOp == LTE && key > highValInt))
+            throw IndexScanCompletedException();
+
+        outRid = scanLeaf->rids[nextEntry];
+        nextEntry++;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // BwTreeIndex::endScan
+    // -----------------------------------------------------------------------------
+    void BwTreeIndex::endScan() {
+        if (!scanExecuting)
+            throw ScanNotInitializedException();
+        scanExecuting = false;
+        freeChain(scanLeaf);
+        scanLeaf = nullptr;
+    }
+
+}
@@ -0,0 +1,415 @@
+/**
+ * This is the header file for a latch-free index over a single INTEGER attribute, after the Bw-tree.
+ * It offers the interface of BTreeIndex, and may be used by several threads at once.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of entries a Bw-tree leaf holds before it splits. A leaf fits into a LeafNodeInt page.
+ */
+    constexpr int BWTREE_LEAF_CAPACITY = INTARRAYLEAFSIZE;
+
+/**
+ * @brief Number of children a Bw-tree non-leaf node holds before it splits.
+ */
+    constexpr int BWTREE_INNER_CAPACITY = 256;
+
+/**
+ * @brief Number of delta records on a node after which it is consolidated.
+ */
+    constexpr int BWTREE_MAX_CHAIN = 8;
+
+/**
+ * @brief Largest number of threads that may use Bw-tree indexes at the same time.
+ */
+    constexpr int BWTREE_MAX_THREADS = 64;
+
+
+/**
+ * @brief BwTreeIndex class. It implements a latch-free index on a single INTEGER attribute of a relation.
+ *
+ * Nodes are named by logical ids, and a mapping table holds the current version of every node. A node is
+ * never changed in place: an insert prepends a delta record to the node and installs it in the mapping
+ * table with a compare-and-swap, retrying if another thread got there first. Long delta chains are
+ * consolidated into a new base node, full nodes split by installing a split delta and then posting the
+ * new sibling in the parent; until then, readers reach the sibling through the split delta. Replaced
+ * nodes are freed once no thread that might still read them is inside an operation (epoch-based
+ * reclamation).
+ *
+ * insertEntry() and lookup() may be called by any number of threads at once, and never wait for each
+ * other. The whole node graph lives in process memory, outside the buffer pool, so the memory the index
+ * takes grows with its entries and is not bounded by the pool. The index file holds the leaves in key order
+ * and goes through the buffer manager, which is not threadsafe, only when the index is opened, in
+ * checkpoint() and in the destructor. Entries inserted since the last checkpoint are lost if the process
+ * exits without either. This index supports only one scan at a time.
+ */
+    class BwTreeIndex {
+
+    private:
+
+        typedef std::uint32_t NodeId;
+
+        /**
+         * Kinds of nodes and delta records.
+         */
+        enum NodeType { LEAF_BASE, INNER_BASE, INSERT_DELTA, INDEX_DELTA, SPLIT_DELTA };
+
+        /**
+         * Common part of base nodes and delta records.
+         */
+        struct Node {
+            NodeType type;
+            /** 0 for leaves, increasing towards the root. */
+            int level;
+            /** Number of delta records below and including this one. */
+            int depth;
+            /** Next record in the chain, NULL for a base node. */
+            Node* next;
+        };
+
+        /**
+         * Consolidated node. Child i of a non-leaf node holds the keys from keys[i-1] up to but excluding
+         * keys[i]; the node holds no keys from highKey on, which belong to its right sibling. A leaf holds
+         * every entry of each of its keys.
+         */
+        struct BaseNode : Node {
+            bool hasHigh;
+            int highKey;
+            NodeId right;
+            std::vector<int> keys;
+            std::vector<RecordId> rids;
+            std::vector<NodeId> children;
+        };
+
+        /**
+         * Entry inserted into a leaf.
+         */
+        struct InsertDelta : Node {
+            int key;
+            RecordId rid;
+        };
+
+        /**
+         * Child added to a non-leaf node, holding the keys from key up to the next separator.
+         */
+        struct IndexDelta : Node {
+            int key;
+            NodeId child;
+        };
+
+        /**
+         * Keys from key on moved to a new right sibling.
+         */
+        struct SplitDelta : Node {
+            int key;
+            NodeId sibling;
+        };
+
+        /**
+         * Replaced record chain, freed once no thread may still read it.
+         */
+        struct Retired {
+            std::uint64_t epoch;
+            Node* chain;
+        };
+
+        /**
+         * Marks the calling thread as inside an operation for as long as it exists.
+         */
+        class EpochGuard {
+        public:
+            explicit EpochGuard(BwTreeIndex* index);
+            ~EpochGuard();
+        private:
+            BwTreeIndex* index;
+            int slot;
+        };
+
+        static const NodeId INVALID_NODE = 0xffffffff;
+        static const int TABLE_CHUNK = 4096;
+        static const int TABLE_CHUNKS = 4096;
+
+        /**
+         * File object for the index file.
+         */
+        File		*file;
+
+        /**
+         * Buffer Manager Instance.
+         */
+        BufMgr	*bufMgr;
+
+        /**
+         * Page number of meta page.
+         */
+        PageId	headerPageNum;
+
+        /**
+         * Pages of the index file holding leaves, in key order.
+         */
+        std::vector<PageId>	leafPages;
+
+        /**
+         * Mapping table from node ids to the current record of every node, allocated in chunks.
+         */
+        std::atomic<std::atomic<Node*>*>	table[ TABLE_CHUNKS ];
+
+        /**
+         * Next node id to hand out.
+         */
+        std::atomic<NodeId>	nextId;
+
+        /**
+         * Id of the root node.
+         */
+        std::atomic<NodeId>	rootId;
+
+        /**
+         * Current epoch; advanced whenever records are retired.
+         */
+        std::atomic<std::uint64_t>	globalEpoch;
+
+        /**
+         * Epoch each thread slot entered its current operation in, 0 if it is not in one.
+         */
+        std::atomic<std::uint64_t>	activeEpochs[ BWTREE_MAX_THREADS ];
+
+        /**
+         * Records retired by each thread slot and not freed yet. Only touched by the thread holding the slot.
+         */
+        std::vector<Retired>	retired[ BWTREE_MAX_THREADS ];
+
+        /**
+         * Number of consolidations.
+         */
+        std::atomic<std::uint64_t>	consolidations;
+
+        /**
+         * Number of splits.
+         */
+        std::atomic<std::uint64_t>	splits;
+
+
+        // MEMBERS SPECIFIC TO SCANNING
+
+        /**
+         * True if an index scan has been started.
+         */
+        bool		scanExecuting;
+
+        /**
+         * Consolidated copy of the leaf being scanned.
+         */
+        BaseNode*	scanLeaf;
+
+        /**
+         * Index of next entry to be scanned in the leaf being scanned.
+         */
+        std::size_t	nextEntry;
+
+        /**
+         * Low INTEGER value for scan.
+         */
+        int			lowValInt;
+
+        /**
+         * High INTEGER value for scan.
+         */
+        int			highValInt;
+
+        /**
+         * Low Operator. Can only be GT(>) or GTE(>=).
+         */
+        Operator	lowOp;
+
+        /**
+         * High Operator. Can only be LT(<) or LTE(<=).
+         */
+        Operator	highOp;
+
+
+        /**
+         * Returns the mapping table entry of a node.
+         */
+        std::atomic<Node*>& entry(NodeId id);
+
+        /**
+         * Gives a new node an id and installs it in the mapping table.
+         * @return Id of the node
+         */
+        NodeId installNode(Node* node);
+
+        /**
+         * Descends from the root to the node on the given level responsible for the key, moving right
+         * past splits.
+         * @param key		Key to search for
+         * @param level		Level of the node, 0 for a leaf
+         * @param head		Set to the record of the node that was current when it was checked
+         * @return Id of the node
+         */
+        NodeId findNode(int key, int level, Node*& head);
+
+        /**
+         * Applies a chain of delta records to a copy of its base node.
+         * @param head		First record of the chain
+         * @return The consolidated node, owned by the caller
+         */
+        BaseNode* consolidated(const Node* head) const;
+
+        /**
+         * Replaces the record chain of a node by a consolidated node and splits it if it is full.
+         * Gives up if another thread changed the node in the meantime.
+         * @param id		Id of the node
+         */
+        void consolidate(NodeId id);
+
+        /**
+         * Splits a full node: installs a split delta on it and posts the new sibling in the parent.
+         * Gives up if another thread changed the node in the meantime.
+         * @param id		Id of the node
+         */
+        void split(NodeId id);
+
+        /**
+         * Adds a child to the parent of a node that split, or puts a new root above the node.
+         * @param id		Id of the node that split
+         * @param level		Level of the node
+         * @param key		Smallest key of the new sibling
+         * @param sibling	Id of the new sibling
+         */
+        void postSibling(NodeId id, int level, int key, NodeId sibling);
+
+        /**
+         * Retires a replaced record chain and frees the retired chains no thread may read anymore.
+         * @param chain		First record of the chain
+         */
+        void retire(Node* chain);
+
+        /**
+         * Frees a record chain.
+         */
+        static void freeChain(Node* chain);
+
+        /**
+         * Builds the tree over leaves read from the index file.
+         * @param leaves	Consolidated leaves in key order
+         */
+        void buildTree(std::vector<BaseNode*>& leaves);
+
+        /**
+         * Loads the consolidated copy of a leaf for the scan.
+         * @param id		Id of the leaf
+         */
+        void loadScanLeaf(NodeId id);
+
+    public:
+
+        /**
+         * BwTreeIndex Constructor.
+         * Check to see if the corresponding index file exists. If so, open the file and load it.
+         * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+         *
+         * @param relationName        Name of file.
+         * @param outIndexName        Return the name of index file.
+         * @param bufMgrIn			  Buffer Manager Instance
+         * @param attrByteOffset	  Offset of attribute, over which index is to be built, in the record
+         * @param attrType			  Datatype of attribute over which index is built
+         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters, or the file holds another kind of index.
+         */
+        BwTreeIndex(const std::string & relationName, std::string & outIndexName,
+                    BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+
+        /**
+         * BwTreeIndex Destructor.
+         * Writes a checkpoint, flushes the index file and frees all nodes. No other thread may use the
+         * index anymore.
+         */
+        ~BwTreeIndex();
+
+
+        /**
+         * Insert a new entry using the pair <value,rid>. Threadsafe and latch-free.
+         * Entries with the same key are all kept, in the same leaf.
+         * @param key			Key to insert, pointer to integer
+         * @param rid			Record ID of a record whose entry is getting inserted into the index.
+         */
+        void insertEntry(const void* key, RecordId rid);
+
+
+        /**
+         * Find the record id of the entry with the given key. Threadsafe and latch-free.
+         * @param key			Key to search for, pointer to integer
+         * @param outRid		RecordId of the entry returned in this
+         * @throws  NoSuchKeyFoundException If there is no entry with the key in the index.
+         */
+        void lookup(const void* key, RecordId& outRid);
+
+
+        /**
+         * Writes the leaves to the index file, through the buffer manager. Until then, entries inserted
+         * since the last checkpoint exist only in memory. No other thread may use the index at the same time.
+         */
+        void checkpoint();
+
+
+        /**
+         * Returns the number of node consolidations so far.
+         */
+        std::uint64_t consolidationCount() const { return consolidations.load(); }
+
+
+        /**
+         * Returns the number of node splits so far.
+         */
+        std::uint64_t splitCount() const { return splits.load(); }
+
+
+        /**
+         * Begin a filtered scan of the index. Each leaf is copied when the scan reaches it, so entries
+         * inserted by other threads in the meantime may or may not be seen.
+         * @param lowVal	Low value of range, pointer to integer
+         * @param lowOp		Low operator (GT/GTE)
+         * @param highVal	High value of range, pointer to integer
+         * @param highOp	High operator (LT/LTE)
+         * @throws  BadOpcodesException If lowOp and highOp do not contain one of their their expected values
+         * @throws  BadScanrangeException If lowVal > highval
+         * @throws  NoSuchKeyFoundException If there is no key in the index that satisfies the scan criteria.
+         */
+        void startScan(const void* lowVal, const Operator lowOp, const void* highVal, const Operator highOp);
+
+
+        /**
+         * Fetch the record id of the next index entry that matches the scan.
+         * @param outRid	RecordId of next record found that satisfies the scan criteria returned in this
+         * @throws ScanNotInitializedException If no scan has been initialized.
+         * @throws IndexScanCompletedException If no more records, satisfying the scan criteria, are left to be scanned.
+         */
+        void scanNext(RecordId& outRid);
+
+
+        /**
+         * Terminate the current scan. Reset scan specific variables.
+         * @throws ScanNotInitializedException If no scan has been initialized.
+         */
+        void endScan();
+
+    };
+
+}
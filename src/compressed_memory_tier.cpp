@@ -0,0 +1,113 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compressed_memory_tier.h"
+
+#include "lz_codec.h"
+
+namespace badgerdb {
+
+CompressedMemoryTier::CompressedMemoryTier(const std::size_t budget_bytes)
+    : budget_bytes_(budget_bytes),
+      bytes_used_(0),
+      hits_(0),
+      misses_(0),
+      admitted_(0),
+      rejected_(0) {
+}
+
+bool CompressedMemoryTier::fetch(const File& file, const PageId page_number,
+                                 Page& page) {
+  const auto pages = store_.find(file.filename());
+  if (pages != store_.end()) {
+    const auto entry = pages->second.find(page_number);
+    if (entry != pages->second.end()) {
+      const bool valid = lz_codec::decompress(
+          entry->second.data.data(), entry->second.data.size(),
+          reinterpret_cast<char*>(&page), Page::SIZE);
+      // The page goes back into the buffer pool either way.
+      erase(pages->second, entry);
+      if (valid) {
+        ++hits_;
+        return true;
+      }
+    }
+  }
+  ++misses_;
+  return false;
+}
+
+void CompressedMemoryTier::admit(const File& file, const PageId page_number,
+                                 const Page& page) {
+  char buffer[MAX_COMPRESSED_SIZE];
+  const std::size_t size =
+      lz_codec::compress(reinterpret_cast<const char*>(&page), Page::SIZE,
+                         buffer, sizeof(buffer));
+
+  std::unordered_map<PageId, Entry>& pages = store_[file.filename()];
+  const auto existing = pages.find(page_number);
+  if (existing != pages.end()) {
+    erase(pages, existing);
+  }
+  if (size == 0 || size > budget_bytes_) {
+    ++rejected_;
+    return;
+  }
+
+  while (bytes_used_ + size > budget_bytes_) {
+    std::unordered_map<PageId, Entry>& victims = store_[order_.front().first];
+    erase(victims, victims.find(order_.front().second));
+  }
+
+  Entry& entry = pages[page_number];
+  entry.data.assign(buffer, size);
+  entry.position =
+      order_.insert(order_.end(), std::make_pair(file.filename(), page_number));
+  bytes_used_ += size;
+  ++admitted_;
+}
+
+void CompressedMemoryTier::invalidate(const File& file,
+                                      const PageId page_number) {
+  const auto pages = store_.find(file.filename());
+  if (pages == store_.end()) {
+    return;
+  }
+  const auto entry = pages->second.find(page_number);
+  if (entry != pages->second.end()) {
+    erase(pages->second, entry);
+  }
+}
+
+void CompressedMemoryTier::invalidateFile(const File& file) {
+  const auto pages = store_.find(file.filename());
+  if (pages == store_.end()) {
+    return;
+  }
+  for (const auto& entry : pages->second) {
+    bytes_used_ -= entry.second.data.size();
+    order_.erase(entry.second.position);
+  }
+  store_.erase(pages);
+}
+
+double CompressedMemoryTier::compressionRatio() const {
+  if (bytes_used_ == 0) {
+    return 0;
+  }
+  return static_cast<double>(order_.size() * Page::SIZE) / bytes_used_;
+}
+
+void CompressedMemoryTier::erase(
+    std::unordered_map<PageId, Entry>& pages,
+    std::unordered_map<PageId, Entry>::iterator entry) {
+  bytes_used_ -= entry->second.data.size();
+  order_.erase(entry->second.position);
+  pages.erase(entry);
+}
+
+}
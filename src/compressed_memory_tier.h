@@ -0,0 +1,142 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "file.h"
+#include "page.h"
+#include "page_tier.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Page tier keeping evicted pages compressed in memory.
+ *
+ * Pages leaving the buffer pool are compressed with lz_codec and kept in a
+ * store bounded by a memory budget.  A miss in the buffer pool decompresses
+ * the page from the store, which is far cheaper than reading it from disk.
+ * Index and heap pages are mostly empty slots and sorted keys, so the store
+ * typically holds several times as many pages as the same memory would as
+ * frames.
+ *
+ * The store is exclusive: a page moves back into the buffer pool when it is
+ * fetched and is only compressed again when it is evicted again, so no memory
+ * is spent on pages that are also in the pool.  Pages that do not shrink
+ * below MAX_COMPRESSED_SIZE are declined.  When the budget is exhausted, the
+ * least recently admitted pages are dropped.
+ *
+ * @warning This class is not threadsafe.
+ */
+class CompressedMemoryTier : public PageTier {
+ public:
+  /**
+   * Largest compressed page the tier keeps.  Pages that do not compress to
+   * this size are not worth the memory or the decompression.
+   */
+  static const std::size_t MAX_COMPRESSED_SIZE = Page::SIZE * 3 / 4;
+
+  /**
+   * Creates an empty tier.
+   *
+   * @param budget_bytes  Memory the compressed pages may occupy.
+   */
+  explicit CompressedMemoryTier(const std::size_t budget_bytes);
+
+  bool fetch(const File& file, const PageId page_number, Page& page) override;
+  void admit(const File& file, const PageId page_number,
+             const Page& page) override;
+  void invalidate(const File& file, const PageId page_number) override;
+  void invalidateFile(const File& file) override;
+
+  /**
+   * Returns the number of pages found by fetch().
+   */
+  std::uint64_t hits() const { return hits_; }
+
+  /**
+   * Returns the number of pages not found by fetch().
+   */
+  std::uint64_t misses() const { return misses_; }
+
+  /**
+   * Returns the number of pages stored by admit().
+   */
+  std::uint64_t admitted() const { return admitted_; }
+
+  /**
+   * Returns the number of pages admit() declined as incompressible.
+   */
+  std::uint64_t rejected() const { return rejected_; }
+
+  /**
+   * Returns the number of pages currently held.
+   */
+  std::size_t size() const { return order_.size(); }
+
+  /**
+   * Returns the number of compressed bytes currently held.
+   */
+  std::size_t bytesUsed() const { return bytes_used_; }
+
+  /**
+   * Returns the uncompressed size of the held pages divided by their
+   * compressed size, or 0 if the tier is empty.
+   */
+  double compressionRatio() const;
+
+ private:
+  typedef std::list<std::pair<std::string, PageId> > AdmitOrder;
+
+  /**
+   * Compressed page and its position in the admission order.
+   */
+  struct Entry {
+    std::string data;
+    AdmitOrder::iterator position;
+  };
+
+  /**
+   * Removes a page from the store.
+   */
+  void erase(std::unordered_map<PageId, Entry>& pages,
+             std::unordered_map<PageId, Entry>::iterator entry);
+
+  /**
+   * Memory the compressed pages may occupy.
+   */
+  std::size_t budget_bytes_;
+
+  /**
+   * Memory the compressed pages occupy.
+   */
+  std::size_t bytes_used_;
+
+  /**
+   * Compressed pages by file name and page number.
+   */
+  std::unordered_map<std::string, std::unordered_map<PageId, Entry> > store_;
+
+  /**
+   * Held pages, least recently admitted first.
+   */
+  AdmitOrder order_;
+
+  std::uint64_t hits_;
+  std::uint64_t misses_;
+  std::uint64_t admitted_;
+  std::uint64_t rejected_;
+};
+
+}
@@ -0,0 +1,26 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "invalid_page_size_exception.h"
+
+#include <sstream>
+#include <string>
+
+namespace badgerdb {
+
+InvalidPageSizeException::InvalidPageSizeException(
+    const std::string& file, const std::size_t page_size)
+    : BadgerDbException(""),
+      filename_(file),
+      page_size_(page_size) {
+  std::stringstream ss;
+  ss << "File '" << filename_ << "' was created with a page size of "
+     << page_size_ << " bytes, which does not match this build.";
+  message_.assign(ss.str());
+}
+
+}
@@ -0,0 +1,61 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "badgerdb_exception.h"
+
+namespace badgerdb {
+
+/**
+ * @brief An exception that is thrown when a file is opened that was created
+ *        with a different page size than the one the system was compiled
+ *        with.
+ */
+class InvalidPageSizeException : public BadgerDbException {
+ public:
+  /**
+   * Constructs an invalid page size exception for the given file.
+   *
+   * @param file       Name of the file.
+   * @param page_size  Page size recorded in the file.
+   */
+  InvalidPageSizeException(const std::string& file,
+                           const std::size_t page_size);
+
+  /**
+   * Destroys the exception.  Does nothing special; just included to make the
+   * compiler happy.
+   */
+  virtual ~InvalidPageSizeException() throw() {}
+
+  /**
+   * Returns the page size recorded in the file.
+   */
+  virtual std::size_t page_size() const { return page_size_; }
+
+  /**
+   * Returns name of the file that caused this exception.
+   */
+  virtual const std::string& filename() const { return filename_; }
+
+ protected:
+  /**
+   * Name of file which caused this exception.
+   */
+  const std::string filename_;
+
+  /**
+   * Page size recorded in the file.
+   */
+  const std::size_t page_size_;
+};
+
+}
@@ -13,18 +13,29 @@
 #include <string>
 #include <cstdio>
 #include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "exceptions/file_exists_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
+#include "exceptions/invalid_page_size_exception.h"
 #include "file_iterator.h"
+#include "lz_codec.h"
 #include "page.h"
 
 namespace badgerdb {
 
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+BlobFile::ExtentMap BlobFile::extents_;
+MappedBlobFile::MappingMap MappedBlobFile::mappings_;
+CompressedBlobFile::DirectoryMap CompressedBlobFile::directories_;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
@@ -59,6 +70,20 @@ File::~File() {
 }
 
 
+void File::readPages(const PageId first_page_number,
+                     const std::vector<Page*>& pages) const {
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    *pages[i] = readPage(first_page_number + i);
+  }
+}
+
+void File::writePages(const PageId first_page_number,
+                      const std::vector<const Page*>& pages) {
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    writePage(first_page_number + i, *pages[i]);
+  }
+}
+
 PageId File::getFirstPageNo() {
   const FileHeader& header = readHeader();
   return header.first_used_page;
@@ -70,11 +95,23 @@ File::File(const std::string& name, const bool create_new) : filename_(name) {
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
-                         0 /* num_free_pages */, 0 /* first_free_page */};
+                         0 /* num_free_pages */, 0 /* first_free_page */,
+                         Page::SIZE /* page_size */};
     writeHeader(header);
+  } else {
+    const std::uint32_t page_size = readHeader().page_size;
+    if (page_size != Page::SIZE) {
+      close();
+      throw InvalidPageSizeException(filename_, page_size);
+    }
   }
 }
 
+File::File(const std::string& name,
+           const std::shared_ptr<std::fstream>& stream)
+    : filename_(name), stream_(stream) {
+}
+
 void File::openIfNeeded(const bool create_new) {
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
     ++open_counts_[filename_];
@@ -103,6 +140,11 @@ void File::openIfNeeded(const bool create_new) {
 }
 
 void File::close() {
+  if (open_counts_.find(filename_) == open_counts_.end()) {
+    // A view on another file's stream.
+    stream_.reset();
+    return;
+  }
 	if(open_counts_[filename_] > 0)
   	--open_counts_[filename_];
 
@@ -122,7 +164,7 @@ FileHeader File::readHeader() const {
   return header;
 }
 
-void File::writeHeader(const FileHeader& header) {
+void File::writeHeader(const FileHeader& header) const {
   stream_->seekp(0 /* pos */, std::ios::beg);
   stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
   stream_->flush();
@@ -235,6 +277,25 @@ Page PageFile::allocatePage(PageId &new_page_number) {
   return new_page;
 }
 
+void PageFile::readPages(const PageId first_page_number,
+                         const std::vector<Page*>& pages) const {
+  const FileHeader header = readHeader();
+  if (first_page_number + pages.size() > header.num_pages) {
+    throw InvalidPageException(first_page_number + pages.size() - 1,
+                               filename_);
+  }
+
+  stream_->seekg(pagePosition(first_page_number), std::ios::beg);
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    stream_->read(reinterpret_cast<char*>(&pages[i]->header_),
+                  sizeof(PageHeader));
+    stream_->read(&pages[i]->data_[0], Page::DATA_SIZE);
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(first_page_number + i, filename_);
+    }
+  }
+}
+
 Page PageFile::readPage(const PageId page_number) const {
   FileHeader header = readHeader();
 
@@ -273,6 +334,31 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 	writePage(new_page_number, header, new_page);
 }
 
+void PageFile::writePages(const PageId first_page_number,
+                          const std::vector<const Page*>& pages) {
+  // Collect the headers to write first so the run itself can be written
+  // without seeking back and forth.
+  std::vector<PageHeader> headers(pages.size());
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    const PageId page_number = first_page_number + i;
+    const PageHeader on_disk = readPageHeader(page_number);
+    if (on_disk.current_page_number == Page::INVALID_NUMBER) {
+      // Page has been deleted since it was read.
+      throw InvalidPageException(page_number, filename_);
+    }
+    // As in writePage(), keep the next page pointer that is on disk.
+    headers[i] = pages[i]->header_;
+    headers[i].next_page_number = on_disk.next_page_number;
+  }
+
+  stream_->seekp(pagePosition(first_page_number), std::ios::beg);
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    stream_->write(reinterpret_cast<const char*>(&headers[i]), sizeof(PageHeader));
+    stream_->write(&pages[i]->data_[0], Page::DATA_SIZE);
+  }
+  stream_->flush();
+}
+
 void PageFile::deletePage(const PageId page_number) {
   FileHeader header = readHeader();
 
@@ -341,41 +427,131 @@ BlobFile BlobFile::open(const std::string& filename) {
 
 BlobFile::BlobFile(const std::string& name, const bool create_new)
 : File(name, create_new) {
+  openExtent();
 }
 
 BlobFile::~BlobFile() {
+  try {
+    closeExtent();
+  } catch (...) {
+    // Destructors must not throw.
+  }
 }
 
 BlobFile::BlobFile(const BlobFile& other)
 : File(other.filename_, false /* create_new */)
 {
+  openExtent();
 }
 
 BlobFile& BlobFile::operator=(const BlobFile& rhs) {
   // This accounts for self-assignment and assignment of a File object for the
   // same file.
+  closeExtent();
   close();	//close my file and associate me with the new one
   filename_ = rhs.filename_;
   openIfNeeded(false /* create_new */);
+  openExtent();
   return *this;
 }
 
+void BlobFile::openExtent() {
+  const ExtentMap::iterator existing = extents_.find(filename_);
+  if (existing != extents_.end()) {
+    extent_ = existing->second;
+    return;
+  }
+
+  extent_.reset(new Extent);
+  extent_->header = readHeader();
+  stream_->seekg(0 /* pos */, std::ios::end);
+  const std::streamoff size = stream_->tellg();
+  extent_->backed_pages = 1;
+  if (size > static_cast<std::streamoff>(sizeof(FileHeader))) {
+    extent_->backed_pages += (size - sizeof(FileHeader)) / Page::SIZE;
+  }
+  extent_->dirty = false;
+  extents_[filename_] = extent_;
+}
+
+void BlobFile::closeExtent() {
+  if (open_counts_[filename_] == 1) {
+    sync();
+    extents_.erase(filename_);
+  }
+  extent_.reset();
+}
+
+void BlobFile::extend(const PageId page_number) const {
+  if (page_number < extent_->backed_pages) {
+    return;
+  }
+  PageId backed_pages = extent_->backed_pages + EXTENSION_PAGES;
+  if (backed_pages <= page_number) {
+    backed_pages = page_number + 1;
+  }
+
+  // Reserve the space in one go; where fallocate is not available, writing
+  // the last byte at least extends the file in one step.
+  const std::streamoff start = pagePosition(extent_->backed_pages);
+  const std::streamoff end = pagePosition(backed_pages);
+  bool allocated = false;
+  const int fd = ::open(filename_.c_str(), O_WRONLY);
+  if (fd >= 0) {
+    allocated = posix_fallocate(fd, start, end - start) == 0;
+    ::close(fd);
+  }
+  if (!allocated) {
+    stream_->seekp(end - 1, std::ios::beg);
+    stream_->put('\0');
+    stream_->flush();
+  }
+  extent_->backed_pages = backed_pages;
+}
+
 Page BlobFile::allocatePage(PageId &new_page_number) {
-  FileHeader header = readHeader();
-	Page new_page;
+	new_page_number = reservePage();
+
+	// Nothing is written: the page exists on disk once it is written back
+	return Page();
+}
 
-	new_page_number = header.num_pages;
+PageId BlobFile::reservePage() const {
+	FileHeader& header = extent_->header;
+	const PageId page_number = header.num_pages;
 
 	if (header.first_used_page == Page::INVALID_NUMBER) {
 		header.first_used_page = header.num_pages;
 	}
 
 	++header.num_pages;
+	extent_->dirty = true;
+	extend(page_number);
+	return page_number;
+}
 
-	writePage(new_page_number, new_page);
-	writeHeader(header);
+PageId BlobFile::getFirstPageNo() {
+	return extent_->header.first_used_page;
+}
 
-	return new_page;
+void BlobFile::sync() const {
+	if (extent_->dirty) {
+		writeHeader(extent_->header);
+		extent_->dirty = false;
+	}
+}
+
+void BlobFile::readPages(const PageId first_page_number,
+                         const std::vector<Page*>& pages) const {
+	stream_->seekg(pagePosition(first_page_number), std::ios::beg);
+	for (std::size_t i = 0; i < pages.size(); ++i) {
+		stream_->read(reinterpret_cast<char*>(pages[i]), Page::SIZE);
+		if (!*stream_) {
+			// Read past the end of the file.
+			stream_->clear();
+			throw InvalidPageException(first_page_number + i, filename_);
+		}
+	}
 }
 
 Page BlobFile::readPage(const PageId page_number) const {
@@ -386,14 +562,692 @@ Page BlobFile::readPage(const PageId page_number) const {
 }
 
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
+	writeBlock(new_page_number, new_page);
+}
+
+void BlobFile::writeBlock(const PageId new_page_number, const Page& new_page) const {
 	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
 	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
 	stream_->flush();
 }
 
+void BlobFile::writePages(const PageId first_page_number,
+                          const std::vector<const Page*>& pages) {
+	stream_->seekp(pagePosition(first_page_number), std::ios::beg);
+	for (std::size_t i = 0; i < pages.size(); ++i) {
+		stream_->write(reinterpret_cast<const char*>(pages[i]), Page::SIZE);
+	}
+	stream_->flush();
+}
+
 //delePage should not be called for a blob_file, not supported
 void BlobFile::deletePage(const PageId page_number) {
 	throw InvalidPageException(page_number, filename_);
 }
 
+bool CompressedBlobFile::isCompressed(const std::string& filename) {
+  std::ifstream stream(filename.c_str(), std::ifstream::binary);
+  CompressedFileHeader header;
+  stream.read(reinterpret_cast<char*>(&header), sizeof(header));
+  return stream && header.magic == MAGIC;
+}
+
+CompressedBlobFile::CompressedBlobFile(const std::string& name,
+                                       const bool create_new)
+    : File(name, create_new) {
+  openDirectory(create_new);
+}
+
+CompressedBlobFile::CompressedBlobFile(const CompressedBlobFile& other)
+    : File(other.filename_, false /* create_new */) {
+  openDirectory(false /* create_new */);
+}
+
+CompressedBlobFile& CompressedBlobFile::operator=(
+    const CompressedBlobFile& rhs) {
+  closeDirectory();
+  close();
+  filename_ = rhs.filename_;
+  openIfNeeded(false /* create_new */);
+  openDirectory(false /* create_new */);
+  return *this;
+}
+
+CompressedBlobFile::~CompressedBlobFile() {
+  try {
+    closeDirectory();
+  } catch (...) {
+    // Destructors must not throw.
+  }
+}
+
+void CompressedBlobFile::openDirectory(const bool create_new) {
+  const DirectoryMap::iterator existing = directories_.find(filename_);
+  if (existing != directories_.end()) {
+    directory_ = existing->second;
+    return;
+  }
+
+  std::shared_ptr<Directory> directory(new Directory);
+  if (create_new) {
+    directory->end = sizeof(CompressedFileHeader);
+    directory->directory_offset = directory->end;
+    directory->directory_pages = 0;
+    directory->directory_capacity = 0;
+    directory->spare_offset = directory->end;
+    directory->spare_capacity = 0;
+    directory->dirty = false;
+    directory_ = directory;
+    writeCompressedHeader();
+  } else {
+    CompressedFileHeader header;
+    stream_->seekg(0 /* pos */, std::ios::beg);
+    stream_->read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!*stream_ || header.magic != MAGIC) {
+      stream_->clear();
+      throw FileOpenException(filename_);
+    }
+    directory->slots.resize(header.directory_pages);
+    if (!directory->slots.empty()) {
+      stream_->seekg(header.directory_offset, std::ios::beg);
+      stream_->read(reinterpret_cast<char*>(&directory->slots[0]),
+                    directory->slots.size() * sizeof(CompressedPageSlot));
+      if (!*stream_) {
+        stream_->clear();
+        throw FileOpenException(filename_);
+      }
+    }
+    directory->directory_offset = header.directory_offset;
+    directory->directory_pages = header.directory_pages;
+    directory->directory_capacity = header.directory_capacity;
+    directory->spare_offset = header.spare_offset;
+    directory->spare_capacity = header.spare_capacity;
+    directory->dirty = false;
+    directory_ = directory;
+    findFreeSlots();
+  }
+  directories_[filename_] = directory_;
+}
+
+void CompressedBlobFile::findFreeSlots() const {
+  Directory& directory = *directory_;
+  std::vector<std::pair<std::uint64_t, std::uint64_t> > used;
+  for (const CompressedPageSlot& slot : directory.slots) {
+    if (slot.capacity > 0) {
+      used.push_back(std::make_pair(slot.offset, slot.capacity));
+    }
+  }
+  used.push_back(std::make_pair(directory.directory_offset,
+                                directory.directory_capacity));
+  used.push_back(std::make_pair(directory.spare_offset,
+                                directory.spare_capacity));
+  std::sort(used.begin(), used.end());
+
+  // Everything between the used ranges was left behind by moved pages, or
+  // written after the last sync and lost.
+  std::uint64_t position = sizeof(CompressedFileHeader);
+  for (const auto& range : used) {
+    if (range.second == 0) {
+      continue;
+    }
+    if (range.first > position) {
+      freeRange(position, range.first - position);
+    }
+    position = std::max(position, range.first + range.second);
+  }
+  directory.end = position;
+}
+
+void CompressedBlobFile::freeRange(std::uint64_t offset,
+                                   std::uint64_t length) const {
+  while (length >= SLOT_GRANULE) {
+    const std::uint64_t capacity = length >= Page::SIZE
+        ? Page::SIZE : length / SLOT_GRANULE * SLOT_GRANULE;
+    directory_->free_slots.insert(
+        std::make_pair(static_cast<std::uint32_t>(capacity), offset));
+    offset += capacity;
+    length -= capacity;
+  }
+}
+
+void CompressedBlobFile::closeDirectory() {
+  if (open_counts_[filename_] == 1) {
+    sync();
+    directories_.erase(filename_);
+  }
+  directory_.reset();
+}
+
+void CompressedBlobFile::sync() const {
+  Directory& directory = *directory_;
+  if (!directory.dirty) {
+    return;
+  }
+  // The new directory goes to the spare space, so the one of the last sync
+  // stays intact until the header points to the new one.  A spare that is
+  // too small is replaced by one at the end with room to grow.
+  const std::uint64_t bytes =
+      directory.slots.size() * sizeof(CompressedPageSlot);
+  if (directory.spare_capacity < bytes) {
+    freeRange(directory.spare_offset, directory.spare_capacity);
+    directory.spare_offset = directory.end;
+    directory.spare_capacity = (bytes + bytes / 2 + SLOT_GRANULE - 1) /
+        SLOT_GRANULE * SLOT_GRANULE;
+    directory.end += directory.spare_capacity;
+  }
+  stream_->seekp(directory.spare_offset, std::ios::beg);
+  if (!directory.slots.empty()) {
+    stream_->write(reinterpret_cast<const char*>(&directory.slots[0]), bytes);
+  }
+  stream_->flush();
+  std::swap(directory.directory_offset, directory.spare_offset);
+  std::swap(directory.directory_capacity, directory.spare_capacity);
+  directory.directory_pages = directory.slots.size();
+  directory.dirty = false;
+  writeCompressedHeader();
+
+  // No directory on disk points to the slots left behind since the last
+  // sync anymore.
+  for (const auto& slot : directory.freed_slots) {
+    directory.free_slots.insert(slot);
+  }
+  directory.freed_slots.clear();
+}
+
+void CompressedBlobFile::writeCompressedHeader() const {
+  const Directory& directory = *directory_;
+  CompressedFileHeader header;
+  header.file_header.num_pages = directory.slots.size() + 1;
+  header.file_header.first_used_page = directory.slots.empty() ? 0 : 1;
+  header.file_header.num_free_pages = 0;
+  header.file_header.first_free_page = 0;
+  header.file_header.page_size = Page::SIZE;
+  header.magic = MAGIC;
+  header.directory_offset = directory.directory_offset;
+  header.directory_pages = directory.directory_pages;
+  header.directory_capacity = directory.directory_capacity;
+  header.spare_offset = directory.spare_offset;
+  header.spare_capacity = directory.spare_capacity;
+  stream_->seekp(0 /* pos */, std::ios::beg);
+  stream_->write(reinterpret_cast<const char*>(&header), sizeof(header));
+  stream_->flush();
+}
+
+Page CompressedBlobFile::allocatePage(PageId &new_page_number) {
+  Page new_page;
+  directory_->slots.push_back(CompressedPageSlot());
+  directory_->slots.back().size = 0;
+  directory_->slots.back().capacity = 0;
+  new_page_number = directory_->slots.size();
+  writePage(new_page_number, new_page);
+  if (new_page_number == 1) {
+    // Make the first page visible to File::getFirstPageNo().
+    writeCompressedHeader();
+  }
+  return new_page;
+}
+
+Page CompressedBlobFile::readPage(const PageId page_number) const {
+  const std::vector<CompressedPageSlot>& slots = directory_->slots;
+  if (page_number == Page::INVALID_NUMBER || page_number > slots.size() ||
+      slots[page_number - 1].size == 0) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  const CompressedPageSlot& slot = slots[page_number - 1];
+
+  char buffer[Page::SIZE];
+  stream_->seekg(slot.offset, std::ios::beg);
+  stream_->read(buffer, slot.size);
+  if (!*stream_) {
+    stream_->clear();
+    throw InvalidPageException(page_number, filename_);
+  }
+
+  Page page;
+  if (slot.size == Page::SIZE) {
+    std::memcpy(reinterpret_cast<char*>(&page), buffer, Page::SIZE);
+  } else if (!lz_codec::decompress(buffer, slot.size,
+                                   reinterpret_cast<char*>(&page),
+                                   Page::SIZE)) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
+
+void CompressedBlobFile::writePage(const PageId page_number,
+                                   const Page& new_page) {
+  Directory& directory = *directory_;
+  if (page_number == Page::INVALID_NUMBER) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  if (page_number > directory.slots.size()) {
+    CompressedPageSlot unused = {0 /* offset */, 0 /* size */, 0 /* capacity */};
+    directory.slots.resize(page_number, unused);
+  }
+
+  // Pages that do not compress below a page are stored as they are.
+  char buffer[Page::SIZE];
+  const char* data = buffer;
+  std::uint32_t size = lz_codec::compress(
+      reinterpret_cast<const char*>(&new_page), Page::SIZE, buffer,
+      Page::SIZE - 1);
+  if (size == 0) {
+    data = reinterpret_cast<const char*>(&new_page);
+    size = Page::SIZE;
+  }
+
+  CompressedPageSlot& slot = directory.slots[page_number - 1];
+  if (size > slot.capacity) {
+    std::uint32_t capacity = (size + SLOT_GRANULE - 1) / SLOT_GRANULE * SLOT_GRANULE;
+    if (capacity > Page::SIZE) {
+      capacity = Page::SIZE;
+    }
+    if (slot.capacity > 0) {
+      directory.freed_slots.push_back(std::make_pair(slot.capacity, slot.offset));
+    }
+    const auto free_slot = directory.free_slots.lower_bound(capacity);
+    if (free_slot != directory.free_slots.end()) {
+      // The rest of a larger free slot stays free.
+      slot.offset = free_slot->second;
+      slot.capacity = capacity;
+      if (free_slot->first > capacity) {
+        directory.free_slots.insert(std::make_pair(
+            free_slot->first - capacity, free_slot->second + capacity));
+      }
+      directory.free_slots.erase(free_slot);
+    } else {
+      slot.offset = directory.end;
+      slot.capacity = capacity;
+      directory.end += capacity;
+    }
+  }
+  slot.size = size;
+  directory.dirty = true;
+
+  stream_->seekp(slot.offset, std::ios::beg);
+  stream_->write(data, size);
+  stream_->flush();
+}
+
+//deletePage is not supported, as for BlobFile
+void CompressedBlobFile::deletePage(const PageId page_number) {
+  throw InvalidPageException(page_number, filename_);
+}
+
+std::uint64_t CompressedBlobFile::storedBytes() const {
+  std::uint64_t bytes = 0;
+  for (const CompressedPageSlot& slot : directory_->slots) {
+    bytes += slot.size;
+  }
+  return bytes;
+}
+
+bool MappedBlobFile::isMapped(const std::string& filename) {
+  // Either root page may be the one a sync was interrupted writing
+  std::ifstream stream(filename.c_str(), std::ifstream::binary);
+  for (PageId page = 1; page <= 2; ++page) {
+    std::uint64_t magic = 0;
+    stream.seekg(pagePosition(page), std::ios::beg);
+    stream.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    if (stream && magic == MAGIC) {
+      return true;
+    }
+  }
+  return false;
+}
+
+MappedBlobFile::MappedBlobFile(const std::string& name, const bool create_new,
+                               const bool shadow)
+    : BlobFile(name, create_new) {
+  openMapping(create_new, shadow);
+}
+
+MappedBlobFile::MappedBlobFile(const MappedBlobFile& other)
+    : BlobFile(other) {
+  openMapping(false /* create_new */, false /* shadow */);
+}
+
+MappedBlobFile& MappedBlobFile::operator=(const MappedBlobFile& rhs) {
+  closeMapping();
+  BlobFile::operator=(rhs);
+  openMapping(false /* create_new */, false /* shadow */);
+  return *this;
+}
+
+MappedBlobFile::~MappedBlobFile() {
+  try {
+    closeMapping();
+  } catch (...) {
+    // Destructors must not throw.
+  }
+}
+
+void MappedBlobFile::openMapping(const bool create_new, const bool shadow) {
+  const MappingMap::iterator existing = mappings_.find(filename_);
+  if (existing != mappings_.end()) {
+    mapping_ = existing->second;
+    return;
+  }
+
+  mapping_.reset(new Mapping);
+  mapping_->dirty = true;
+  mapping_->shadow = shadow;
+  mapping_->epoch = 0;
+  if (create_new) {
+    // Physical pages 1 and 2 hold the root of the mapping.
+    reservePage();
+    reservePage();
+    sync();
+  } else {
+    // The valid root of the latest sync is in effect
+    Page root_pages[2] = {BlobFile::readPage(1), BlobFile::readPage(2)};
+    const MappingRoot* root = NULL;
+    for (const Page& root_page : root_pages) {
+      const MappingRoot* candidate =
+          reinterpret_cast<const MappingRoot*>(&root_page);
+      if (candidate->magic == MAGIC &&
+          candidate->num_map_pages <= MAX_MAP_PAGES &&
+          candidate->checksum == rootChecksum(*candidate) &&
+          (root == NULL || candidate->epoch > root->epoch)) {
+        root = candidate;
+      }
+    }
+    if (root == NULL) {
+      throw FileOpenException(filename_);
+    }
+    mapping_->epoch = root->epoch;
+    mapping_->shadow = root->shadow != 0;
+    mapping_->map_pages.assign(root->map_pages,
+                               root->map_pages + root->num_map_pages);
+    mapping_->physical.resize(root->num_logical_pages);
+    mapping_->fresh.assign(root->num_logical_pages, false);
+    for (std::size_t i = 0; i < mapping_->map_pages.size(); ++i) {
+      Page map_page = BlobFile::readPage(mapping_->map_pages[i]);
+      const std::size_t first = i * ENTRIES_PER_MAP_PAGE;
+      std::size_t count = mapping_->physical.size() - first;
+      if (count > ENTRIES_PER_MAP_PAGE) {
+        count = ENTRIES_PER_MAP_PAGE;
+      }
+      std::memcpy(&mapping_->physical[first],
+                  reinterpret_cast<const char*>(&map_page),
+                  count * sizeof(PageId));
+    }
+
+    // Every physical page that is neither a root, a map page nor mapped is
+    // free; the lowest numbers are handed out first.
+    std::vector<bool> used(allocatedPages(), false);
+    used[0] = used[1] = used[2] = true;
+    for (const PageId page : mapping_->map_pages) {
+      used[page] = true;
+    }
+    for (const PageId page : mapping_->physical) {
+      used[page] = true;
+    }
+    for (PageId page = used.size(); page > 1; --page) {
+      if (!used[page - 1]) {
+        mapping_->free_pages.push_back(page - 1);
+      }
+    }
+    mapping_->dirty = false;
+  }
+  mappings_[filename_] = mapping_;
+}
+
+void MappedBlobFile::closeMapping() {
+  if (open_counts_[filename_] == 1) {
+    sync();
+    mappings_.erase(filename_);
+  }
+  mapping_.reset();
+}
+
+PageId MappedBlobFile::allocatePhysical() const {
+  if (!mapping_->free_pages.empty()) {
+    const PageId page = mapping_->free_pages.back();
+    mapping_->free_pages.pop_back();
+    return page;
+  }
+  return reservePage();
+}
+
+Page MappedBlobFile::allocatePage(PageId &new_page_number) {
+  if (mapping_->physical.size() >= MAX_MAP_PAGES * ENTRIES_PER_MAP_PAGE) {
+    throw InvalidPageException(mapping_->physical.size() + 1, filename_);
+  }
+  mapping_->physical.push_back(allocatePhysical());
+  mapping_->fresh.push_back(true);
+  mapping_->dirty = true;
+  new_page_number = mapping_->physical.size();
+  return Page();
+}
+
+PageId MappedBlobFile::physicalPageNo(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER ||
+      page_number > mapping_->physical.size()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return mapping_->physical[page_number - 1];
+}
+
+Page MappedBlobFile::readPage(const PageId page_number) const {
+  return BlobFile::readPage(physicalPageNo(page_number));
+}
+
+void MappedBlobFile::releasePhysical(const PageId page_number,
+                                     const PageId old_page) {
+  Mapping& mapping = *mapping_;
+  if (mapping.shadow && !mapping.fresh[page_number - 1]) {
+    mapping.retired.push_back(std::make_pair(mapping.epoch, old_page));
+    mapping.fresh[page_number - 1] = true;
+  } else {
+    mapping.free_pages.push_back(old_page);
+  }
+}
+
+void MappedBlobFile::shadowPage(const PageId page_number) {
+  const PageId old_page = physicalPageNo(page_number);
+  if (mapping_->shadow && !mapping_->fresh[page_number - 1]) {
+    mapping_->physical[page_number - 1] = allocatePhysical();
+    releasePhysical(page_number, old_page);
+    mapping_->dirty = true;
+  }
+}
+
+void MappedBlobFile::writePage(const PageId page_number, const Page& new_page) {
+  shadowPage(page_number);
+  BlobFile::writePage(physicalPageNo(page_number), new_page);
+}
+
+void MappedBlobFile::readPages(const PageId first_page_number,
+                               const std::vector<Page*>& pages) const {
+  std::size_t i = 0;
+  while (i < pages.size()) {
+    const PageId first = physicalPageNo(first_page_number + i);
+    std::size_t j = i + 1;
+    while (j < pages.size() &&
+           physicalPageNo(first_page_number + j) == first + (j - i)) {
+      ++j;
+    }
+    BlobFile::readPages(first, std::vector<Page*>(pages.begin() + i,
+                                                  pages.begin() + j));
+    i = j;
+  }
+}
+
+void MappedBlobFile::writePages(const PageId first_page_number,
+                                const std::vector<const Page*>& pages) {
+  for (std::size_t i = 0; i < pages.size(); ++i) {
+    shadowPage(first_page_number + i);
+  }
+  std::size_t i = 0;
+  while (i < pages.size()) {
+    const PageId first = physicalPageNo(first_page_number + i);
+    std::size_t j = i + 1;
+    while (j < pages.size() &&
+           physicalPageNo(first_page_number + j) == first + (j - i)) {
+      ++j;
+    }
+    BlobFile::writePages(first, std::vector<const Page*>(pages.begin() + i,
+                                                         pages.begin() + j));
+    i = j;
+  }
+}
+
+PageId MappedBlobFile::getFirstPageNo() {
+  return mapping_->physical.empty() ? Page::INVALID_NUMBER : 1;
+}
+
+void MappedBlobFile::relocate(const PageId page_number) {
+  const PageId old_page = physicalPageNo(page_number);
+  const PageId new_page = reservePage();
+  BlobFile::writePage(new_page, BlobFile::readPage(old_page));
+  mapping_->physical[page_number - 1] = new_page;
+  releasePhysical(page_number, old_page);
+  mapping_->dirty = true;
+}
+
+void MappedBlobFile::reorganize(const std::vector<PageId>& page_numbers) {
+  for (const PageId page_number : page_numbers) {
+    relocate(page_number);
+  }
+}
+
+void MappedBlobFile::sync() const {
+  Mapping& mapping = *mapping_;
+  if (mapping.dirty) {
+    // The table goes to fresh map pages; the old ones are only freed once the
+    // root points to the new ones.
+    const std::size_t num_map_pages =
+        (mapping.physical.size() + ENTRIES_PER_MAP_PAGE - 1) /
+        ENTRIES_PER_MAP_PAGE;
+    std::vector<PageId> map_pages(num_map_pages);
+    for (std::size_t i = 0; i < num_map_pages; ++i) {
+      map_pages[i] = allocatePhysical();
+
+      Page map_page;
+      std::memset(reinterpret_cast<char*>(&map_page), 0, Page::SIZE);
+      const std::size_t first = i * ENTRIES_PER_MAP_PAGE;
+      std::size_t count = mapping.physical.size() - first;
+      if (count > ENTRIES_PER_MAP_PAGE) {
+        count = ENTRIES_PER_MAP_PAGE;
+      }
+      std::memcpy(reinterpret_cast<char*>(&map_page), &mapping.physical[first],
+                  count * sizeof(PageId));
+      writeBlock(map_pages[i], map_page);
+    }
+    // Every page the new root refers to must be on disk first.
+    BlobFile::sync();
+    forceToDisk();
+
+    Page root_page;
+    std::memset(reinterpret_cast<char*>(&root_page), 0, Page::SIZE);
+    MappingRoot* root = reinterpret_cast<MappingRoot*>(&root_page);
+    root->magic = MAGIC;
+    root->num_logical_pages = mapping.physical.size();
+    root->num_map_pages = num_map_pages;
+    root->shadow = mapping.shadow ? 1 : 0;
+    root->epoch = mapping.epoch + 1;
+    std::copy(map_pages.begin(), map_pages.end(), root->map_pages);
+    root->checksum = rootChecksum(*root);
+
+    // The root of the last sync stays intact in the other root page until
+    // this one is on disk.
+    writeBlock(1 + (root->epoch & 1), root_page);
+    forceToDisk();
+
+    mapping.free_pages.insert(mapping.free_pages.end(),
+                              mapping.map_pages.begin(),
+                              mapping.map_pages.end());
+    mapping.map_pages = map_pages;
+    mapping.dirty = false;
+
+    // The pages of the previous commit are free once no snapshot of it or of
+    // an earlier commit remains.
+    const std::uint64_t oldest = mapping.snapshots.empty()
+                                     ? mapping.epoch + 1
+                                     : *mapping.snapshots.begin();
+    std::size_t kept = 0;
+    for (const std::pair<std::uint64_t, PageId>& page : mapping.retired) {
+      if (page.first < oldest) {
+        mapping.free_pages.push_back(page.second);
+      } else {
+        mapping.retired[kept++] = page;
+      }
+    }
+    mapping.retired.resize(kept);
+    mapping.fresh.assign(mapping.physical.size(), false);
+    ++mapping.epoch;
+  }
+  BlobFile::sync();
+}
+
+std::uint64_t MappedBlobFile::rootChecksum(const MappingRoot& root) {
+  // FNV-1a over the root, skipping the checksum itself
+  const char* bytes = reinterpret_cast<const char*>(&root);
+  const std::size_t skip = offsetof(MappingRoot, checksum);
+  std::uint64_t hash = 14695981039346656037ull;
+  for (std::size_t i = 0; i < sizeof(MappingRoot); ++i) {
+    if (i == skip) {
+      i += sizeof(root.checksum) - 1;
+      continue;
+    }
+    hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 1099511628211ull;
+  }
+  return hash;
+}
+
+void MappedBlobFile::forceToDisk() const {
+  stream_->flush();
+  const int fd = ::open(filename_.c_str(), O_WRONLY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+}
+
+SnapshotFile* MappedBlobFile::snapshot() {
+  if (!mapping_->shadow) {
+    throw FileOpenException(filename_);
+  }
+  sync();
+  return new SnapshotFile(*this);
+}
+
+SnapshotFile::SnapshotFile(const MappedBlobFile& source)
+    : File(source.filename() + "@" + std::to_string(source.mapping_->epoch),
+           source.stream_),
+      source_(new MappedBlobFile(source)),
+      physical_(source.mapping_->physical),
+      epoch_(source.mapping_->epoch) {
+  source_->mapping_->snapshots.insert(epoch_);
+}
+
+SnapshotFile::~SnapshotFile() {
+  MappedBlobFile::Mapping& mapping = *source_->mapping_;
+  mapping.snapshots.erase(mapping.snapshots.find(epoch_));
+}
+
+Page SnapshotFile::allocatePage(PageId &new_page_number) {
+  throw InvalidPageException(physical_.size() + 1, filename_);
+}
+
+Page SnapshotFile::readPage(const PageId page_number) const {
+  if (page_number == Page::INVALID_NUMBER || page_number > physical_.size()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return source_->BlobFile::readPage(physical_[page_number - 1]);
+}
+
+void SnapshotFile::writePage(const PageId page_number, const Page& new_page) {
+  throw InvalidPageException(page_number, filename_);
+}
+
+void SnapshotFile::deletePage(const PageId page_number) {
+  throw InvalidPageException(page_number, filename_);
+}
+
+PageId SnapshotFile::getFirstPageNo() {
+  return physical_.empty() ? Page::INVALID_NUMBER : 1;
+}
+
 }
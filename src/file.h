@@ -7,16 +7,20 @@
 
 #pragma once
 
+#include <cstdint>
 #include <fstream>
 #include <string>
 #include <map>
 #include <memory>
+#include <set>
+#include <vector>
 
 #include "page.h"
 
 namespace badgerdb {
 
 class FileIterator;
+class SnapshotFile;
 
 /**
  * @brief Header metadata for files on disk which contain pages.
@@ -42,6 +46,12 @@ struct FileHeader {
    */
   PageId first_free_page;
 
+  /**
+   * Page size the file was created with.  Adding this field moved every page
+   * 4 bytes further into the file, so files written before it cannot be read.
+   */
+  std::uint32_t page_size;
+
   /**
    * Returns true if this file header is equal to the other.
    *
@@ -52,7 +62,8 @@ struct FileHeader {
     return num_pages == rhs.num_pages &&
         num_free_pages == rhs.num_free_pages &&
         first_used_page == rhs.first_used_page &&
-        first_free_page == rhs.first_free_page;
+        first_free_page == rhs.first_free_page &&
+        page_size == rhs.page_size;
   }
 };
 
@@ -84,6 +95,8 @@ class File {
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  InvalidPageSizeException  If the existing file was created with
+   *                                    a different page size.
    */
   File(const std::string& name, const bool create_new);
 
@@ -143,6 +156,31 @@ class File {
    */
   virtual void writePage(const PageId page_number, const Page& new_page) = 0;
 
+  /**
+   * Writes a run of pages with consecutive page numbers into the file.
+   * Subclasses may override this to issue a single sequential write for the
+   * whole run; by default each page is written with writePage().
+   * No bounds checking is performed.
+   *
+   * @param first_page_number Number of page to write the first page to.
+   * @param pages             Pages to write, in page number order.
+   */
+  virtual void writePages(const PageId first_page_number,
+                          const std::vector<const Page*>& pages);
+
+  /**
+   * Reads a run of existing pages with consecutive page numbers from the
+   * file.  Subclasses may override this to issue a single sequential read for
+   * the whole run; by default each page is read with readPage().
+   *
+   * @param first_page_number Number of the first page to read.
+   * @param pages             Destinations of the pages, in page number order.
+   * @throws  InvalidPageException  If any page of the run doesn't exist in the
+   *                                file or is not currently used.
+   */
+  virtual void readPages(const PageId first_page_number,
+                         const std::vector<Page*>& pages) const;
+
   /**
    * Deletes a page from the file.
    *
@@ -162,9 +200,26 @@ class File {
    *
    * @return  Iterator at first page of file.
    */
-	PageId getFirstPageNo();
+	virtual PageId getFirstPageNo();
+
+  /**
+   * Writes file metadata the file keeps in memory to disk.  Called by
+   * BufMgr::flushFile() once the pages of the file have been written.  Files
+   * that keep all metadata on disk do nothing.
+   */
+  virtual void sync() const {}
 
  protected:
+  /**
+   * Constructs a file object on a stream that is already open, under a name
+   * of its own.  Used for views of a file, such as SnapshotFile; the name is
+   * not registered as an open file.
+   *
+   * @param name    Name of the view.
+   * @param stream  Stream of the underlying file.
+   */
+  File(const std::string& name, const std::shared_ptr<std::fstream>& stream);
+
   /**
    * Returns the position of the page with the given number in the file (as an
    * offset from the beginning of the file).
@@ -208,7 +263,7 @@ class File {
    *
    * @param header  File header to write.
    */
-  void writeHeader(const FileHeader& header);
+  void writeHeader(const FileHeader& header) const;
 
   typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
   typedef std::map<std::string, int> CountMap;
@@ -234,6 +289,7 @@ class File {
   std::shared_ptr<std::fstream> stream_;
 
   friend class FileIterator;
+  friend class FileAppender;
 };
 
 class PageFile : public File {
@@ -319,6 +375,28 @@ class PageFile : public File {
    */
   void writePage(const PageId page_number, const Page& new_page) override;
 
+  /**
+   * Writes a run of pages with consecutive page numbers into the file using
+   * a single sequential write.  No bounds checking is performed.
+   *
+   * @param first_page_number Number of page to write the first page to.
+   * @param pages             Pages to write, in page number order.
+   */
+  void writePages(const PageId first_page_number,
+                  const std::vector<const Page*>& pages) override;
+
+  /**
+   * Reads a run of existing pages with consecutive page numbers from the
+   * file using a single sequential read.
+   *
+   * @param first_page_number Number of the first page to read.
+   * @param pages             Destinations of the pages, in page number order.
+   * @throws  InvalidPageException  If any page of the run doesn't exist in the
+   *                                file or is not currently used.
+   */
+  void readPages(const PageId first_page_number,
+                 const std::vector<Page*>& pages) const override;
+
   /**
    * Deletes a page from the file.
    *
@@ -380,10 +458,24 @@ class PageFile : public File {
   PageHeader readPageHeader(const PageId page_number) const;
 
   friend class FileIterator;
+  friend class FileAppender;
 };
 
+/**
+ * @brief File of raw pages, without per-page headers.
+ *
+ * Allocating a page only reserves its page number in memory; the page costs
+ * no I/O until it is written.  The file is extended EXTENSION_PAGES pages at
+ * a time with fallocate, and the header is written by sync() and when the
+ * last File object on the file is destroyed.  Pages allocated but never
+ * written read back as zeros.
+ */
 class BlobFile : public File {
  public:
+  /**
+   * Number of pages the file grows by when an allocation reaches its end.
+   */
+  static const PageId EXTENSION_PAGES = 64;
 
   /**
    * Creates a new BlobFile.
@@ -467,12 +559,736 @@ class BlobFile : public File {
    */
   void writePage(const PageId page_number, const Page& new_page) override;
 
+  /**
+   * Writes a run of pages with consecutive page numbers into the file using
+   * a single sequential write.  No bounds checking is performed.
+   *
+   * @param first_page_number Number of page to write the first page to.
+   * @param pages             Pages to write, in page number order.
+   */
+  void writePages(const PageId first_page_number,
+                  const std::vector<const Page*>& pages) override;
+
+  /**
+   * Reads a run of existing pages with consecutive page numbers from the
+   * file using a single sequential read.
+   *
+   * @param first_page_number Number of the first page to read.
+   * @param pages             Destinations of the pages, in page number order.
+   * @throws  InvalidPageException  If any page of the run doesn't exist in the
+   *                                file or is not currently used.
+   */
+  void readPages(const PageId first_page_number,
+                 const std::vector<Page*>& pages) const override;
+
   /**
    * Deletes a page from the file.
    *
    * @param page_number   Number of page to delete.
    */
   void deletePage(const PageId page_number) override;
+
+  /**
+   * Returns the first page of the file, counting pages not written yet.
+   */
+  PageId getFirstPageNo() override;
+
+  /**
+   * Writes the header, recording all pages allocated so far.
+   */
+  void sync() const override;
+
+ protected:
+  /**
+   * Returns the number of pages allocated in the file, counting the header
+   * as page 0.
+   */
+  PageId allocatedPages() const { return extent_->header.num_pages; }
+
+  /**
+   * Reserves the next page number, extending the file if needed.
+   *
+   * @return  Number of the reserved page.
+   */
+  PageId reservePage() const;
+
+  /**
+   * Writes a page at the given page number.  Shared by writePage() and
+   * subclasses that write pages from const methods.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   */
+  void writeBlock(const PageId page_number, const Page& new_page) const;
+
+ private:
+  /**
+   * Allocation state shared by all objects on a file.
+   */
+  struct Extent {
+    /** Header including pages reserved in memory. */
+    FileHeader header;
+    /** Pages the file has room for on disk, counting the header as page 0. */
+    PageId backed_pages;
+    /** Whether the header on disk is behind. */
+    bool dirty;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<Extent> > ExtentMap;
+
+  /**
+   * Attaches this object to the allocation state of its file, loading it from
+   * the file if no other object has the file open.
+   */
+  void openExtent();
+
+  /**
+   * Detaches this object from the allocation state, writing the header if
+   * this is the last object on the file.
+   */
+  void closeExtent();
+
+  /**
+   * Makes room on disk for pages up to the given page number.
+   */
+  void extend(const PageId page_number) const;
+
+  /**
+   * Allocation state of all open blob files.
+   */
+  static ExtentMap extents_;
+
+  /**
+   * Allocation state of this file.
+   */
+  std::shared_ptr<Extent> extent_;
+};
+
+/**
+ * @brief Header of a CompressedBlobFile.
+ *
+ * Starts with a FileHeader so File::getFirstPageNo() works on compressed
+ * files as well.
+ */
+struct CompressedFileHeader {
+  /**
+   * Page count and first used page, as in every other file.
+   */
+  FileHeader file_header;
+
+  /**
+   * Identifies the file as a CompressedBlobFile.
+   */
+  std::uint64_t magic;
+
+  /**
+   * Position of the page directory written by the last sync.
+   */
+  std::uint64_t directory_offset;
+
+  /**
+   * Number of pages in that directory.
+   */
+  std::uint64_t directory_pages;
+
+  /**
+   * Space reserved for that directory.
+   */
+  std::uint64_t directory_capacity;
+
+  /**
+   * Position of the space the next sync writes the directory to, so the one
+   * of the last sync stays intact until the header points to the new one.
+   */
+  std::uint64_t spare_offset;
+
+  /**
+   * Size of that space, 0 if there is none yet.
+   */
+  std::uint64_t spare_capacity;
+};
+
+/**
+ * @brief Location of a page in a CompressedBlobFile.
+ */
+struct CompressedPageSlot {
+  /**
+   * Position of the page in the file.
+   */
+  std::uint64_t offset;
+
+  /**
+   * Stored size of the page: Page::SIZE for a page kept uncompressed, 0 for
+   * a page never written.
+   */
+  std::uint32_t size;
+
+  /**
+   * Space reserved at the position, so the page can grow in place.
+   */
+  std::uint32_t capacity;
+};
+
+/**
+ * @brief Blob file that stores every page compressed.
+ *
+ * Pages are compressed with lz_codec on write and decompressed on read, so
+ * the buffer manager and everything above it see ordinary pages.  Compressed
+ * pages live in variable-size slots; a directory in memory maps page numbers
+ * to slots.  A page rewritten in a smaller or equal size stays in its slot,
+ * a page that outgrows its slot moves to the smallest free slot that fits it
+ * or to the end of the file, and its old slot becomes free.  Pages that do
+ * not compress are stored as they are.
+ *
+ * The directory is written by sync() and when the last File object on the
+ * file is destroyed.  Two spaces in the file take turns holding it: sync()
+ * writes the one the header does not point to and then switches the header
+ * over, so syncing does not grow the file.  Slots left behind by pages that
+ * moved are only reused after the next sync, as the directory on disk may
+ * still point to them; the pages it points to are thus kept where it finds
+ * them, unless they are rewritten in place.  Free slots are found again from
+ * the directory when the file is opened.  Like other files, all
+ * CompressedBlobFile objects on the same file share one directory.
+ *
+ * Meant for cold files, where storage and read bandwidth matter more than
+ * the CPU spent compressing.
+ */
+class CompressedBlobFile : public File {
+ public:
+  /**
+   * Value of CompressedFileHeader::magic.
+   */
+  static const std::uint64_t MAGIC = 0x32707a6272646762ull;  // "bgdrbzp2"
+
+  /**
+   * Returns true if the named file exists and is a CompressedBlobFile.
+   *
+   * @param filename  Name of the file.
+   */
+  static bool isCompressed(const std::string& filename);
+
+  /**
+   * Constructs a file object representing a compressed file on the
+   * filesystem.
+   *
+   * @param name        Name of file.
+   * @param create_new  Whether to create a new file.
+   * @throws  FileExistsException     If the underlying file exists and
+   *                                  create_new is true.
+   * @throws  FileNotFoundException   If the underlying file doesn't exist and
+   *                                  create_new is false.
+   * @throws  FileOpenException       If the existing file is not a
+   *                                  CompressedBlobFile.
+   */
+  CompressedBlobFile(const std::string& name, const bool create_new);
+
+  /**
+   * Copy constructor.
+   *
+   * @param other File object to copy.
+   */
+  CompressedBlobFile(const CompressedBlobFile& other);
+
+  /**
+   * Assignment operator.
+   *
+   * @param rhs File object to assign.
+   * @return    Newly assigned file object.
+   */
+  CompressedBlobFile& operator=(const CompressedBlobFile& rhs);
+
+  /**
+   * Destructor.  Writes the directory if no other File objects are using the
+   * file.
+   */
+  ~CompressedBlobFile();
+
+  /**
+   * Allocates a new, empty page in the file.
+   *
+   * @return The new page.
+   */
+  Page allocatePage(PageId &new_page_number) override;
+
+  /**
+   * Reads and decompresses an existing page from the file.
+   *
+   * @param page_number   Number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or
+   *                                cannot be decompressed.
+   */
+  Page readPage(const PageId page_number) const override;
+
+  /**
+   * Compresses a page and writes it into the file at the given page number.
+   *
+   * @param page_number Number of page whose contents to replace.
+   * @param new_page    Page to write.
+   */
+  void writePage(const PageId page_number, const Page& new_page) override;
+
+  /**
+   * Deletes a page from the file.  Not supported, as for BlobFile.
+   *
+   * @param page_number   Number of page to delete.
+   * @throws  InvalidPageException  Always.
+   */
+  void deletePage(const PageId page_number) override;
+
+  /**
+   * Writes the directory and the header, making all pages written so far
+   * readable after the file is reopened.
+   */
+  void sync() const override;
+
+  /**
+   * Returns the number of bytes the written pages occupy in the file.
+   */
+  std::uint64_t storedBytes() const;
+
+ private:
+  /**
+   * Granularity of slot capacities.  Leaves room for pages to grow a little
+   * before they have to move.
+   */
+  static const std::uint32_t SLOT_GRANULE = 256;
+
+  /**
+   * Page directory shared by all objects on a file.
+   */
+  struct Directory {
+    std::vector<CompressedPageSlot> slots;
+    std::uint64_t end;
+    std::uint64_t directory_offset;
+    std::uint64_t directory_pages;
+    std::uint64_t directory_capacity;
+    std::uint64_t spare_offset;
+    std::uint64_t spare_capacity;
+    bool dirty;
+    /** Slots left behind by pages that moved, by capacity. */
+    std::multimap<std::uint32_t, std::uint64_t> free_slots;
+    /** Slots left behind since the last sync, free once the next one is done. */
+    std::vector<std::pair<std::uint32_t, std::uint64_t> > freed_slots;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<Directory> > DirectoryMap;
+
+  /**
+   * Attaches this object to the directory of its file, loading it from the
+   * file or creating it.
+   */
+  void openDirectory(const bool create_new);
+
+  /**
+   * Detaches this object from the directory, writing it out if this is the
+   * last object on the file.
+   */
+  void closeDirectory();
+
+  /**
+   * Writes the header with the directory position of the last sync.
+   */
+  void writeCompressedHeader() const;
+
+  /**
+   * Finds the space in the file the directory read by openDirectory() does
+   * not account for, and makes it free slots.
+   */
+  void findFreeSlots() const;
+
+  /**
+   * Makes a range of the file free slots, of at most a page each.
+   *
+   * @param offset    Start of the range.
+   * @param length    Length of the range.
+   */
+  void freeRange(std::uint64_t offset, std::uint64_t length) const;
+
+  /**
+   * Directories of all open compressed files.
+   */
+  static DirectoryMap directories_;
+
+  /**
+   * Directory of this file.
+   */
+  std::shared_ptr<Directory> directory_;
+};
+
+/**
+ * @brief Blob file addressed through a logical to physical page mapping.
+ *
+ * Callers see logical page numbers; a mapping table translates them to the
+ * physical pages of the underlying BlobFile.  Pages can therefore be moved,
+ * for example to lay out a tree sequentially, without rewriting any page
+ * that refers to them.
+ *
+ * The root of the mapping holds the number of logical pages and the physical
+ * numbers of the map pages, which store the table.  The table is kept in
+ * memory, shared by all objects on the file, and written to fresh map pages
+ * by sync() and when the last object on the file is destroyed.  Physical
+ * pages freed by moves are reused by later allocations.
+ *
+ * Physical pages 1 and 2 take turns holding the root; each root carries the
+ * number of the sync that wrote it and a checksum.  sync() forces the pages
+ * and the map pages to disk, then writes the root to the page not holding
+ * the last one and forces it to disk as well.  The file opens with the valid
+ * root of the highest number, so a sync interrupted at any point, even in the
+ * middle of writing the root, leaves the root of the previous one in effect.
+ *
+ * In shadow mode, sync() commits: the first write to a page after a commit
+ * goes to a new physical page, so the pages of the last commit are never
+ * overwritten and writing the root switches from one commit to the next.
+ * After a crash the file opens as of the last commit.
+ * snapshot() gives read access to the last commit while writing continues;
+ * physical pages replaced since are reclaimed once no snapshot can read them.
+ */
+class MappedBlobFile : public BlobFile {
+ public:
+  /**
+   * Identifies the root page of the mapping.
+   */
+  static const std::uint64_t MAGIC = 0x3270616d72646762ull;  // "bgdrmap2"
+
+  /**
+   * Returns true if the named file exists and is a MappedBlobFile.
+   *
+   * @param filename  Name of the file.
+   */
+  static bool isMapped(const std::string& filename);
+
+  /**
+   * Constructs a file object representing a mapped file on the filesystem.
+   *
+   * @param name        Name of file.
+   * @param create_new  Whether to create a new file.
+   * @param shadow      Whether a new file is in shadow mode.  An existing
+   *                    file keeps the mode it was created with.
+   * @throws  FileExistsException     If the underlying file exists and
+   *                                  create_new is true.
+   * @throws  FileNotFoundException   If the underlying file doesn't exist and
+   *                                  create_new is false.
+   * @throws  FileOpenException       If the existing file is not a
+   *                                  MappedBlobFile.
+   */
+  MappedBlobFile(const std::string& name, const bool create_new,
+                 const bool shadow = false);
+
+  /**
+   * Copy constructor.
+   *
+   * @param other File object to copy.
+   */
+  MappedBlobFile(const MappedBlobFile& other);
+
+  /**
+   * Assignment operator.
+   *
+   * @param rhs File object to assign.
+   * @return    Newly assigned file object.
+   */
+  MappedBlobFile& operator=(const MappedBlobFile& rhs);
+
+  /**
+   * Destructor.  Writes the mapping if no other File objects are using the
+   * file.
+   */
+  ~MappedBlobFile();
+
+  /**
+   * Allocates a new logical page, backed by a free physical page or a new
+   * one at the end of the file.
+   *
+   * @return The new page.
+   * @throws  InvalidPageException  If the mapping is full.
+   */
+  Page allocatePage(PageId &new_page_number) override;
+
+  /**
+   * Reads an existing page from the file.
+   *
+   * @param page_number   Logical number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  Page readPage(const PageId page_number) const override;
+
+  /**
+   * Writes a page into the file at the given logical page number.
+   *
+   * @param page_number Logical number of page whose contents to replace.
+   * @param new_page    Page to write.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  void writePage(const PageId page_number, const Page& new_page) override;
+
+  /**
+   * Writes a run of pages with consecutive logical page numbers, with one
+   * write per run of consecutive physical pages.
+   *
+   * @param first_page_number Logical number of the first page to write.
+   * @param pages             Pages to write, in page number order.
+   */
+  void writePages(const PageId first_page_number,
+                  const std::vector<const Page*>& pages) override;
+
+  /**
+   * Reads a run of pages with consecutive logical page numbers, with one
+   * read per run of consecutive physical pages.
+   *
+   * @param first_page_number Logical number of the first page to read.
+   * @param pages             Destinations of the pages, in page number order.
+   * @throws  InvalidPageException  If any page of the run doesn't exist.
+   */
+  void readPages(const PageId first_page_number,
+                 const std::vector<Page*>& pages) const override;
+
+  /**
+   * Returns the first logical page of the file.
+   */
+  PageId getFirstPageNo() override;
+
+  /**
+   * Writes the mapping and the header.  In shadow mode this commits all pages
+   * written so far.
+   */
+  void sync() const override;
+
+  /**
+   * Returns true if the file is in shadow mode.
+   */
+  bool shadowing() const { return mapping_->shadow; }
+
+  /**
+   * Commits the file and opens a read-only view of the commit.  Pages written
+   * later are not visible through the view.  Delete the view to release it.
+   *
+   * @return  The view, owned by the caller.
+   * @throws  FileOpenException  If the file is not in shadow mode.
+   */
+  SnapshotFile* snapshot();
+
+  /**
+   * Returns the physical page a logical page is stored in.
+   *
+   * @param page_number   Logical page number.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  PageId physicalPageNo(const PageId page_number) const;
+
+  /**
+   * Moves a page to a new physical page at the end of the file.
+   *
+   * @param page_number   Logical page number.
+   * @throws  InvalidPageException  If the page doesn't exist in the file.
+   */
+  void relocate(const PageId page_number);
+
+  /**
+   * Moves pages to consecutive physical pages at the end of the file, in the
+   * given order, so they can be read sequentially.
+   *
+   * @param page_numbers  Logical page numbers in the desired order.
+   * @throws  InvalidPageException  If a page doesn't exist in the file.
+   */
+  void reorganize(const std::vector<PageId>& page_numbers);
+
+ private:
+  /**
+   * Logical pages one map page holds.
+   */
+  static const std::size_t ENTRIES_PER_MAP_PAGE = Page::SIZE / sizeof(PageId);
+
+  /**
+   * Map pages the root page can list.
+   */
+  static const std::size_t MAX_MAP_PAGES =
+      (Page::SIZE - 5 * sizeof(std::uint64_t)) / sizeof(PageId);
+
+  /**
+   * Layout of the root page of the mapping.
+   */
+  struct MappingRoot {
+    std::uint64_t magic;
+    std::uint32_t num_logical_pages;
+    std::uint32_t num_map_pages;
+    std::uint32_t shadow;
+    std::uint32_t reserved;
+    /** Number of the sync that wrote the root. */
+    std::uint64_t epoch;
+    /** Checksum of the root, without this field. */
+    std::uint64_t checksum;
+    PageId map_pages[MAX_MAP_PAGES];
+  };
+
+  static_assert(sizeof(MappingRoot) <= Page::SIZE,
+                "Root of the page mapping must fit into a page.");
+
+  /**
+   * Mapping shared by all objects on a file.
+   */
+  struct Mapping {
+    /** Physical page of every logical page; entry i is logical page i + 1. */
+    std::vector<PageId> physical;
+    /** Physical pages holding the table as of the last sync. */
+    std::vector<PageId> map_pages;
+    /** Physical pages not in use. */
+    std::vector<PageId> free_pages;
+    bool dirty;
+    /** Whether the file is in shadow mode. */
+    bool shadow;
+    /** In shadow mode, logical pages written since the last commit. */
+    std::vector<bool> fresh;
+    /** Number of the last sync, recorded in its root. */
+    std::uint64_t epoch;
+    /** Physical pages replaced in shadow mode, with the commit they left. */
+    std::vector<std::pair<std::uint64_t, PageId> > retired;
+    /** Commits the open snapshots show. */
+    std::multiset<std::uint64_t> snapshots;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<Mapping> > MappingMap;
+
+  /**
+   * Attaches this object to the mapping of its file, loading it from the
+   * file or creating it.
+   *
+   * @param create_new  Whether the file is new.
+   * @param shadow      Whether a new file is in shadow mode.
+   */
+  void openMapping(const bool create_new, const bool shadow);
+
+  /**
+   * Detaches this object from the mapping, writing it out if this is the
+   * last object on the file.
+   */
+  void closeMapping();
+
+  /**
+   * Returns a free physical page, or a new one at the end of the file.
+   */
+  PageId allocatePhysical() const;
+
+  /**
+   * Gives up the physical page a logical page was moved away from.  In shadow
+   * mode a page of the last commit is kept until no snapshot can read it.
+   */
+  void releasePhysical(const PageId page_number, const PageId old_page);
+
+  /**
+   * Moves a logical page to a new physical page before it is written, if the
+   * file is in shadow mode and the page has not been written since the last
+   * commit.
+   */
+  void shadowPage(const PageId page_number);
+
+  /**
+   * Returns the checksum of a root of the mapping.
+   *
+   * @param root  The root.
+   */
+  static std::uint64_t rootChecksum(const MappingRoot& root);
+
+  /**
+   * Forces everything written to the file so far to disk.
+   */
+  void forceToDisk() const;
+
+  /**
+   * Mappings of all open mapped files.
+   */
+  static MappingMap mappings_;
+
+  /**
+   * Mapping of this file.
+   */
+  std::shared_ptr<Mapping> mapping_;
+
+  friend class SnapshotFile;
+};
+
+/**
+ * @brief Read-only view of a commit of a MappedBlobFile in shadow mode.
+ *
+ * Created by MappedBlobFile::snapshot().  The view reads the pages of the file
+ * as of the commit it was created at, through a copy of the mapping of that
+ * commit, while the file itself is written on.  Its name is the name of the
+ * file followed by "@" and the commit number, so the buffer pool and page
+ * tiers keep its pages apart from those of the file.
+ */
+class SnapshotFile : public File {
+ public:
+  /**
+   * Destructor.  Releases the commit, so its pages can be reclaimed.
+   */
+  ~SnapshotFile();
+
+  /**
+   * Not supported: the view is read-only.
+   *
+   * @throws  InvalidPageException  Always.
+   */
+  Page allocatePage(PageId &new_page_number) override;
+
+  /**
+   * Reads a page as of the commit.
+   *
+   * @param page_number   Logical number of page to read.
+   * @return  The page.
+   * @throws  InvalidPageException  If the page did not exist at the commit.
+   */
+  Page readPage(const PageId page_number) const override;
+
+  /**
+   * Not supported: the view is read-only.
+   *
+   * @throws  InvalidPageException  Always.
+   */
+  void writePage(const PageId page_number, const Page& new_page) override;
+
+  /**
+   * Not supported: the view is read-only.
+   *
+   * @throws  InvalidPageException  Always.
+   */
+  void deletePage(const PageId page_number) override;
+
+  /**
+   * Returns the first logical page as of the commit.
+   */
+  PageId getFirstPageNo() override;
+
+  /**
+   * Returns the number of the commit the view shows.
+   */
+  std::uint64_t epoch() const { return epoch_; }
+
+ private:
+  /**
+   * Constructs a view of the last commit of a file.
+   *
+   * @param source  The file, committed.
+   */
+  explicit SnapshotFile(const MappedBlobFile& source);
+
+  /**
+   * Keeps the file open, and its pages and mapping in place, while the view
+   * exists.
+   */
+  std::unique_ptr<MappedBlobFile> source_;
+
+  /**
+   * Physical page of every logical page as of the commit.
+   */
+  std::vector<PageId> physical_;
+
+  /**
+   * Number of the commit.
+   */
+  std::uint64_t epoch_;
+
+  friend class MappedBlobFile;
 };
 
 }
@@ -0,0 +1,109 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_appender.h"
+
+#include <cassert>
+
+namespace badgerdb {
+
+static_assert(sizeof(Page) == Page::SIZE,
+              "Pages must be laid out contiguously for batched writes.");
+
+FileAppender::FileAppender(PageFile* file, const std::uint32_t batch_pages)
+    : file_(file),
+      batch_pages_(batch_pages > 0 ? batch_pages : 1),
+      tail_page_number_(Page::INVALID_NUMBER),
+      pages_written_(0) {
+  header_ = file_->readHeader();
+  next_page_number_ = header_.num_pages;
+  batch_.reserve(batch_pages_);
+
+  if (header_.first_used_page == Page::INVALID_NUMBER) {
+    return;
+  }
+  if (header_.num_free_pages == 0) {
+    // The used list is kept in page order, so with no free pages its tail is
+    // the last page of the file.
+    tail_page_number_ = header_.num_pages - 1;
+  } else {
+    // Walk the used list once to find its tail.
+    PageId page_number = header_.first_used_page;
+    while (page_number != Page::INVALID_NUMBER) {
+      tail_page_number_ = page_number;
+      page_number = file_->readPageHeader(page_number).next_page_number;
+    }
+  }
+}
+
+FileAppender::~FileAppender() {
+  try {
+    finish();
+  } catch (...) {
+    // Destructors must not throw.
+  }
+}
+
+RecordId FileAppender::appendRecord(const std::string& record_data) {
+  if (batch_.empty()) {
+    startPage();
+  } else if (!batch_.back().hasSpaceForRecord(record_data)) {
+    if (batch_.size() == batch_pages_) {
+      writeBatch();
+    }
+    startPage();
+  }
+  return batch_.back().insertRecord(record_data);
+}
+
+void FileAppender::finish() {
+  writeBatch();
+}
+
+void FileAppender::startPage() {
+  batch_.push_back(Page());
+  batch_.back().set_page_number(next_page_number_++);
+}
+
+void FileAppender::writeBatch() {
+  if (batch_.empty()) {
+    return;
+  }
+
+  // Chain the pages of the batch together in memory.
+  for (std::size_t i = 0; i + 1 < batch_.size(); ++i) {
+    batch_[i].set_next_page_number(batch_[i + 1].page_number());
+  }
+  batch_.back().set_next_page_number(Page::INVALID_NUMBER);
+
+  const PageId first_page_number = batch_.front().page_number();
+  if (tail_page_number_ == Page::INVALID_NUMBER) {
+    header_.first_used_page = first_page_number;
+  } else {
+    // Only the header of the old tail page has to change.
+    PageHeader tail_header = file_->readPageHeader(tail_page_number_);
+    tail_header.next_page_number = first_page_number;
+    file_->stream_->seekp(File::pagePosition(tail_page_number_), std::ios::beg);
+    file_->stream_->write(reinterpret_cast<const char*>(&tail_header),
+                          sizeof(PageHeader));
+  }
+
+  file_->stream_->seekp(File::pagePosition(first_page_number), std::ios::beg);
+  file_->stream_->write(reinterpret_cast<const char*>(&batch_[0]),
+                        batch_.size() * Page::SIZE);
+
+  tail_page_number_ = batch_.back().page_number();
+  header_.num_pages = tail_page_number_ + 1;
+  pages_written_ += batch_.size();
+  assert(header_.num_pages == next_page_number_);
+
+  // Writing the header also flushes the stream.
+  file_->writeHeader(header_);
+  batch_.clear();
+}
+
+}
@@ -0,0 +1,128 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Streaming writer that bulk loads records at the end of a PageFile.
+ *
+ * Records are packed into pages held in memory.  Page numbers are reserved in
+ * contiguous batches past the current end of the file, so a whole batch is
+ * linked into the used page list with a single header update and written out
+ * with one sequential write.  The file header is written once per batch rather
+ * than once per page as PageFile::allocatePage does.
+ *
+ * Free pages of the file are never reused by the appender; loaded pages always
+ * go to the tail of the file.  No other page allocations may be made on the
+ * file while an appender is active.
+ *
+ * @warning This class is not threadsafe.
+ */
+class FileAppender {
+ public:
+  /**
+   * Default number of pages buffered in memory before they are written out.
+   */
+  static const std::uint32_t DEFAULT_BATCH_PAGES = 64;
+
+  /**
+   * Constructs an appender positioned at the end of the given file.
+   *
+   * @param file        File to append records to.
+   * @param batch_pages Number of full pages buffered before a batch is written.
+   */
+  FileAppender(PageFile* file,
+               const std::uint32_t batch_pages = DEFAULT_BATCH_PAGES);
+
+  /**
+   * Destructor.  Writes out any buffered pages; errors are swallowed, so
+   * callers that care about them should call finish() explicitly.
+   */
+  ~FileAppender();
+
+  /**
+   * Appends a record to the file, starting a new page if the current one is
+   * full.
+   *
+   * @param record_data  Bytes that compose the record.
+   * @return  ID the record will have once it is written to the file.
+   * @throws  InsufficientSpaceException  If the record does not fit on an
+   *                                      empty page.
+   */
+  RecordId appendRecord(const std::string& record_data);
+
+  /**
+   * Writes out all buffered pages, including the partially filled last page.
+   * The appender may keep being used afterwards.
+   */
+  void finish();
+
+  /**
+   * Returns the number of pages this appender has written to the file.
+   */
+  std::uint32_t pagesWritten() const { return pages_written_; }
+
+ private:
+  /**
+   * Reserves the next page number and starts an empty page for it in the
+   * current batch.
+   */
+  void startPage();
+
+  /**
+   * Links all pages of the current batch into the used page list of the file
+   * and writes them out with a single sequential write.
+   */
+  void writeBatch();
+
+  /**
+   * File being loaded.
+   */
+  PageFile* file_;
+
+  /**
+   * Number of pages buffered before a batch is written.
+   */
+  std::uint32_t batch_pages_;
+
+  /**
+   * Pages of the current batch.  Page numbers are consecutive.
+   */
+  std::vector<Page> batch_;
+
+  /**
+   * Copy of the file header, updated as batches are written.
+   */
+  FileHeader header_;
+
+  /**
+   * Number of the last page in the used page list that is already on disk.
+   */
+  PageId tail_page_number_;
+
+  /**
+   * Number of the next page to be reserved.
+   */
+  PageId next_page_number_;
+
+  /**
+   * Number of pages written so far.
+   */
+  std::uint32_t pages_written_;
+};
+
+}
@@ -0,0 +1,151 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_cache_tier.h"
+
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+FileCacheTier::FileCacheTier(const std::string& cache_name,
+                             const std::uint32_t capacity_pages,
+                             const AdmissionPolicy policy)
+    : cache_name_(cache_name),
+      capacity_(capacity_pages),
+      policy_(policy),
+      slots_(capacity_pages),
+      clock_hand_(0),
+      hits_(0),
+      misses_(0),
+      admitted_(0) {
+  try {
+    File::remove(cache_name_);
+  } catch (FileNotFoundException&) {
+  }
+  cache_file_.reset(new BlobFile(cache_name_, true /* create_new */));
+
+  free_slots_.reserve(capacity_);
+  for (std::uint32_t i = capacity_; i > 0; --i) {
+    slots_[i - 1].used = false;
+    slots_[i - 1].referenced = false;
+    free_slots_.push_back(i - 1);
+  }
+}
+
+FileCacheTier::~FileCacheTier() {
+  cache_file_.reset();
+  try {
+    File::remove(cache_name_);
+  } catch (...) {
+    // Destructors must not throw.
+  }
+}
+
+bool FileCacheTier::fetch(const File& file, const PageId page_number,
+                          Page& page) {
+  const auto pages = index_.find(file.filename());
+  if (pages != index_.end()) {
+    const auto entry = pages->second.find(page_number);
+    if (entry != pages->second.end()) {
+      page = cache_file_->readPage(entry->second + 1);
+      slots_[entry->second].referenced = true;
+      ++hits_;
+      return true;
+    }
+  }
+  ++misses_;
+  return false;
+}
+
+void FileCacheTier::admit(const File& file, const PageId page_number,
+                          const Page& page) {
+  if (capacity_ == 0) {
+    return;
+  }
+
+  std::unordered_map<PageId, std::uint32_t>& pages = index_[file.filename()];
+  const auto entry = pages.find(page_number);
+  if (entry != pages.end()) {
+    // Refresh the copy already held.
+    cache_file_->writePage(entry->second + 1, page);
+    return;
+  }
+
+  if (policy_ == ADMIT_ON_SECOND_EVICTION) {
+    std::unordered_set<PageId>& ghosts = ghosts_[file.filename()];
+    if (ghosts.erase(page_number) == 0) {
+      ghosts.insert(page_number);
+      ghost_order_.push_back(std::make_pair(file.filename(), page_number));
+      if (ghost_order_.size() > capacity_) {
+        ghosts_[ghost_order_.front().first].erase(ghost_order_.front().second);
+        ghost_order_.pop_front();
+      }
+      return;
+    }
+  }
+
+  const std::uint32_t slot = allocateSlot();
+  cache_file_->writePage(slot + 1, page);
+  slots_[slot].filename = file.filename();
+  slots_[slot].page_number = page_number;
+  slots_[slot].used = true;
+  slots_[slot].referenced = false;
+  index_[file.filename()][page_number] = slot;
+  ++admitted_;
+}
+
+void FileCacheTier::invalidate(const File& file, const PageId page_number) {
+  const auto pages = index_.find(file.filename());
+  if (pages == index_.end()) {
+    return;
+  }
+  const auto entry = pages->second.find(page_number);
+  if (entry != pages->second.end()) {
+    freeSlot(entry->second);
+  }
+}
+
+void FileCacheTier::invalidateFile(const File& file) {
+  const auto pages = index_.find(file.filename());
+  if (pages != index_.end()) {
+    for (const auto& entry : pages->second) {
+      slots_[entry.second].used = false;
+      free_slots_.push_back(entry.second);
+    }
+    index_.erase(pages);
+  }
+  ghosts_.erase(file.filename());
+}
+
+std::uint32_t FileCacheTier::allocateSlot() {
+  if (!free_slots_.empty()) {
+    const std::uint32_t slot = free_slots_.back();
+    free_slots_.pop_back();
+    return slot;
+  }
+
+  // Every slot is used; a full turn of the clock clears all referenced bits,
+  // so the second turn always finds a victim.
+  while (slots_[clock_hand_].referenced) {
+    slots_[clock_hand_].referenced = false;
+    clock_hand_ = (clock_hand_ + 1) % capacity_;
+  }
+  const std::uint32_t slot = clock_hand_;
+  clock_hand_ = (clock_hand_ + 1) % capacity_;
+
+  freeSlot(slot);
+  free_slots_.pop_back();
+  return slot;
+}
+
+void FileCacheTier::freeSlot(const std::uint32_t slot) {
+  index_[slots_[slot].filename].erase(slots_[slot].page_number);
+  slots_[slot].used = false;
+  free_slots_.push_back(slot);
+}
+
+}
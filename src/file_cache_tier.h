@@ -0,0 +1,175 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "file.h"
+#include "page.h"
+#include "page_tier.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Page tier backed by a cache file on fast local storage.
+ *
+ * The cache file is a BlobFile divided into a fixed number of page slots.  An
+ * in-memory index maps (file name, page number) to slots, and slots are
+ * recycled with the same clock algorithm the buffer pool uses.  The cache
+ * file only lives as long as the tier: it is recreated empty on construction
+ * and removed on destruction.
+ *
+ * By default a page is only admitted the second time it leaves the buffer
+ * pool, so a single large scan does not wash the working set out of the
+ * cache.  Pages evicted once are remembered in a ghost list as long as the
+ * tier has slots.
+ *
+ * @warning This class is not threadsafe.
+ */
+class FileCacheTier : public PageTier {
+ public:
+  /**
+   * Which pages offered by the buffer pool are kept.
+   */
+  enum AdmissionPolicy {
+    /** Keep every page offered. */
+    ADMIT_ALL,
+    /** Keep a page the second time it is offered. */
+    ADMIT_ON_SECOND_EVICTION
+  };
+
+  /**
+   * Creates the tier and an empty cache file.  An existing file of the same
+   * name is replaced.
+   *
+   * @param cache_name      Name of the cache file, on the fast device.
+   * @param capacity_pages  Number of pages the cache file holds.
+   * @param policy          Admission policy.
+   */
+  FileCacheTier(const std::string& cache_name,
+                const std::uint32_t capacity_pages,
+                const AdmissionPolicy policy = ADMIT_ON_SECOND_EVICTION);
+
+  /**
+   * Destructor.  Closes and removes the cache file.
+   */
+  ~FileCacheTier();
+
+  bool fetch(const File& file, const PageId page_number, Page& page) override;
+  void admit(const File& file, const PageId page_number,
+             const Page& page) override;
+  void invalidate(const File& file, const PageId page_number) override;
+  void invalidateFile(const File& file) override;
+
+  /**
+   * Returns the number of pages found by fetch().
+   */
+  std::uint64_t hits() const { return hits_; }
+
+  /**
+   * Returns the number of pages not found by fetch().
+   */
+  std::uint64_t misses() const { return misses_; }
+
+  /**
+   * Returns the number of pages written to the cache file.
+   */
+  std::uint64_t admitted() const { return admitted_; }
+
+  /**
+   * Returns the number of pages currently held.
+   */
+  std::uint32_t size() const { return capacity_ - free_slots_.size(); }
+
+ private:
+  /**
+   * Page held by a slot of the cache file.
+   */
+  struct Slot {
+    std::string filename;
+    PageId page_number;
+    bool used;
+    bool referenced;
+  };
+
+  /**
+   * Returns a free slot, evicting the page of an unreferenced slot if none is
+   * free.
+   */
+  std::uint32_t allocateSlot();
+
+  /**
+   * Releases a slot and removes its page from the index.
+   */
+  void freeSlot(const std::uint32_t slot);
+
+  /**
+   * Cache file.  Slot i is page i + 1 of the file.
+   */
+  std::unique_ptr<BlobFile> cache_file_;
+
+  /**
+   * Name of the cache file.
+   */
+  std::string cache_name_;
+
+  /**
+   * Number of slots.
+   */
+  std::uint32_t capacity_;
+
+  /**
+   * Admission policy.
+   */
+  AdmissionPolicy policy_;
+
+  /**
+   * Descriptors of the slots.
+   */
+  std::vector<Slot> slots_;
+
+  /**
+   * Slots not holding a page.
+   */
+  std::vector<std::uint32_t> free_slots_;
+
+  /**
+   * Current position of the clock over the slots.
+   */
+  std::uint32_t clock_hand_;
+
+  /**
+   * Slot of every cached page, by file name and page number.
+   */
+  std::unordered_map<std::string, std::unordered_map<PageId, std::uint32_t> >
+      index_;
+
+  /**
+   * Pages offered once but not admitted yet, by file name.
+   */
+  std::unordered_map<std::string, std::unordered_set<PageId> > ghosts_;
+
+  /**
+   * Order in which ghosts were added, to forget the oldest ones.
+   */
+  std::deque<std::pair<std::string, PageId> > ghost_order_;
+
+  std::uint64_t hits_;
+  std::uint64_t misses_;
+  std::uint64_t admitted_;
+};
+
+}
@@ -15,17 +15,17 @@ FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
   file = new PageFile(name, false);	//dont create new file
 	bufMgr = bufferMgr;
 	curDirtyFlag = false;
-  curPage = NULL;
 	filePageIter = file->begin();
 }
 
 FileScan::~FileScan()
 {
   // generally must unpin last page of the scan
-  if (curPage != NULL)
+  if (curPage.valid())
   {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
-    curPage = NULL;
+    if (curDirtyFlag)
+      curPage.markDirty();
+    curPage.release();
 		curDirtyFlag = false;
     filePageIter = file->begin();
   }
@@ -43,7 +43,7 @@ void FileScan::scanNext(RecordId& outRid)
 	}
 
   // special case of the first record of the first page of the file
-  if (curPage == NULL)
+  if (!curPage.valid())
   {
     // need to get the first page of the file
 		filePageIter = file->begin();
@@ -53,13 +53,13 @@ void FileScan::scanNext(RecordId& outRid)
 		}
 	 
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
+    curPage = bufMgr->readPage(file, (*filePageIter).page_number());
 		curDirtyFlag = false;
 
 		// get the first record off the page
-    pageRecordIter = curPage->begin(); 
+    pageRecordIter = curPage.page()->begin();
 
-		if(pageRecordIter != curPage->end()) 
+		if(pageRecordIter != curPage.page()->end())
 		{
 		  // get pointer to record
 		  rec = *pageRecordIter;
@@ -73,25 +73,25 @@ void FileScan::scanNext(RecordId& outRid)
 	// First try and get the next record off the current page
 	pageRecordIter++;
 
-  while (pageRecordIter == curPage->end())
+  while (pageRecordIter == curPage.page()->end())
   {
     // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
-    curPage = NULL;
+    if (curDirtyFlag)
+      curPage.markDirty();
+    curPage.release();
     curDirtyFlag = false;
 
     filePageIter++;
     if (filePageIter == file->end())
     {
-      curPage = NULL;
 			throw EndOfFileException();
     }
 
     // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+    curPage = bufMgr->readPage(file, (*filePageIter).page_number());
 
     // get the first record off the page
-    pageRecordIter = curPage->begin(); 
+    pageRecordIter = curPage.page()->begin();
   }
 
   // curRec points at a valid record
@@ -49,9 +49,10 @@ class FileScan
 	BufMgr				*bufMgr;
 
   /**
-   * Current page being scanned.
+   * Handle of the current page being scanned.  The page stays pinned while
+   * the scan is on it.
    */
-  Page*         curPage;
+  PageHandle    curPage;
 
   FileIterator  filePageIter;
   PageIterator  pageRecordIter;
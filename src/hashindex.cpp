@@ -0,0 +1,364 @@
+/**
+ * This file contains the implementation of the hash index interface as defined in hashindex.h
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "hashindex.h"
+#include "filescan.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_exists_exception.h"
+
+namespace badgerdb
+{
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::HashIndex -- Constructor
+    // -----------------------------------------------------------------------------
+    HashIndex::HashIndex(
+            const std::string & relationName,
+            std::string & outIndexName,
+            BufMgr *bufMgrIn,
+            const int attrByteOffset,
+            const Datatype attrType) {
+
+        // Create index file name
+        std::ostringstream idxStr;
+        idxStr << relationName << '.' << attrByteOffset;
+        outIndexName = idxStr.str();
+
+        bufMgr = bufMgrIn;
+        splits = 0;
+        overflows = 0;
+
+        try {
+            file = new BlobFile(outIndexName, true);
+
+            // Allocate the meta page, the first directory page and a single, empty bucket
+            PageId directoryPageNum, bucketPageNum;
+            PageHandle headerPage = bufMgr->allocPage(file, headerPageNum);
+            bufMgr->allocPage(file, directoryPageNum).release();
+            PageHandle bucketPage = bufMgr->allocPage(file, bucketPageNum);
+
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            strcpy(metadata->relationName, relationName.c_str());
+            metadata->attrByteOffset = attrByteOffset;
+            metadata->attrType = attrType;
+            metadata->rootPageNo = directoryPageNum;
+            metadata->indexKind = HASH_INDEX;
+            headerPage.markDirty();
+            headerPage.release();
+
+            auto bucket = (HashBucketInt*) bucketPage.page();
+            bucket->localDepth = 0;
+            bucket->numEntries = 0;
+            bucket->overflowPageNo = Page::INVALID_NUMBER;
+            bucketPage.markDirty();
+            bucketPage.release();
+
+            globalDepth = 0;
+            directory.push_back(bucketPageNum);
+            directoryPages.push_back(directoryPageNum);
+            freePageNum = Page::INVALID_NUMBER;
+
+            // Scan relation and insert entries for all tuples into index
+            try {
+                FileScan fileScan(relationName, bufMgr);
+                RecordId rid = {};
+                while (true) {
+                    fileScan.scanNext(rid);
+                    insertEntry((int*) fileScan.getRecord().c_str() + attrByteOffset, rid);
+                }
+            } catch (EndOfFileException& e) {
+                // Do nothing. Finished scanning file.
+            }
+            writeDirectory();
+        } catch (FileExistsException& e) {
+            file = new BlobFile(outIndexName, false);
+            headerPageNum = file->getFirstPageNo();
+
+            PageHandle headerPage = bufMgr->readPage(file, headerPageNum);
+            auto metadata = (IndexMetaInfo*) headerPage.page();
+            if (strcmp(metadata->relationName, relationName.c_str()) != 0
+                || metadata->attrByteOffset != attrByteOffset
+                || metadata->attrType != attrType
+                || metadata->indexKind != HASH_INDEX) {
+                headerPage.release();
+                bufMgr->flushFile(file);
+                delete file;
+                throw BadIndexInfoException("Error: Existing index metadata does not match parameters passed.");
+            }
+
+            // Read the directory into memory
+            PageId pageNo = metadata->rootPageNo;
+            headerPage.release();
+            while (pageNo != Page::INVALID_NUMBER) {
+                PageHandle page = bufMgr->readPage(file, pageNo);
+                auto directoryPage = (const HashDirectoryInt*) page.page();
+                if (directoryPages.empty()) {
+                    globalDepth = directoryPage->globalDepth;
+                    freePageNum = directoryPage->freePageNo;
+                }
+                const std::size_t count = std::min<std::size_t>(HASH_DIRECTORY_SIZE,
+                                                                ((std::size_t) 1 << globalDepth) - directory.size());
+                directory.insert(directory.end(), directoryPage->bucketArray, directoryPage->bucketArray + count);
+                directoryPages.push_back(pageNo);
+                pageNo = directoryPage->nextPageNo;
+            }
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::~HashIndex -- destructor
+    // -----------------------------------------------------------------------------
+    HashIndex::~HashIndex() {
+        writeDirectory();
+        bufMgr->flushFile(file);
+        delete file;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::hash
+    // -----------------------------------------------------------------------------
+    std::uint32_t HashIndex::hash(const int key) {
+        // Finalizer of MurmurHash3: every key bit affects the low bits the directory uses
+        std::uint32_t h = (std::uint32_t) key;
+        h ^= h >> 16;
+        h *= 0x85ebca6b;
+        h ^= h >> 13;
+        h *= 0xc2b2ae35;
+        h ^= h >> 16;
+        return h;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::insertEntry
+    // -----------------------------------------------------------------------------
+    void HashIndex::insertEntry(const void *key, const RecordId rid) {
+        if (key == nullptr)
+            return;
+
+        const int intKey = *((int*) key);
+        const std::uint32_t h = hash(intKey);
+        while (true) {
+            const std::size_t dirIdx = h & (((std::uint32_t) 1 << globalDepth) - 1);
+
+            // The entry goes to the first page of the bucket with room
+            PageHandle page = bufMgr->readPage(file, directory[dirIdx]);
+            while (true) {
+                auto bucket = (HashBucketInt*) page.page();
+                if (bucket->numEntries < HASH_BUCKET_SIZE) {
+                    bucket->keyArray[bucket->numEntries] = intKey;
+                    bucket->ridArray[bucket->numEntries] = rid;
+                    bucket->numEntries++;
+                    page.markDirty();
+                    return;
+                }
+                if (bucket->overflowPageNo == Page::INVALID_NUMBER)
+                    break;
+                page = bufMgr->readPage(file, bucket->overflowPageNo);
+            }
+            page.release();
+
+            splitBucket(dirIdx, intKey);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::lookup
+    // -----------------------------------------------------------------------------
+    void HashIndex::lookup(const void *key, RecordId& outRid) {
+        const int intKey = *((int*) key);
+        PageId pageNo = directory[hash(intKey) & (((std::uint32_t) 1 << globalDepth) - 1)];
+        while (pageNo != Page::INVALID_NUMBER) {
+            PageHandle page = bufMgr->readPage(file, pageNo);
+            auto bucket = (const HashBucketInt*) page.page();
+            for (int i = 0; i < bucket->numEntries; i++) {
+                if (bucket->keyArray[i] == intKey) {
+                    outRid = bucket->ridArray[i];
+                    return;
+                }
+            }
+            pageNo = bucket->overflowPageNo;
+        }
+        throw NoSuchKeyFoundException();
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::allocBucketPage
+    // -----------------------------------------------------------------------------
+    PageHandle HashIndex::allocBucketPage(PageId& pageNo) {
+        if (freePageNum == Page::INVALID_NUMBER)
+            return bufMgr->allocPage(file, pageNo);
+
+        pageNo = freePageNum;
+        PageHandle page = bufMgr->readPage(file, pageNo);
+        freePageNum = ((const HashBucketInt*) page.page())->overflowPageNo;
+        return page;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::splitBucket
+    // -----------------------------------------------------------------------------
+    void HashIndex::splitBucket(const std::size_t dirIdx, const int intKey) {
+        const PageId pageNo = directory[dirIdx];
+
+        // Collect the entries of all pages of the bucket; its overflow pages are reused below
+        std::vector<int> keys;
+        std::vector<RecordId> rids;
+        std::vector<PageId> spare;
+        int localDepth = 0;
+        PageId lastPageNo = pageNo;
+        for (PageId next = pageNo; next != Page::INVALID_NUMBER; ) {
+            PageHandle page = bufMgr->readPage(file, next);
+            auto bucket = (const HashBucketInt*) page.page();
+            localDepth = bucket->localDepth;
+            keys.insert(keys.end(), bucket->keyArray, bucket->keyArray + bucket->numEntries);
+            rids.insert(rids.end(), bucket->ridArray, bucket->ridArray + bucket->numEntries);
+            if (next != pageNo)
+                spare.push_back(next);
+            lastPageNo = next;
+            next = bucket->overflowPageNo;
+        }
+
+        // A split only helps if some key differs from the new one in a hash bit the directory may use
+        const std::uint32_t mask = ((std::uint32_t) 1 << HASH_MAX_DEPTH) - 1;
+        bool separable = false;
+        for (std::size_t i = 0; i < keys.size() && !separable; i++)
+            separable = (hash(keys[i]) & mask) != (hash(intKey) & mask);
+        if (!separable) {
+            PageId overflowPageNo;
+            PageHandle overflowPage = allocBucketPage(overflowPageNo);
+            auto bucket = (HashBucketInt*) overflowPage.page();
+            bucket->localDepth = localDepth;
+            bucket->numEntries = 0;
+            bucket->overflowPageNo = Page::INVALID_NUMBER;
+            overflowPage.markDirty();
+
+            PageHandle lastPage = bufMgr->readPage(file, lastPageNo);
+            ((HashBucketInt*) lastPage.page())->overflowPageNo = overflowPageNo;
+            lastPage.markDirty();
+            overflows++;
+            return;
+        }
+
+        if (localDepth == globalDepth) {
+            const std::size_t size = directory.size();
+            directory.resize(2 * size);
+            std::copy(directory.begin(), directory.begin() + size, directory.begin() + size);
+            globalDepth++;
+        }
+
+        // Entries with the next hash bit set move to a new bucket
+        const std::uint32_t bit = (std::uint32_t) 1 << localDepth;
+        std::vector<int> stayKeys, moveKeys;
+        std::vector<RecordId> stayRids, moveRids;
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            if (hash(keys[i]) & bit) {
+                moveKeys.push_back(keys[i]);
+                moveRids.push_back(rids[i]);
+            } else {
+                stayKeys.push_back(keys[i]);
+                stayRids.push_back(rids[i]);
+            }
+        }
+
+        PageId newPageNo;
+        if (spare.empty()) {
+            allocBucketPage(newPageNo).release();
+        } else {
+            newPageNo = spare.back();
+            spare.pop_back();
+        }
+        writeBucket(pageNo, localDepth + 1, stayKeys, stayRids, spare);
+        writeBucket(newPageNo, localDepth + 1, moveKeys, moveRids, spare);
+        for (std::size_t i = 0; i < directory.size(); i++) {
+            if (directory[i] == pageNo && (i & bit))
+                directory[i] = newPageNo;
+        }
+
+        // Overflow pages no longer needed go to the free list
+        for (PageId unused : spare) {
+            PageHandle page = bufMgr->readPage(file, unused);
+            auto bucket = (HashBucketInt*) page.page();
+            bucket->numEntries = 0;
+            bucket->overflowPageNo = freePageNum;
+            page.markDirty();
+            freePageNum = unused;
+        }
+        splits++;
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::writeBucket
+    // -----------------------------------------------------------------------------
+    void HashIndex::writeBucket(const PageId pageNo, const int localDepth, const std::vector<int>& keys,
+                                const std::vector<RecordId>& rids, std::vector<PageId>& spare) {
+        std::size_t next = 0;
+        PageHandle page = bufMgr->readPage(file, pageNo);
+        while (true) {
+            auto bucket = (HashBucketInt*) page.page();
+            bucket->localDepth = localDepth;
+            bucket->numEntries = (int) std::min<std::size_t>(HASH_BUCKET_SIZE, keys.size() - next);
+            std::copy(keys.begin() + next, keys.begin() + next + bucket->numEntries, bucket->keyArray);
+            std::copy(rids.begin() + next, rids.begin() + next + bucket->numEntries, bucket->ridArray);
+            next += bucket->numEntries;
+            page.markDirty();
+            if (next == keys.size()) {
+                bucket->overflowPageNo = Page::INVALID_NUMBER;
+                return;
+            }
+
+            PageId overflowPageNo;
+            PageHandle overflowPage;
+            if (spare.empty()) {
+                overflowPage = allocBucketPage(overflowPageNo);
+            } else {
+                overflowPageNo = spare.back();
+                spare.pop_back();
+                overflowPage = bufMgr->readPage(file, overflowPageNo);
+            }
+            bucket->overflowPageNo = overflowPageNo;
+            page = std::move(overflowPage);
+        }
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // HashIndex::writeDirectory
+    // -----------------------------------------------------------------------------
+    void HashIndex::writeDirectory() {
+        const std::size_t numPages = (directory.size() + HASH_DIRECTORY_SIZE - 1) / HASH_DIRECTORY_SIZE;
+        while (directoryPages.size() < numPages) {
+            PageId pageNo;
+            bufMgr->allocPage(file, pageNo).release();
+            directoryPages.push_back(pageNo);
+        }
+
+        for (std::size_t p = 0; p < numPages; p++) {
+            PageHandle page = bufMgr->readPage(file, directoryPages[p]);
+            auto directoryPage = (HashDirectoryInt*) page.page();
+            directoryPage->globalDepth = globalDepth;
+            directoryPage->freePageNo = freePageNum;
+            directoryPage->nextPageNo = p + 1 < numPages ? directoryPages[p + 1] : Page::INVALID_NUMBER;
+            const std::size_t first = p * HASH_DIRECTORY_SIZE;
+            const std::size_t count = std::min<std::size_t>(HASH_DIRECTORY_SIZE, directory.size() - first);
+            std::copy(directory.begin() + first, directory.begin() + first + count, directoryPage->bucketArray);
+            page.markDirty();
+        }
+    }
+
+}
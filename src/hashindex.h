@@ -0,0 +1,257 @@
+/**
+ * This is the header file for an extendible hash index over a single INTEGER attribute.
+ * It takes the constructor arguments of BTreeIndex, but answers equality probes only.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "btree.h"
+
+namespace badgerdb
+{
+
+/**
+ * @brief Number of entries in a hash bucket page.
+ */
+//                                                          depth, entry count   overflow ptr            key               rid
+    constexpr int HASH_BUCKET_SIZE = ( Page::SIZE - 2 * sizeof( int ) - sizeof( PageId ) ) / ( sizeof( int ) + sizeof( RecordId ) );
+
+/**
+ * @brief Number of bucket page numbers in a hash directory page.
+ */
+//                                                        global depth, free list, next page
+    constexpr int HASH_DIRECTORY_SIZE = ( Page::SIZE - sizeof( int ) - 2 * sizeof( PageId ) ) / sizeof( PageId );
+
+/**
+ * @brief Largest number of hash bits the directory uses. Buckets that fill up at this depth get
+ * overflow pages instead of splitting.
+ */
+    constexpr int HASH_MAX_DEPTH = 20;
+
+/**
+ * @brief Structure for the pages of a hash bucket: the primary page the directory points to and
+ * the overflow pages chained behind it. Entries are unordered.
+ */
+    struct HashBucketInt {
+        /**
+         * Number of low hash bits all keys in the bucket share.
+         */
+        int localDepth;
+
+        /**
+         * Number of entries in use.
+         */
+        int numEntries;
+
+        /**
+         * Page number of the next overflow page of the bucket.
+         */
+        PageId overflowPageNo;
+
+        /**
+         * Stores keys.
+         */
+        int keyArray[ HASH_BUCKET_SIZE ];
+
+        /**
+         * Stores RecordIds.
+         */
+        RecordId ridArray[ HASH_BUCKET_SIZE ];
+    };
+
+/**
+ * @brief Structure for the pages of the hash directory. The directory has 2^globalDepth entries;
+ * entry i points to the bucket holding the keys whose hash ends in the low globalDepth bits of i.
+ * The global depth and the free list are kept in the first page.
+ */
+    struct HashDirectoryInt {
+        /**
+         * Number of low hash bits the directory uses.
+         */
+        int globalDepth;
+
+        /**
+         * First page of the list of unused bucket pages, chained by their overflow page numbers.
+         */
+        PageId freePageNo;
+
+        /**
+         * Page number of the next directory page.
+         */
+        PageId nextPageNo;
+
+        /**
+         * Stores page numbers of the primary bucket pages.
+         */
+        PageId bucketArray[ HASH_DIRECTORY_SIZE ];
+    };
+
+    static_assert(sizeof(HashBucketInt) <= Page::SIZE && sizeof(HashDirectoryInt) <= Page::SIZE,
+                  "Hash index pages must fit into a page.");
+
+
+/**
+ * @brief HashIndex class. It implements an extendible hash index on a single INTEGER attribute of a
+ * relation. The directory is kept in memory while the index is open, so a probe reads the one primary
+ * bucket page of its key, plus the overflow pages of that bucket if it has any. A full bucket splits
+ * in two, doubling the directory if needed. Duplicate keys, which no split can separate, go to
+ * overflow pages.
+ */
+    class HashIndex {
+
+    private:
+
+        /**
+         * File object for the index file.
+         */
+        File		*file;
+
+        /**
+         * Buffer Manager Instance.
+         */
+        BufMgr	*bufMgr;
+
+        /**
+         * Page number of meta page.
+         */
+        PageId	headerPageNum;
+
+        /**
+         * Number of low hash bits the directory uses.
+         */
+        int		globalDepth;
+
+        /**
+         * Page numbers of the primary bucket pages, 2^globalDepth entries.
+         */
+        std::vector<PageId>	directory;
+
+        /**
+         * Pages of the index file holding the directory, in order.
+         */
+        std::vector<PageId>	directoryPages;
+
+        /**
+         * First page of the list of unused bucket pages.
+         */
+        PageId	freePageNum;
+
+        /**
+         * Number of bucket splits.
+         */
+        std::uint64_t	splits;
+
+        /**
+         * Number of overflow pages added to buckets.
+         */
+        std::uint64_t	overflows;
+
+
+        /**
+         * Hashes a key. The directory uses the low bits of the hash.
+         */
+        static std::uint32_t hash(int key);
+
+        /**
+         * Returns a page for a bucket, from the free list if it has any.
+         * @param pageNo	Set to the page number
+         * @return Handle of the pinned page
+         */
+        PageHandle allocBucketPage(PageId& pageNo);
+
+        /**
+         * Splits a full bucket in two, on the next hash bit, doubling the directory if needed.
+         * Gives the bucket an overflow page instead if no split can make room for the key.
+         * @param dirIdx	Directory entry of the bucket
+         * @param intKey	Key that does not fit into the bucket
+         */
+        void splitBucket(std::size_t dirIdx, int intKey);
+
+        /**
+         * Writes entries to the pages of a bucket.
+         * @param pageNo	Primary page of the bucket
+         * @param localDepth	Local depth of the bucket
+         * @param keys		Keys of the entries
+         * @param rids		RecordIds of the entries
+         * @param spare		Pages to use for overflow pages before taking new ones; used pages are removed
+         */
+        void writeBucket(PageId pageNo, int localDepth, const std::vector<int>& keys,
+                         const std::vector<RecordId>& rids, std::vector<PageId>& spare);
+
+        /**
+         * Writes the directory and the free list to the directory pages.
+         */
+        void writeDirectory();
+
+    public:
+
+        /**
+         * HashIndex Constructor.
+         * Check to see if the corresponding index file exists. If so, open the file and read the directory.
+         * If not, create it and insert entries for every tuple in the base relation using FileScan class.
+         *
+         * @param relationName        Name of file.
+         * @param outIndexName        Return the name of index file.
+         * @param bufMgrIn			  Buffer Manager Instance
+         * @param attrByteOffset	  Offset of attribute, over which index is to be built, in the record
+         * @param attrType			  Datatype of attribute over which index is built
+         * @throws  BadIndexInfoException     If the index file already exists for the corresponding attribute, but values in metapage(relationName, attribute byte offset, attribute type etc.) do not match with values received through constructor parameters, or the file holds another kind of index.
+         */
+        HashIndex(const std::string & relationName, std::string & outIndexName,
+                  BufMgr *bufMgrIn, const int attrByteOffset, const Datatype attrType);
+
+
+        /**
+         * HashIndex Destructor.
+         * Write the directory, flush index file from the buffer manager and delete file instance thereby
+         * closing the index file.
+         */
+        ~HashIndex();
+
+
+        /**
+         * Insert a new entry using the pair <value,rid>.
+         * @param key			Key to insert, pointer to integer
+         * @param rid			Record ID of a record whose entry is getting inserted into the index.
+         */
+        void insertEntry(const void* key, RecordId rid);
+
+
+        /**
+         * Find the record id of an entry with the given key.
+         * @param key			Key to search for, pointer to integer
+         * @param outRid		RecordId of the entry returned in this
+         * @throws  NoSuchKeyFoundException If there is no entry with the key in the index.
+         */
+        void lookup(const void* key, RecordId& outRid);
+
+
+        /**
+         * Returns the number of low hash bits the directory uses.
+         */
+        int depth() const { return globalDepth; }
+
+
+        /**
+         * Returns the number of bucket splits so far.
+         */
+        std::uint64_t splitCount() const { return splits; }
+
+
+        /**
+         * Returns the number of overflow pages added to buckets so far.
+         */
+        std::uint64_t overflowCount() const { return overflows; }
+
+    };
+
+}
@@ -0,0 +1,81 @@
+/**
+ * This file contains the implementation of the piecewise-linear model as defined in learned_model.h
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "learned_model.h"
+
+namespace badgerdb
+{
+
+    // -----------------------------------------------------------------------------
+    // PiecewiseLinearModel::PiecewiseLinearModel -- Constructor
+    // -----------------------------------------------------------------------------
+    PiecewiseLinearModel::PiecewiseLinearModel(const std::vector<int>& keys, const int maxError)
+            : numKeys(keys.size()), maxError(maxError) {
+        if (keys.empty())
+            return;
+
+        // The slopes of the lines through the first point of the segment that predict every point so far
+        // within the error form a cone; a point outside of it starts the next segment
+        const double infinity = std::numeric_limits<double>::infinity();
+        Segment current = {keys[0], 0, 0};
+        double lowSlope = 0, highSlope = infinity;
+        for (std::size_t i = 1; i < keys.size(); i++) {
+            const double dx = (double) keys[i] - current.firstKey;
+            const double dy = (double) i - current.firstPosition;
+            double newLow = lowSlope, newHigh = highSlope;
+            if (dx > 0) {
+                newLow = std::max(lowSlope, (dy - maxError) / dx);
+                newHigh = std::min(highSlope, (dy + maxError) / dx);
+            } else if (dy > maxError) {
+                // A run of duplicates longer than the error
+                newLow = infinity;
+            }
+
+            if (newLow > newHigh) {
+                current.slope = highSlope == infinity ? lowSlope : (lowSlope + highSlope) / 2;
+                segments.push_back(current);
+                current.firstKey = keys[i];
+                current.firstPosition = (double) i;
+                lowSlope = 0;
+                highSlope = infinity;
+            } else {
+                lowSlope = newLow;
+                highSlope = newHigh;
+            }
+        }
+        current.slope = highSlope == infinity ? lowSlope : (lowSlope + highSlope) / 2;
+        segments.push_back(current);
+    }
+
+
+    // -----------------------------------------------------------------------------
+    // PiecewiseLinearModel::bounds
+    // -----------------------------------------------------------------------------
+    bool PiecewiseLinearModel::bounds(const int key, std::uint64_t& low, std::uint64_t& high) const {
+        if (segments.empty())
+            return false;
+
+        // The last segment starting at or before the key
+        auto segment = std::upper_bound(segments.begin(), segments.end(), key,
+                                        [](const int k, const Segment& s) { return k < s.firstKey; });
+        if (segment != segments.begin())
+            segment--;
+
+        // One position of slack for rounding
+        const double predicted = segment->firstPosition + segment->slope * ((double) key - segment->firstKey);
+        const double last = (double) (numKeys - 1);
+        low = (std::uint64_t) std::min(last, std::max(0.0, std::floor(predicted) - maxError - 1));
+        high = (std::uint64_t) std::min(last, std::max(0.0, std::ceil(predicted) + maxError + 1));
+        return true;
+    }
+
+}
@@ -0,0 +1,85 @@
+/**
+ * This is the header file for a piecewise-linear model of the positions of sorted INTEGER keys, used by
+ * indexes to find an entry without searching their non-leaf nodes.
+ *
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace badgerdb
+{
+
+/**
+ * @brief Default largest distance between the predicted and the actual position of a key.
+ */
+    constexpr int LEARNED_MAX_ERROR = 32;
+
+
+/**
+ * @brief PiecewiseLinearModel class. It predicts the position of a key in a sorted sequence of keys
+ * with a few linear segments, each covering a run of consecutive keys. Training makes one pass over the
+ * keys and starts a new segment whenever no line through the first key of the current one predicts all
+ * its keys within the error bound, so the prediction for every trained key is off by at most that bound.
+ */
+    class PiecewiseLinearModel {
+
+    private:
+
+        /**
+         * Line predicting the positions of the keys from firstKey up to the first key of the next segment.
+         */
+        struct Segment {
+            int firstKey;
+            double firstPosition;
+            double slope;
+        };
+
+        /**
+         * Segments in key order.
+         */
+        std::vector<Segment>	segments;
+
+        /**
+         * Number of keys the model was trained on.
+         */
+        std::uint64_t	numKeys;
+
+        /**
+         * Largest distance between the predicted and the actual position of a trained key.
+         */
+        int		maxError;
+
+    public:
+
+        /**
+         * Trains a model.
+         * @param keys		Keys in ascending order; position i holds keys[i]
+         * @param maxError	Largest distance allowed between the predicted and the actual position of a key
+         */
+        PiecewiseLinearModel(const std::vector<int>& keys, int maxError);
+
+        /**
+         * Returns the range of positions that holds the key if it was among the trained keys.
+         * @param key		Key to search for
+         * @param low		Set to the first position of the range
+         * @param high		Set to the last position of the range
+         * @return False if the model was trained on no keys
+         */
+        bool bounds(int key, std::uint64_t& low, std::uint64_t& high) const;
+
+        /**
+         * Returns the number of segments.
+         */
+        std::size_t segmentCount() const { return segments.size(); }
+
+    };
+
+}
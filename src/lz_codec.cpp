@@ -0,0 +1,188 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "lz_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace badgerdb {
+namespace lz_codec {
+
+namespace {
+
+const std::size_t MIN_MATCH = 4;
+// The last bytes of a block are always emitted as literals.
+const std::size_t LAST_LITERALS = 5;
+const int HASH_BITS = 12;
+const std::size_t MAX_OFFSET = 65535;
+
+std::uint32_t read32(const unsigned char* p) {
+  std::uint32_t value;
+  std::memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+std::uint32_t hash(const std::uint32_t sequence) {
+  return (sequence * 2654435761u) >> (32 - HASH_BITS);
+}
+
+// Writes the continuation bytes of a length of 15 or more.
+bool writeLength(std::size_t length, unsigned char*& op,
+                 const unsigned char* oend) {
+  while (length >= 255) {
+    if (op >= oend) return false;
+    *op++ = 255;
+    length -= 255;
+  }
+  if (op >= oend) return false;
+  *op++ = static_cast<unsigned char>(length);
+  return true;
+}
+
+// Writes one sequence; match_length 0 marks the final, literal-only one.
+bool writeSequence(const unsigned char* literals, const std::size_t literal_length,
+                   const std::size_t offset, const std::size_t match_length,
+                   unsigned char*& op, const unsigned char* oend) {
+  if (op >= oend) return false;
+  unsigned char* token = op++;
+  *token = static_cast<unsigned char>((literal_length >= 15 ? 15 : literal_length) << 4);
+  if (literal_length >= 15 && !writeLength(literal_length - 15, op, oend)) {
+    return false;
+  }
+  if (static_cast<std::size_t>(oend - op) < literal_length) return false;
+  std::memcpy(op, literals, literal_length);
+  op += literal_length;
+
+  if (match_length == 0) return true;
+
+  if (oend - op < 2) return false;
+  *op++ = static_cast<unsigned char>(offset & 0xff);
+  *op++ = static_cast<unsigned char>(offset >> 8);
+  const std::size_t length = match_length - MIN_MATCH;
+  *token |= static_cast<unsigned char>(length >= 15 ? 15 : length);
+  return length < 15 || writeLength(length - 15, op, oend);
+}
+
+// Reads the continuation bytes of a length.
+bool readLength(std::size_t& length, const unsigned char*& ip,
+                const unsigned char* iend) {
+  unsigned char byte;
+  do {
+    if (ip >= iend) return false;
+    byte = *ip++;
+    length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+}
+
+std::size_t compress(const char* src, const std::size_t src_size, char* dst,
+                     const std::size_t dst_capacity) {
+  const unsigned char* const base = reinterpret_cast<const unsigned char*>(src);
+  const unsigned char* const iend = base + src_size;
+  const unsigned char* ip = base;
+  const unsigned char* anchor = base;
+  unsigned char* op = reinterpret_cast<unsigned char*>(dst);
+  const unsigned char* const oend = op + dst_capacity;
+
+  // Positions of the last occurrence of each hashed sequence, plus one.
+  std::uint16_t table[1 << HASH_BITS];
+  std::memset(table, 0, sizeof(table));
+
+  if (src_size > MIN_MATCH + LAST_LITERALS) {
+    const unsigned char* const match_limit = iend - LAST_LITERALS;
+    while (ip + MIN_MATCH <= match_limit) {
+      const std::uint32_t sequence = read32(ip);
+      const std::uint32_t h = hash(sequence);
+      const std::size_t candidate = table[h];
+      table[h] = static_cast<std::uint16_t>(ip - base + 1);
+
+      if (candidate == 0) {
+        ++ip;
+        continue;
+      }
+      const unsigned char* ref = base + candidate - 1;
+      const std::size_t offset = ip - ref;
+      if (offset > MAX_OFFSET || read32(ref) != sequence) {
+        ++ip;
+        continue;
+      }
+
+      const unsigned char* p = ip + MIN_MATCH;
+      ref += MIN_MATCH;
+      while (p < match_limit && *p == *ref) {
+        ++p;
+        ++ref;
+      }
+      if (!writeSequence(anchor, ip - anchor, offset, p - ip, op, oend)) {
+        return 0;
+      }
+      ip = p;
+      anchor = ip;
+    }
+  }
+
+  if (!writeSequence(anchor, iend - anchor, 0, 0, op, oend)) {
+    return 0;
+  }
+  return op - reinterpret_cast<unsigned char*>(dst);
+}
+
+bool decompress(const char* src, const std::size_t src_size, char* dst,
+                const std::size_t dst_size) {
+  const unsigned char* ip = reinterpret_cast<const unsigned char*>(src);
+  const unsigned char* const iend = ip + src_size;
+  unsigned char* const obase = reinterpret_cast<unsigned char*>(dst);
+  unsigned char* op = obase;
+  const unsigned char* const oend = op + dst_size;
+
+  while (ip < iend) {
+    const unsigned char token = *ip++;
+
+    std::size_t literal_length = token >> 4;
+    if (literal_length == 15 && !readLength(literal_length, ip, iend)) {
+      return false;
+    }
+    if (static_cast<std::size_t>(iend - ip) < literal_length ||
+        static_cast<std::size_t>(oend - op) < literal_length) {
+      return false;
+    }
+    std::memcpy(op, ip, literal_length);
+    ip += literal_length;
+    op += literal_length;
+
+    // The last sequence has no match.
+    if (ip == iend) break;
+
+    if (iend - ip < 2) return false;
+    const std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+    ip += 2;
+    if (offset == 0 || offset > static_cast<std::size_t>(op - obase)) {
+      return false;
+    }
+
+    std::size_t match_length = token & 15;
+    if (match_length == 15 && !readLength(match_length, ip, iend)) {
+      return false;
+    }
+    match_length += MIN_MATCH;
+    if (static_cast<std::size_t>(oend - op) < match_length) return false;
+
+    // Matches may overlap their own output, so copy byte by byte.
+    const unsigned char* ref = op - offset;
+    for (std::size_t i = 0; i < match_length; ++i) {
+      op[i] = ref[i];
+    }
+    op += match_length;
+  }
+  return op == oend;
+}
+
+}
+}
@@ -0,0 +1,54 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * @brief Fast LZ77 block codec for pages.
+ *
+ * The format follows the LZ4 block format: a sequence is a token byte holding
+ * the literal length and the match length, the literals, and a two byte
+ * little-endian offset back into the output.  Lengths of 15 or more continue
+ * in extra bytes.  The last sequence only holds literals.  Matches are found
+ * with a single-probe hash table, which favours speed over ratio; pages of
+ * sorted integer keys and sparse slots still shrink several times.
+ */
+namespace lz_codec {
+
+/**
+ * Compresses a block.
+ *
+ * @param src           Bytes to compress.
+ * @param src_size      Number of bytes to compress, at most 65535.
+ * @param dst           Buffer for the compressed bytes.
+ * @param dst_capacity  Size of the buffer.
+ * @return  Number of compressed bytes, or 0 if they do not fit into the
+ *          buffer.
+ */
+std::size_t compress(const char* src, const std::size_t src_size, char* dst,
+                     const std::size_t dst_capacity);
+
+/**
+ * Decompresses a block written by compress().
+ *
+ * @param src       Compressed bytes.
+ * @param src_size  Number of compressed bytes.
+ * @param dst       Buffer for the original bytes.
+ * @param dst_size  Number of original bytes.
+ * @return  True if the block decompressed to exactly dst_size bytes; false if
+ *          it is corrupt.
+ */
+bool decompress(const char* src, const std::size_t src_size, char* dst,
+                const std::size_t dst_size);
+
+}
+
+}
@@ -12,12 +12,23 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <climits>
 #include <vector>
+#include <set>
+#include <fstream>
+#include <thread>
 #include "btree.h"
+#include "betree.h"
+#include "bwtree.h"
+#include "hashindex.h"
+#include "art.h"
 #include "page.h"
 #include "filescan.h"
 #include "page_iterator.h"
 #include "file_iterator.h"
+#include "file_appender.h"
+#include "file_cache_tier.h"
+#include "compressed_memory_tier.h"
 #include "exceptions/insufficient_space_exception.h"
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
@@ -26,6 +37,10 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/page_pinned_exception.h"
+#include "exceptions/invalid_page_size_exception.h"
+#include "exceptions/bad_index_info_exception.h"
+#include "exceptions/buffer_exceeded_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -47,6 +62,10 @@ using namespace badgerdb;
 // Globals
 // -----------------------------------------------------------------------------
 int testNum = 1;
+// Number of top levels of the index kept resident in the buffer pool by intTests
+int residentLevels = 0;
+// Format of the index file intTests creates
+IndexFileFormat indexFileFormat = PLAIN_FILE;
 const std::string relationName = "relA";
 //If the relation size is changed then the second parameter 2 chechPassFail may need to be changed to number of record that are expected to be found during the scan, else tests will erroneously be reported to have failed.
 int	relationSize = 5000;
@@ -78,7 +97,10 @@ void createBigRelationForward();
 void createBigRelationBackward();
 void createBigRelationRandom();
 void intTests();
-int intScan(BTreeIndex *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+template <class Index>
+int intScan(Index *index, int lowVal, Operator lowOp, int highVal, Operator highOp);
+template <class Index>
+int intLookup(Index *index, int lowVal, int highVal);
 void indexTests();
 void test1();
 void test2();
@@ -89,6 +111,30 @@ void test6();
 void test7();
 void test8();
 void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void test31();
+void test32();
+void test33();
 void errorTests();
 void deleteRelation();
 
@@ -162,6 +208,30 @@ int main(int argc, char **argv)
 	test7();
 	test8();
 	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
+	test31();
+	test32();
+	test33();
 	// errorTests();
 	std::cout << "Passed all tests" << std::endl;
 
@@ -279,6 +349,1661 @@ void test9()
 	std::cout << "Test 9 Passed" << std::endl;
 }
 
+void test10()
+{
+	// Create a relation with tuples valued 0 to 100000 in random order and perform index tests
+	// with child references of the index swizzled by the buffer manager
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "createRelationRandom with swizzling for relationSize 100000" << std::endl;
+	relationSize = 100000;
+	bufMgr->setSwizzling(true);
+	createRelationRandom();
+	indexTests();
+	deleteRelation();
+	bufMgr->setSwizzling(false);
+	std::cout << "Test 10 Passed" << std::endl;
+}
+
+void test11()
+{
+	// Create a relation with tuples valued 0 to 100000 in random order and perform index tests
+	// with the top two levels of the index kept resident in the buffer pool
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "createRelationRandom with resident levels for relationSize 100000" << std::endl;
+	relationSize = 100000;
+	residentLevels = 2;
+	createRelationRandom();
+	indexTests();
+	deleteRelation();
+	residentLevels = 0;
+	std::cout << "Test 11 Passed" << std::endl;
+}
+
+void test12()
+{
+	// Scan a relation through one buffer pool, dump the hot pages of the pool and warm up
+	// a fresh pool with them. Reading the dumped pages must then not go to disk.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "dumpHotPages and restoreHotPages for relationSize 100000" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+
+	const std::string dumpName = relationName + ".hot";
+	std::uint32_t dumped;
+	{
+		BufMgr coldMgr(100);
+		FileScan fscan(relationName, &coldMgr);
+		try
+		{
+			RecordId scanRid;
+			while(1)
+				fscan.scanNext(scanRid);
+		}
+		catch(EndOfFileException e)
+		{
+		}
+		dumped = coldMgr.dumpHotPages(dumpName);
+	}
+	checkPassFail(dumped, 100)
+
+	{
+		BufMgr warmMgr(100);
+		checkPassFail(warmMgr.restoreHotPages(dumpName, std::vector<File*>(1, file1)), dumped)
+
+		warmMgr.clearBufStats();
+		std::ifstream dump(dumpName.c_str());
+		std::string line;
+		std::getline(dump, line);
+		PageId pageNo;
+		while(dump >> pageNo && std::getline(dump, line))
+		{
+			Page* page;
+			warmMgr.readPage(file1, pageNo, page);
+			warmMgr.unPinPage(file1, pageNo, false);
+		}
+		checkPassFail(warmMgr.getBufStats().diskreads, 0)
+	}
+
+	File::remove(dumpName);
+	deleteRelation();
+	std::cout << "Test 12 Passed" << std::endl;
+}
+
+void test13()
+{
+	// Grow and shrink a buffer pool holding dirty pages, then run the index tests
+	// on a relation with 100000 tuples in a shrunk pool
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "resize buffer pool" << std::endl;
+	const std::string blobName = relationName + ".resize";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		BufMgr mgr(100);
+		BlobFile file(blobName, true);
+		std::vector<PageId> pageNos(300);
+		for(int i = 0; i < 300; i++)
+		{
+			if(i == 100)
+				mgr.resize(300);
+			PageHandle page = mgr.allocPage(&file, pageNos[i]);
+			*reinterpret_cast<int*>(page.page()) = i;
+			page.markDirty();
+		}
+		// Growing the pool made room for all pages
+		checkPassFail(mgr.getBufStats().diskwrites, 0)
+
+		// A pinned page in the region to be removed stops the shrink
+		PageHandle pinned;
+		for(int i = 0; i < 300 && pinned.frameNo() < 20; i++)
+			pinned = mgr.readPage(&file, pageNos[i]);
+		bool shrinkFailed = false;
+		try
+		{
+			mgr.resize(20);
+		}
+		catch(const PagePinnedException&)
+		{
+			shrinkFailed = true;
+		}
+		checkPassFail(shrinkFailed, true)
+		pinned.release();
+
+		mgr.resize(20);
+		int found = 0;
+		for(int i = 0; i < 300; i++)
+		{
+			PageHandle page = mgr.readPage(&file, pageNos[i]);
+			if(*reinterpret_cast<int*>(page.page()) == i)
+				found++;
+		}
+		checkPassFail(found, 300)
+		mgr.flushFile(&file);
+	}
+	File::remove(blobName);
+
+	relationSize = 100000;
+	bufMgr->resize(30);
+	createRelationRandom();
+	indexTests();
+	deleteRelation();
+	bufMgr->resize(100);
+	std::cout << "Test 13 Passed" << std::endl;
+}
+
+void test14()
+{
+	// A file with reserved frames keeps its pages while another file streams through
+	// the pool, and a file with a maximum never holds more frames than allowed
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "file quotas" << std::endl;
+	const std::string hotName = relationName + ".hot";
+	const std::string batchName = relationName + ".batch";
+	try
+	{
+		File::remove(hotName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	try
+	{
+		File::remove(batchName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		BufMgr mgr(50);
+		BlobFile hotFile(hotName, true);
+		BlobFile batchFile(batchName, true);
+		mgr.setFileQuota(&hotFile, 20, 0);
+		mgr.setFileQuota(&batchFile, 0, 10);
+
+		std::vector<PageId> hotPages(20);
+		for(int i = 0; i < 20; i++)
+			mgr.allocPage(&hotFile, hotPages[i]).markDirty();
+
+		std::vector<PageId> batchPages(200);
+		for(int i = 0; i < 200; i++)
+			mgr.allocPage(&batchFile, batchPages[i]).markDirty();
+		checkPassFail(mgr.numFramesOf(&hotFile), 20)
+		checkPassFail(mgr.numFramesOf(&batchFile), 10)
+
+		// All pages of the hot file are still resident
+		const int hotReads = mgr.getFileStats(&hotFile).diskreads;
+		for(int i = 0; i < 20; i++)
+			mgr.readPage(&hotFile, hotPages[i]).release();
+		checkPassFail(mgr.getFileStats(&hotFile).diskreads - hotReads, 0)
+
+		// Rereading the batch file only recycles its own frames
+		for(int i = 0; i < 200; i++)
+			mgr.readPage(&batchFile, batchPages[i]).release();
+		checkPassFail(mgr.numFramesOf(&batchFile), 10)
+		checkPassFail(mgr.getFileStats(&batchFile).accesses, 400)
+
+		mgr.flushFile(&hotFile);
+		mgr.flushFile(&batchFile);
+	}
+	File::remove(hotName);
+	File::remove(batchName);
+	std::cout << "Test 14 Passed" << std::endl;
+}
+
+void test15()
+{
+	// Cycle dirty pages through a small pool with a file cache tier behind it: pages
+	// written back and evicted twice must come back from the tier, unchanged.
+	// Then run the index tests with the tier in place.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "file cache tier" << std::endl;
+	const std::string blobName = relationName + ".tiered";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		FileCacheTier tier(relationName + ".cache", 500);
+		BufMgr mgr(50);
+		mgr.setPageTier(&tier);
+		BlobFile file(blobName, true);
+
+		std::vector<PageId> pageNos(200);
+		for(int i = 0; i < 200; i++)
+		{
+			PageHandle page = mgr.allocPage(&file, pageNos[i]);
+			*reinterpret_cast<int*>(page.page()) = i;
+			page.markDirty();
+		}
+		for(int round = 0; round < 2; round++)
+		{
+			for(int i = 0; i < 200; i++)
+			{
+				PageHandle page = mgr.readPage(&file, pageNos[i]);
+				if(round == 0)
+				{
+					*reinterpret_cast<int*>(page.page()) = i + 1000;
+					page.markDirty();
+				}
+			}
+		}
+
+		mgr.clearBufStats();
+		int found = 0;
+		for(int i = 0; i < 200; i++)
+		{
+			PageHandle page = mgr.readPage(&file, pageNos[i]);
+			if(*reinterpret_cast<int*>(page.page()) == i + 1000)
+				found++;
+		}
+		checkPassFail(found, 200)
+		checkPassFail((mgr.getBufStats().tierreads > 0), true)
+
+		mgr.flushFile(&file);
+		checkPassFail(tier.size(), 0)
+		mgr.setPageTier(NULL);
+	}
+	File::remove(blobName);
+
+	{
+		FileCacheTier tier(relationName + ".cache", 2000, FileCacheTier::ADMIT_ALL);
+		bufMgr->setPageTier(&tier);
+		relationSize = 100000;
+		createRelationRandom();
+		indexTests();
+		deleteRelation();
+		bufMgr->setPageTier(NULL);
+	}
+	std::cout << "Test 15 Passed" << std::endl;
+}
+
+void test16()
+{
+	// Cycle dirty pages through a small pool with a compressed memory tier behind
+	// it: sparse pages must come back from the tier unchanged, a page of random
+	// bytes must be declined. Then run the index tests with the tier in place.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "compressed memory tier" << std::endl;
+	const std::string blobName = relationName + ".compressed";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		CompressedMemoryTier tier(200 * 1024);
+		BufMgr mgr(50);
+		mgr.setPageTier(&tier);
+		BlobFile file(blobName, true);
+
+		std::vector<PageId> pageNos(200);
+		for(int i = 0; i < 200; i++)
+		{
+			PageHandle page = mgr.allocPage(&file, pageNos[i]);
+			int* values = reinterpret_cast<int*>(page.page());
+			for(int j = 0; j < 100; j++)
+				values[j] = i * 100 + j;
+			page.markDirty();
+		}
+		PageId noisePageNo;
+		{
+			PageHandle page = mgr.allocPage(&file, noisePageNo);
+			char* bytes = reinterpret_cast<char*>(page.page());
+			for(std::size_t j = 0; j < Page::SIZE; j++)
+				bytes[j] = static_cast<char>(random());
+			page.markDirty();
+		}
+		for(int i = 0; i < 200; i++)
+			mgr.readPage(&file, pageNos[i]).release();
+		checkPassFail((tier.rejected() > 0), true)
+		checkPassFail((tier.compressionRatio() > 4), true)
+		checkPassFail((tier.bytesUsed() <= 200 * 1024), true)
+
+		mgr.clearBufStats();
+		int found = 0;
+		for(int i = 0; i < 200; i++)
+		{
+			PageHandle page = mgr.readPage(&file, pageNos[i]);
+			const int* values = reinterpret_cast<const int*>(page.page());
+			if(values[0] == i * 100 && values[99] == i * 100 + 99 && values[100] == 0)
+				found++;
+		}
+		checkPassFail(found, 200)
+		checkPassFail((mgr.getBufStats().tierreads > 0), true)
+
+		mgr.flushFile(&file);
+		checkPassFail(tier.size(), 0)
+		mgr.setPageTier(NULL);
+	}
+	File::remove(blobName);
+
+	{
+		CompressedMemoryTier tier(4 * 1024 * 1024);
+		bufMgr->setPageTier(&tier);
+		relationSize = 100000;
+		createRelationRandom();
+		indexTests();
+		deleteRelation();
+		bufMgr->setPageTier(NULL);
+	}
+	std::cout << "Test 16 Passed" << std::endl;
+}
+
+void test17()
+{
+	// Write sparse pages, a page of random bytes and a page that outgrows its slot
+	// to a compressed file, reopen it and read them back. Then build the index as
+	// a compressed file, and reopen and test it again.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "compressed index file" << std::endl;
+	const std::string blobName = relationName + ".zblob";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	PageId noisePageNo;
+	Page noise;
+	{
+		CompressedBlobFile file(blobName, true);
+		for(int i = 0; i < 100; i++)
+		{
+			PageId pageNo;
+			Page page = file.allocatePage(pageNo);
+			int* values = reinterpret_cast<int*>(&page);
+			for(int j = 0; j < 100; j++)
+				values[j] = i * 100 + j;
+			file.writePage(pageNo, page);
+		}
+		noise = file.allocatePage(noisePageNo);
+		char* bytes = reinterpret_cast<char*>(&noise);
+		for(std::size_t j = 0; j < Page::SIZE; j++)
+			bytes[j] = static_cast<char>(random());
+		file.writePage(noisePageNo, noise);
+
+		Page grown = file.readPage(1);
+		int* values = reinterpret_cast<int*>(&grown);
+		for(int j = 0; j < 1000; j++)
+			values[j] = j * 7919;
+		file.writePage(1, grown);
+		checkPassFail((file.storedBytes() < 40 * Page::SIZE), true)
+	}
+	checkPassFail(CompressedBlobFile::isCompressed(blobName), true)
+	{
+		CompressedBlobFile file(blobName, false);
+		int found = 0;
+		for(PageId pageNo = 2; pageNo <= 100; pageNo++)
+		{
+			Page page = file.readPage(pageNo);
+			const int* values = reinterpret_cast<const int*>(&page);
+			const int i = pageNo - 1;
+			if(values[0] == i * 100 && values[99] == i * 100 + 99 && values[100] == 0)
+				found++;
+		}
+		checkPassFail(found, 99)
+		Page grown = file.readPage(1);
+		checkPassFail(reinterpret_cast<const int*>(&grown)[999], 999 * 7919)
+		Page noiseRead = file.readPage(noisePageNo);
+		checkPassFail(memcmp(&noise, &noiseRead, Page::SIZE), 0)
+	}
+	File::remove(blobName);
+
+	// Pages compress to about as many bytes as they start with random ones
+	auto noisePage = [](std::size_t length) {
+		Page page;
+		char* bytes = reinterpret_cast<char*>(&page);
+		for(std::size_t j = 0; j < length; j++)
+			bytes[j] = static_cast<char>(random());
+		return page;
+	};
+	auto fileSize = [](const std::string& name) {
+		std::ifstream stream(name.c_str(), std::ifstream::binary | std::ifstream::ate);
+		return static_cast<std::uint64_t>(stream.tellg());
+	};
+	const std::string copyName = blobName + ".copy";
+	Page synced[2];
+	{
+		CompressedBlobFile file(blobName, true);
+		PageId pageNo;
+		synced[0] = noisePage(400);
+		file.allocatePage(pageNo);
+		file.writePage(pageNo, synced[0]);
+		synced[1] = noisePage(100);
+		file.allocatePage(pageNo);
+		file.writePage(pageNo, synced[1]);
+		file.sync();
+
+		// Page 1 moves out of its slot, which page 2 then outgrows its own into.
+		// A copy of the file taken now still reads both pages as of the sync.
+		file.writePage(1, noisePage(1500));
+		file.writePage(2, noisePage(400));
+		{
+			std::ifstream from(blobName.c_str(), std::ifstream::binary);
+			std::ofstream to(copyName.c_str(), std::ofstream::binary);
+			to << from.rdbuf();
+		}
+
+		// Syncing reuses the space of the directories written before
+		const Page rewritten = noisePage(400);
+		for(int i = 0; i < 2; i++)
+		{
+			file.writePage(2, rewritten);
+			file.sync();
+		}
+		const std::uint64_t size = fileSize(blobName);
+		for(int i = 0; i < 100; i++)
+		{
+			file.writePage(2, rewritten);
+			file.sync();
+		}
+		checkPassFail(fileSize(blobName), size)
+	}
+	{
+		CompressedBlobFile copy(copyName, false);
+		Page page = copy.readPage(1);
+		checkPassFail(memcmp(&page, &synced[0], Page::SIZE), 0)
+		page = copy.readPage(2);
+		checkPassFail(memcmp(&page, &synced[1], Page::SIZE), 0)
+	}
+	File::remove(copyName);
+	{
+		// Slots left behind before the file was closed are used again
+		const std::uint64_t size = fileSize(blobName);
+		CompressedBlobFile file(blobName, false);
+		PageId pageNo;
+		file.allocatePage(pageNo);
+		file.writePage(pageNo, noisePage(100));
+		file.allocatePage(pageNo);
+		file.writePage(pageNo, noisePage(100));
+		checkPassFail(fileSize(blobName), size)
+	}
+	File::remove(blobName);
+
+	indexFileFormat = COMPRESSED_FILE;
+	relationSize = 100000;
+	createRelationRandom();
+	intTests();
+	checkPassFail(CompressedBlobFile::isCompressed(intIndexName), true)
+	// The index file exists now, so this opens it again
+	intTests();
+	File::remove(intIndexName);
+	deleteRelation();
+	indexFileFormat = PLAIN_FILE;
+	std::cout << "Test 17 Passed" << std::endl;
+}
+
+void test18()
+{
+	// A file records the page size it was created with. Change the recorded size
+	// behind the system's back: opening the file must fail.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "page size in file header" << std::endl;
+	const std::string blobName = relationName + ".pagesize";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		BlobFile file(blobName, true);
+		PageId pageNo;
+		file.allocatePage(pageNo);
+	}
+
+	std::uint32_t pageSize = 0;
+	{
+		std::fstream stream(blobName.c_str(), std::fstream::in | std::fstream::out | std::fstream::binary);
+		stream.seekg(offsetof(FileHeader, page_size));
+		stream.read(reinterpret_cast<char*>(&pageSize), sizeof(pageSize));
+		checkPassFail(pageSize, Page::SIZE)
+
+		pageSize = Page::SIZE * 2;
+		stream.seekp(offsetof(FileHeader, page_size));
+		stream.write(reinterpret_cast<const char*>(&pageSize), sizeof(pageSize));
+	}
+
+	bool rejected = false;
+	try
+	{
+		BlobFile file(blobName, false);
+	}
+	catch(InvalidPageSizeException& e)
+	{
+		rejected = (e.page_size() == Page::SIZE * 2);
+	}
+	checkPassFail(rejected, true)
+	checkPassFail(File::isOpen(blobName), false)
+
+	File::remove(blobName);
+	std::cout << "Test 18 Passed" << std::endl;
+}
+
+void test19()
+{
+	// Allocating blob pages only reserves page numbers: the file grows in chunks,
+	// the header is written when the last file object goes away, and a new page
+	// evicted without changes comes back empty.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "lazy file extension" << std::endl;
+	const std::string blobName = relationName + ".lazy";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		BlobFile file(blobName, true);
+		PageId pageNo;
+		for(int i = 0; i < 10; i++)
+			file.allocatePage(pageNo);
+		checkPassFail(pageNo, 10)
+
+		std::ifstream stream(blobName.c_str(), std::ifstream::binary | std::ifstream::ate);
+		checkPassFail(static_cast<std::size_t>(stream.tellg()), sizeof(FileHeader) + BlobFile::EXTENSION_PAGES * Page::SIZE)
+
+		// A second object on the file sees the reserved pages
+		BlobFile other(blobName, false);
+		checkPassFail(other.getFirstPageNo(), 1)
+		other.allocatePage(pageNo);
+		checkPassFail(pageNo, 11)
+	}
+	{
+		BlobFile file(blobName, false);
+		PageId pageNo;
+		file.allocatePage(pageNo);
+		checkPassFail(pageNo, 12)
+	}
+
+	{
+		BufMgr mgr(3);
+		BlobFile file(blobName, false);
+		PageId pageNo;
+		mgr.allocPage(&file, pageNo).release();
+		for(int i = 0; i < 3; i++)
+		{
+			PageId otherNo;
+			mgr.allocPage(&file, otherNo).release();
+		}
+		PageHandle page = mgr.readPage(&file, pageNo);
+		checkPassFail(page.page()->getFreeSpace(), Page().getFreeSpace())
+		page.release();
+		mgr.flushFile(&file);
+	}
+	File::remove(blobName);
+	std::cout << "Test 19 Passed" << std::endl;
+}
+
+void test20()
+{
+	// Move the pages of a mapped file around and reopen it: every logical page must
+	// keep its contents. Then build the index as a mapped file, lay it out again
+	// while its pages are cached, and test it before and after reopening it.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "mapped index file" << std::endl;
+	const std::string blobName = relationName + ".mapped";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		MappedBlobFile file(blobName, true);
+		std::vector<PageId> pageNos;
+		for(int i = 0; i < 100; i++)
+		{
+			PageId pageNo;
+			Page page = file.allocatePage(pageNo);
+			*reinterpret_cast<int*>(&page) = i;
+			file.writePage(pageNo, page);
+			pageNos.push_back(pageNo);
+		}
+		std::vector<PageId> reversed(pageNos.rbegin(), pageNos.rend());
+		file.reorganize(reversed);
+		checkPassFail(file.physicalPageNo(pageNos[98]), file.physicalPageNo(pageNos[99]) + 1)
+
+		// Freed physical pages are reused
+		PageId pageNo;
+		file.allocatePage(pageNo);
+		checkPassFail((file.physicalPageNo(pageNo) < file.physicalPageNo(pageNos[99])), true)
+	}
+	checkPassFail(MappedBlobFile::isMapped(blobName), true)
+	{
+		MappedBlobFile file(blobName, false);
+		int found = 0;
+		for(PageId pageNo = 1; pageNo <= 100; pageNo++)
+		{
+			Page page = file.readPage(pageNo);
+			if(*reinterpret_cast<const int*>(&page) == static_cast<int>(pageNo) - 1)
+				found++;
+		}
+		checkPassFail(found, 100)
+	}
+	File::remove(blobName);
+
+	indexFileFormat = MAPPED_FILE;
+	relationSize = 100000;
+	createRelationRandom();
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, MAPPED_FILE);
+		checkPassFail(index.defragment(), true)
+		checkPassFail(intScan(&index,3000,GTE,4000,LT), 1000)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+	}
+	checkPassFail(MappedBlobFile::isMapped(intIndexName), true)
+	// The index file exists now, so this opens it again
+	intTests();
+	File::remove(intIndexName);
+	deleteRelation();
+	indexFileFormat = PLAIN_FILE;
+	std::cout << "Test 20 Passed" << std::endl;
+}
+
+void test21()
+{
+	// In shadow mode a snapshot keeps reading the last commit while pages are
+	// rewritten, an image of the file taken between commits opens as of the last
+	// one, and replaced pages are reused once no snapshot reads them. Then take a
+	// snapshot of an index and insert into the index while scanning it.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "shadow index file" << std::endl;
+	const std::string blobName = relationName + ".shadow";
+	const std::string crashName = relationName + ".crash";
+	try
+	{
+		File::remove(blobName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+
+	{
+		MappedBlobFile file(blobName, true, true);
+		checkPassFail(file.shadowing(), true)
+		PageId pageNo;
+		Page page = file.allocatePage(pageNo);
+		*reinterpret_cast<int*>(&page) = 1;
+		file.writePage(pageNo, page);
+		file.sync();
+		const PageId committedPage = file.physicalPageNo(pageNo);
+
+		SnapshotFile* snapshot = file.snapshot();
+		*reinterpret_cast<int*>(&page) = 2;
+		file.writePage(pageNo, page);
+		checkPassFail((file.physicalPageNo(pageNo) != committedPage), true)
+		Page current = file.readPage(pageNo);
+		checkPassFail(*reinterpret_cast<const int*>(&current), 2)
+		Page old = snapshot->readPage(pageNo);
+		checkPassFail(*reinterpret_cast<const int*>(&old), 1)
+
+		{
+			std::ifstream in(blobName.c_str(), std::ifstream::binary);
+			std::ofstream out(crashName.c_str(), std::ofstream::binary);
+			out << in.rdbuf();
+		}
+		{
+			MappedBlobFile crashed(crashName, false);
+			Page recovered = crashed.readPage(pageNo);
+			checkPassFail(*reinterpret_cast<const int*>(&recovered), 1)
+		}
+		File::remove(crashName);
+
+		file.sync();
+		old = snapshot->readPage(pageNo);
+		checkPassFail(*reinterpret_cast<const int*>(&old), 1)
+		delete snapshot;
+
+		*reinterpret_cast<int*>(&page) = 3;
+		file.writePage(pageNo, page);
+		file.sync();
+		bool reused = false;
+		for(int i = 0; i < 4; i++)
+		{
+			PageId otherNo;
+			file.allocatePage(otherNo);
+			reused = reused || file.physicalPageNo(otherNo) == committedPage;
+		}
+		checkPassFail(reused, true)
+	}
+	{
+		MappedBlobFile file(blobName, false);
+		checkPassFail(file.shadowing(), true)
+		Page current = file.readPage(1);
+		checkPassFail(*reinterpret_cast<const int*>(&current), 3)
+
+		*reinterpret_cast<int*>(&current) = 4;
+		file.writePage(1, current);
+		file.sync();
+	}
+	{
+		// A sync torn in the middle of writing either root page opens as of
+		// the sync before it or as of itself, never as a mix
+		std::set<int> recovered;
+		for(PageId rootPage = 1; rootPage <= 2; rootPage++)
+		{
+			{
+				std::ifstream in(blobName.c_str(), std::ifstream::binary);
+				std::ofstream out(crashName.c_str(), std::ofstream::binary);
+				out << in.rdbuf();
+			}
+			{
+				std::fstream stream(crashName.c_str(), std::fstream::in | std::fstream::out | std::fstream::binary);
+				stream.seekp(sizeof(FileHeader) + (rootPage - 1) * Page::SIZE + Page::SIZE / 2, std::ios::beg);
+				const std::string garbage(Page::SIZE / 2, 'x');
+				stream.write(garbage.data(), garbage.size());
+			}
+			{
+				MappedBlobFile crashed(crashName, false);
+				Page page = crashed.readPage(1);
+				recovered.insert(*reinterpret_cast<const int*>(&page));
+			}
+			File::remove(crashName);
+		}
+		checkPassFail((recovered == std::set<int>{3, 4}), true)
+	}
+	File::remove(blobName);
+
+	relationSize = 5000;
+	createRelationRandom();
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, SHADOW_FILE);
+		BTreeIndex* snapshot = index.snapshot();
+
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		for(key = relationSize; key < relationSize + 1000; key++)
+			index.insertEntry(&key, rid);
+
+		checkPassFail(intScan(snapshot,0,GTE,relationSize + 1000,LT), relationSize)
+		checkPassFail(intScan(&index,0,GTE,relationSize + 1000,LT), relationSize + 1000)
+		bool readOnly = false;
+		try
+		{
+			snapshot->insertEntry(&key, rid);
+		}
+		catch(BadIndexInfoException& e)
+		{
+			readOnly = true;
+		}
+		checkPassFail(readOnly, true)
+		delete snapshot;
+	}
+	{
+		// The root split by the inserts is found on reopening
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intScan(&index,0,GTE,relationSize + 1000,LT), relationSize + 1000)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 21 Passed" << std::endl;
+}
+
+void test22()
+{
+	// Build a B-epsilon tree from random keys, so most entries are still buffered
+	// in non-leaf nodes, look every key up, then scan, which moves the entries in
+	// the range down to the leaves, add several leaves of entries with one key,
+	// and test it again after reopening it.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B-epsilon tree index" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	const int duplicates = 3 * BEPSILON_LEAF_SIZE;
+	{
+		BEpsilonTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((index.flushCount() > 0), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+		checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+		checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+		checkPassFail(intScan(&index,300,GT,400,LT), 99)
+
+		// Entries with the same key are all kept, also when they take up several leaves
+		int key = 7;
+		RecordId rid;
+		index.lookup(&key, rid);
+		key = 8;
+		for(int i = 0; i < duplicates; i++)
+			index.insertEntry(&key, rid);
+		checkPassFail(intScan(&index,8,GTE,8,LTE), duplicates + 1)
+		checkPassFail(intScan(&index,7,GT,9,LT), duplicates + 1)
+		checkPassFail(intScan(&index,8,GT,10,LT), 1)
+		checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize + duplicates)
+	}
+	{
+		BEpsilonTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intLookup(&index,9,relationSize), relationSize - 9)
+		checkPassFail(intScan(&index,8,GTE,8,LTE), duplicates + 1)
+		checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize + duplicates)
+	}
+	{
+		// The file of another kind of index is rejected
+		bool rejected = false;
+		try
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		}
+		catch(BadIndexInfoException& e)
+		{
+			rejected = true;
+		}
+		checkPassFail(rejected, true)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 22 Passed" << std::endl;
+}
+
+void test23()
+{
+	// Build a Bw-tree, then let several threads insert new keys while others look
+	// up existing ones, add several leaves of entries with one key, and check all
+	// entries are there, also after reopening it.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "Bw-tree index with concurrent inserts" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	const int threads = 4;
+	const int extra = 20000;
+	const int duplicates = 3 * BWTREE_LEAF_CAPACITY;
+	// The new keys all point at the record of key 0
+	auto countKeys = [](BwTreeIndex& index, int lowVal, int highVal, RecordId rid) {
+		int numResults = 0;
+		for (int key = lowVal; key < highVal; key++) {
+			RecordId outRid;
+			try {
+				index.lookup(&key, outRid);
+			} catch (NoSuchKeyFoundException& e) {
+				continue;
+			}
+			if (outRid == rid)
+				numResults++;
+		}
+		return numResults;
+	};
+	{
+		BwTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((index.splitCount() > 0), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+		checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+		checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		std::vector<int> found(threads, 0);
+		std::vector<std::thread> workers;
+		for (int t = 0; t < threads; t++) {
+			workers.push_back(std::thread([&index, &found, rid, t, threads, extra]() {
+				// Interleaved keys, so the threads insert into the same leaves
+				for (int i = t; i < extra; i += threads) {
+					int newKey = relationSize + i;
+					index.insertEntry(&newKey, rid);
+					int oldKey = (i * 7) % relationSize;
+					RecordId outRid;
+					try {
+						index.lookup(&oldKey, outRid);
+						found[t]++;
+					} catch (NoSuchKeyFoundException& e) {
+					}
+				}
+			}));
+		}
+		for (std::thread& worker : workers)
+			worker.join();
+
+		int lookups = 0;
+		for (int count : found)
+			lookups += count;
+		checkPassFail(lookups, extra)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(countKeys(index, relationSize, relationSize + extra, rid), extra)
+		checkPassFail(intScan(&index,0,GTE,relationSize + extra,LT), relationSize + extra)
+
+		// Entries with the same key are all kept, also more than fit into a leaf
+		key = 1;
+		RecordId dupRid;
+		index.lookup(&key, dupRid);
+		for (int i = 0; i < duplicates; i++)
+			index.insertEntry(&key, dupRid);
+		checkPassFail(intScan(&index,1,GTE,1,LTE), duplicates + 1)
+		checkPassFail(intScan(&index,0,GT,3,LT), duplicates + 2)
+		checkPassFail(intScan(&index,0,GTE,relationSize + extra,LT), relationSize + extra + duplicates)
+	}
+	{
+		BwTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		checkPassFail(countKeys(index, relationSize, relationSize + extra, rid), extra)
+		checkPassFail(intScan(&index,relationSize,GTE,relationSize + extra,LT), extra)
+		checkPassFail(intScan(&index,1,GTE,1,LTE), duplicates + 1)
+		checkPassFail(intScan(&index,0,GTE,relationSize + extra,LT), relationSize + extra + duplicates)
+	}
+	{
+		// The file of another kind of index is rejected
+		bool rejected = false;
+		try
+		{
+			BEpsilonTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		}
+		catch(BadIndexInfoException& e)
+		{
+			rejected = true;
+		}
+		checkPassFail(rejected, true)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 23 Passed" << std::endl;
+}
+
+void test24()
+{
+	// Build a hash index, which needs many bucket splits, look every key up, add
+	// enough duplicates of one key to give its bucket overflow pages, and test it
+	// again after reopening it.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "Extendible hash index" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	const int duplicates = 2 * HASH_BUCKET_SIZE;
+	{
+		HashIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((index.splitCount() > 0), true)
+		checkPassFail((index.depth() > 0), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intLookup(&index,-1000,0), 0)
+		checkPassFail(intLookup(&index,relationSize,relationSize + 1000), 0)
+
+		int key = 7;
+		RecordId rid;
+		index.lookup(&key, rid);
+		for (int i = 0; i < duplicates; i++)
+			index.insertEntry(&key, rid);
+		checkPassFail((index.overflowCount() > 0), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+	}
+	{
+		HashIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+
+		// More inserts split buckets, also the one with the duplicates
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		for (key = relationSize; key < relationSize + 20000; key++)
+			index.insertEntry(&key, rid);
+		int found = 0;
+		for (key = relationSize; key < relationSize + 20000; key++) {
+			RecordId outRid;
+			index.lookup(&key, outRid);
+			if (outRid == rid)
+				found++;
+		}
+		checkPassFail(found, 20000)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+	}
+	{
+		// The file of another kind of index is rejected
+		bool rejected = false;
+		try
+		{
+			BwTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		}
+		catch(BadIndexInfoException& e)
+		{
+			rejected = true;
+		}
+		checkPassFail(rejected, true)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 24 Passed" << std::endl;
+}
+
+void test25()
+{
+	// Build a B+Tree with a Bloom filter, which is rebuilt several times as the
+	// index grows, and check that it rules out most missing keys but never a key
+	// in the index, also after reopening it.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B+Tree with Bloom filter" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, PLAIN_FILE, true);
+		checkPassFail(index.hasBloomFilter(), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intLookup(&index,relationSize,2 * relationSize), 0)
+		checkPassFail((index.bloomRejectCount() > (std::uint64_t) relationSize * 95 / 100), true)
+		checkPassFail(intScan(&index,-5,GTE,-5,LTE), 0)
+		checkPassFail(intScan(&index,5,GTE,5,LTE), 1)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+
+		// New keys pass the filter right away
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		int found = 0;
+		for (key = -1000; key < 0; key++) {
+			index.insertEntry(&key, rid);
+			RecordId outRid;
+			index.lookup(&key, outRid);
+			if (outRid == rid)
+				found++;
+		}
+		checkPassFail(found, 1000)
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.hasBloomFilter(), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intLookup(&index,relationSize,2 * relationSize), 0)
+		checkPassFail((index.bloomRejectCount() > (std::uint64_t) relationSize * 95 / 100), true)
+		checkPassFail(intScan(&index,-1000,GTE,0,LT), 1000)
+	}
+	File::remove(intIndexName);
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.hasBloomFilter(), false)
+		checkPassFail(intLookup(&index,relationSize,relationSize + 1000), 0)
+		checkPassFail(index.bloomRejectCount(), 0)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 25 Passed" << std::endl;
+}
+
+void test26()
+{
+	// Train a model over a B+Tree and look every key up through it, then insert
+	// keys at uneven gaps, which fall back to the descent until the model is
+	// trained again and need more segments.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B+Tree with learned model" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.hasLearnedModel(), false)
+		index.trainLearnedModel();
+		checkPassFail(index.hasLearnedModel(), true)
+		checkPassFail((index.learnedSegmentCount() >= 1), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intLookup(&index,-1000,0), 0)
+		checkPassFail(intLookup(&index,relationSize,relationSize + 1000), 0)
+		checkPassFail((index.learnedLookupCount() == (std::uint64_t) relationSize + 2000), true)
+
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		for (int i = 1; i <= 2000; i++) {
+			key = relationSize + i * i;
+			index.insertEntry(&key, rid);
+		}
+		checkPassFail(index.hasLearnedModel(), false)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+
+		index.trainLearnedModel(8);
+		const std::size_t segments = index.learnedSegmentCount();
+		checkPassFail((segments > 1), true)
+		int found = 0;
+		for (int i = 1; i <= 2000; i++) {
+			key = relationSize + i * i;
+			RecordId outRid;
+			index.lookup(&key, outRid);
+			if (outRid == rid)
+				found++;
+		}
+		checkPassFail(found, 2000)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intLookup(&index,relationSize + 2,relationSize + 4), 0)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 26 Passed" << std::endl;
+}
+
+void test27()
+{
+	// Build an adaptive radix tree over keys spread across all key bytes, check
+	// lookups and scans, then checkpoint it and check that a new index loads the
+	// entries from the file, including keys inserted after the first checkpoint
+	// and many entries with one key.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "Adaptive radix tree" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	try
+	{
+		File::remove(intIndexName);
+	}
+	catch(FileNotFoundException e)
+	{
+	}
+	const int duplicates = 2 * INTARRAYLEAFSIZE;
+	int key = 0;
+	RecordId rid;
+	{
+		ArtIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((index.entryCount() == (std::uint64_t) relationSize), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intLookup(&index,-1000,0), 0)
+		checkPassFail(intLookup(&index,relationSize,relationSize + 1000), 0)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,-3,GT,3,LT), 3)
+		checkPassFail(intScan(&index,996,GT,1001,LT), 4)
+		checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize)
+		checkPassFail(File::exists(intIndexName), false)
+
+		// Negative and large keys differ from the others in their first bytes
+		index.lookup(&key, rid);
+		for (int i = 1; i <= 1000; i++) {
+			key = -i * 7919;
+			index.insertEntry(&key, rid);
+			key = INT_MAX - i * 104729;
+			index.insertEntry(&key, rid);
+		}
+		key = INT_MIN;
+		index.insertEntry(&key, rid);
+		key = INT_MAX;
+		index.insertEntry(&key, rid);
+		checkPassFail((index.entryCount() == (std::uint64_t) relationSize + 2002), true)
+		checkPassFail(intScan(&index,INT_MIN,GTE,0,LT), 1001)
+		checkPassFail(intScan(&index,relationSize,GTE,INT_MAX,LTE), 1001)
+		index.checkpoint();
+
+		key = -1;
+		index.insertEntry(&key, rid);
+		checkPassFail(intScan(&index,INT_MIN,GTE,0,LT), 1002)
+	}
+	{
+		ArtIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((index.entryCount() == (std::uint64_t) relationSize + 2002), true)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intScan(&index,INT_MIN,GTE,0,LT), 1001)
+		checkPassFail(intScan(&index,relationSize,GTE,INT_MAX,LTE), 1001)
+		int found = 0;
+		for (int i = 1; i <= 1000; i++) {
+			RecordId outRid;
+			key = -i * 7919;
+			index.lookup(&key, outRid);
+			if (outRid == rid)
+				found++;
+		}
+		checkPassFail(found, 1000)
+
+		// Entries with the same key are all kept
+		key = 5;
+		RecordId dupRid;
+		index.lookup(&key, dupRid);
+		for (int i = 0; i < duplicates; i++)
+			index.insertEntry(&key, dupRid);
+		checkPassFail((index.entryCount() == (std::uint64_t) relationSize + 2002 + duplicates), true)
+		checkPassFail(intScan(&index,5,GTE,5,LTE), duplicates + 1)
+		checkPassFail(intScan(&index,3,GT,7,LT), duplicates + 3)
+
+		// A second checkpoint reuses the pages of the first
+		key = -1;
+		index.insertEntry(&key, rid);
+		index.checkpoint();
+	}
+	{
+		ArtIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail((index.entryCount() == (std::uint64_t) relationSize + 2003 + duplicates), true)
+		checkPassFail(intScan(&index,INT_MIN,GTE,0,LT), 1002)
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intScan(&index,5,GTE,5,LTE), duplicates + 1)
+		checkPassFail(intScan(&index,0,GTE,relationSize,LT), relationSize + duplicates)
+	}
+	{
+		// The file of another kind of index is rejected
+		bool rejected = false;
+		try
+		{
+			HashIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		}
+		catch(BadIndexInfoException& e)
+		{
+			rejected = true;
+		}
+		checkPassFail(rejected, true)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 27 Passed" << std::endl;
+}
+
+void test28()
+{
+	// Grow a B+Tree until its non-leaf nodes hold full blocks of keys and split,
+	// and check that searching them through their directory and by reading
+	// their keys in order find the same entries, also for keys at the ends of
+	// the key range.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B+Tree non-leaf node directory" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		const int extra = 400000;
+		for (key = relationSize; key < relationSize + extra; key++)
+			index.insertEntry(&key, rid);
+		key = INT_MAX;
+		index.insertEntry(&key, rid);
+		key = INT_MIN;
+		index.insertEntry(&key, rid);
+
+		for (int pass = 0; pass < 2; pass++) {
+			index.setDirectorySearch(pass == 0);
+			checkPassFail(intLookup(&index,0,relationSize), relationSize)
+			checkPassFail(intLookup(&index,-1000,0), 0)
+			int found = 0;
+			for (key = relationSize; key < relationSize + extra; key += 7) {
+				RecordId outRid;
+				index.lookup(&key, outRid);
+				if (outRid == rid)
+					found++;
+			}
+			checkPassFail(found, (extra + 6) / 7)
+			checkPassFail(intScan(&index,INT_MIN,GTE,0,LT), 1)
+			checkPassFail(intScan(&index,relationSize + extra - 5,GTE,INT_MAX,LTE), 6)
+			checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		}
+	}
+	{
+		// A file written with another node layout is rejected
+		BlobFile file(intIndexName, false);
+		const PageId headerPageNo = file.getFirstPageNo();
+		Page header = file.readPage(headerPageNo);
+		reinterpret_cast<IndexMetaInfo*>(&header)->layoutVersion = BTREE_LAYOUT_VERSION - 1;
+		file.writePage(headerPageNo, header);
+	}
+	{
+		bool rejected = false;
+		try
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		}
+		catch(BadIndexInfoException& e)
+		{
+			rejected = true;
+		}
+		checkPassFail(rejected, true)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 28 Passed" << std::endl;
+}
+
+void test29()
+{
+	// Keep subtree counts in a B+Tree, check range counts against scans and rank
+	// against select, grow the tree until its root splits, and check the counts
+	// again after reopening it.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B+Tree with subtree counts" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	const int extra = 400000;
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, PLAIN_FILE, false, true);
+		checkPassFail(index.hasSubtreeCounts(), true)
+		int low = 25, high = 40;
+		checkPassFail((index.countRange(&low, GT, &high, LT) == 14), true)
+		checkPassFail((index.countRange(&low, GTE, &high, LTE) == 16), true)
+		checkPassFail((index.countRange(&high, GT, &high, LT) == 0), true)
+		low = -1000;
+		high = relationSize + 1000;
+		checkPassFail((index.countRange(&low, GTE, &high, LT) == (std::uint64_t) relationSize), true)
+
+		int key = 0;
+		RecordId rid;
+		index.lookup(&key, rid);
+		for (key = relationSize; key < relationSize + extra; key++)
+			index.insertEntry(&key, rid);
+		key = relationSize - 1;
+		index.insertEntry(&key, rid);
+
+		// Ranks of duplicates count the entries before the first of them
+		low = relationSize - 1;
+		key = relationSize;
+		checkPassFail((index.rank(&low) == (std::uint64_t) relationSize - 1), true)
+		checkPassFail((index.rank(&key) == (std::uint64_t) relationSize + 1), true)
+		checkPassFail((index.countRange(&low, GTE, &low, LTE) == 2), true)
+		high = relationSize + extra;
+		checkPassFail((index.countRange(&low, GT, &high, LT) == (std::uint64_t) extra), true)
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.hasSubtreeCounts(), true)
+		int low = 25, high = 40;
+		checkPassFail((index.countRange(&low, GT, &high, LT) == (std::uint64_t) intScan(&index,25,GT,40,LT)), true)
+		low = relationSize + 1234;
+		high = relationSize + 345678;
+		checkPassFail((index.countRange(&low, GTE, &high, LTE) == (std::uint64_t) intScan(&index,low,GTE,high,LTE)), true)
+
+		int mismatches = 0;
+		for (std::uint64_t k = 0; k < (std::uint64_t) relationSize + extra + 1; k += 997) {
+			int key;
+			RecordId outRid;
+			index.select(k, &key, outRid);
+			const int expected = k < (std::uint64_t) relationSize ? (int) k : (int) k - 1;
+			if (key != expected || (k != (std::uint64_t) relationSize && index.rank(&key) != k))
+				mismatches++;
+		}
+		checkPassFail(mismatches, 0)
+
+		int key;
+		RecordId outRid;
+		bool pastEnd = false;
+		try {
+			index.select(relationSize + extra + 1, &key, outRid);
+		} catch (NoSuchKeyFoundException& e) {
+			pastEnd = true;
+		}
+		checkPassFail(pastEnd, true)
+	}
+	File::remove(intIndexName);
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+		checkPassFail(index.hasSubtreeCounts(), false)
+		int key = 0;
+		bool rejected = false;
+		try {
+			index.rank(&key);
+		} catch (BadIndexInfoException& e) {
+			rejected = true;
+		}
+		checkPassFail(rejected, true)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 29 Passed" << std::endl;
+}
+
+void test30()
+{
+	// Draw samples from ranges of a B+Tree with and without subtree counts, in
+	// a tree with two non-leaf levels, and check that every sample is an entry
+	// in its range and that the samples spread over the range. The ranges are
+	// wider and narrower than SAMPLE_SCAN_LEAVES leaves, and no range may cost
+	// more than a few buffer pool accesses per sample.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B+Tree sampling" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	const int extra = 400000;
+	for (int pass = 0; pass < 2; pass++) {
+		{
+			BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, PLAIN_FILE, false, pass == 1);
+			int key = 0;
+			RecordId rid;
+			index.lookup(&key, rid);
+			for (key = relationSize; key < relationSize + extra; key++)
+				index.insertEntry(&key, rid);
+
+			const int ranges[][2] = {{0, relationSize + extra}, {relationSize, relationSize + 20000},
+				{relationSize / 2, relationSize / 2 + 20}, {25, 40}};
+			for (const auto& range : ranges) {
+				std::vector<RIDKeyPair<int>> samples;
+				bufMgr->setFileQuota(index.indexFile(), 0, 0);
+				index.sample(&range[0], GTE, &range[1], LT, 2000, samples);
+				checkPassFail((int) samples.size(), 2000)
+				// A sample takes at most three attempts on average, each reading two nodes
+				checkPassFail((bufMgr->getFileStats(index.indexFile()).accesses < 2000 * 6 + 100), true)
+				bufMgr->removeFileQuota(index.indexFile());
+
+				int outside = 0, wrongRid = 0, lowerHalf = 0;
+				for (const RIDKeyPair<int>& sample : samples) {
+					if (sample.key < range[0] || sample.key >= range[1])
+						outside++;
+					RecordId outRid;
+					index.lookup(&sample.key, outRid);
+					if (!(outRid == sample.rid))
+						wrongRid++;
+					if (sample.key < range[0] + (range[1] - range[0]) / 2)
+						lowerHalf++;
+				}
+				checkPassFail(outside, 0)
+				checkPassFail(wrongRid, 0)
+				checkPassFail((lowerHalf > 850 && lowerHalf < 1150), true)
+			}
+
+			std::vector<RIDKeyPair<int>> samples;
+			int low = relationSize + extra, high = relationSize + extra + 1000;
+			bool empty = false;
+			try {
+				index.sample(&low, GTE, &high, LTE, 10, samples);
+			} catch (NoSuchKeyFoundException& e) {
+				empty = true;
+			}
+			checkPassFail(empty, true)
+			low = 7;
+			index.sample(&low, GTE, &low, LTE, 10, samples);
+			checkPassFail((samples.size() == 10 && samples[0].key == 7 && samples[9].key == 7), true)
+		}
+		File::remove(intIndexName);
+	}
+	deleteRelation();
+	std::cout << "Test 30 Passed" << std::endl;
+}
+
+void test31()
+{
+	// Look keys up in a B+Tree through buffer pools so small that reading a leaf
+	// evicts the non-leaf node read before it, and check that a pool of a single
+	// frame, which cannot hold a node and its child, is reported.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B+Tree in a tiny buffer pool" << std::endl;
+	relationSize = 5000;
+	createRelationRandom();
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+	}
+	for (std::uint32_t frames = 1; frames <= 3; frames++) {
+		BufMgr tinyBufMgr(frames);
+		BTreeIndex index(relationName, intIndexName, &tinyBufMgr, offsetof(tuple,i), INTEGER);
+		if (frames == 1) {
+			bool exceeded = false;
+			try {
+				intLookup(&index,0,10);
+			} catch (BufferExceededException& e) {
+				exceeded = true;
+			}
+			checkPassFail(exceeded, true)
+			continue;
+		}
+		checkPassFail(intLookup(&index,0,relationSize), relationSize)
+		checkPassFail(intScan(&index,25,GT,40,LT), 14)
+		checkPassFail(intScan(&index,-100,GT,relationSize + 100,LT), relationSize)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+	std::cout << "Test 31 Passed" << std::endl;
+}
+
+void test32()
+{
+	// Dirty scattered pages of a PageFile and a BlobFile in one pool and flush only
+	// the PageFile: its pages must be on disk and its frames released, while the
+	// pages of the BlobFile stay dirty in the pool and only reach disk on its own flush.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "flushFile writes back only the pages of its file" << std::endl;
+	const std::string pageFileName = relationName + ".flush";
+	const std::string blobFileName = relationName + ".flushblob";
+	const int numPages = 20;
+	const int dirtied[] = {0, 3, 4, 5, 11, 17, 19};
+	try
+	{
+		File::remove(pageFileName);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+	try
+	{
+		File::remove(blobFileName);
+	}
+	catch(const FileNotFoundException&)
+	{
+	}
+
+	{
+		BufMgr mgr(100);
+		PageFile pageFile = PageFile::create(pageFileName);
+		BlobFile blobFile(blobFileName, true);
+		std::vector<PageId> pageNos(numPages), blobNos(numPages);
+		std::vector<RecordId> rids(numPages);
+		for(int i = 0; i < numPages; i++)
+		{
+			PageHandle page = mgr.allocPage(&pageFile, pageNos[i]);
+			rids[i] = page.page()->insertRecord(std::to_string(i));
+			page.markDirty();
+			PageHandle blob = mgr.allocPage(&blobFile, blobNos[i]);
+			*reinterpret_cast<int*>(blob.page()) = i;
+			blob.markDirty();
+		}
+		mgr.checkpointFile(&pageFile);
+		mgr.checkpointFile(&blobFile);
+
+		// Change the same scattered pages of both files
+		for(const int i : dirtied)
+		{
+			PageHandle page = mgr.readPage(&pageFile, pageNos[i]);
+			page.page()->updateRecord(rids[i], std::to_string(1000 + i));
+			page.markDirty();
+			PageHandle blob = mgr.readPage(&blobFile, blobNos[i]);
+			*reinterpret_cast<int*>(blob.page()) = 1000 + i;
+			blob.markDirty();
+		}
+
+		mgr.flushFile(&pageFile);
+		checkPassFail(mgr.numFramesOf(&pageFile), 0)
+		checkPassFail(mgr.numFramesOf(&blobFile), numPages)
+
+		// The PageFile on disk holds every change, the BlobFile on disk none of them
+		int pageFileChanged = 0, blobFileChanged = 0;
+		for(int i = 0; i < numPages; i++)
+		{
+			const std::string record = pageFile.readPage(pageNos[i]).getRecord(rids[i]);
+			if(record == std::to_string(1000 + i))
+				pageFileChanged++;
+			else if(record != std::to_string(i))
+				pageFileChanged = -numPages;
+			const Page blob = blobFile.readPage(blobNos[i]);
+			if(*reinterpret_cast<const int*>(&blob) != i)
+				blobFileChanged++;
+		}
+		checkPassFail(pageFileChanged, (int) (sizeof(dirtied) / sizeof(dirtied[0])))
+		checkPassFail(blobFileChanged, 0)
+
+		// The changed BlobFile pages are still in the pool, and still dirty
+		mgr.clearBufStats();
+		int blobPoolChanged = 0;
+		for(int i = 0; i < numPages; i++)
+		{
+			PageHandle blob = mgr.readPage(&blobFile, blobNos[i]);
+			if(*reinterpret_cast<const int*>(blob.page()) == 1000 + i)
+				blobPoolChanged++;
+		}
+		checkPassFail(blobPoolChanged, (int) (sizeof(dirtied) / sizeof(dirtied[0])))
+		checkPassFail(mgr.getBufStats().diskreads, 0)
+
+		mgr.flushFile(&blobFile);
+		blobFileChanged = 0;
+		for(int i = 0; i < numPages; i++)
+		{
+			const Page blob = blobFile.readPage(blobNos[i]);
+			if(*reinterpret_cast<const int*>(&blob) == 1000 + i)
+				blobFileChanged++;
+		}
+		checkPassFail(blobFileChanged, (int) (sizeof(dirtied) / sizeof(dirtied[0])))
+	}
+	File::remove(pageFileName);
+	File::remove(blobFileName);
+	std::cout << "Test 32 Passed" << std::endl;
+}
+
+void test33()
+{
+	// Look keys up in a B+Tree with two non-leaf levels and count the buffer pool
+	// accesses to the index file. Every resident level saves one access per
+	// lookup, with both non-leaf levels resident only the leaf is read. Resident
+	// nodes are also found through swizzled references.
+	std::cout << "---------------------------------------------" << std::endl;
+	std::cout << "B+Tree resident levels" << std::endl;
+	relationSize = 100000;
+	createRelationRandom();
+	const int extra = 400000;
+	const int numLookups = 1000;
+	for (int swizzle = 0; swizzle < 2; swizzle++) {
+		BufMgr mgr(100);
+		mgr.setSwizzling(swizzle == 1);
+		{
+			BTreeIndex index(relationName, intIndexName, &mgr, offsetof(tuple,i), INTEGER);
+			int key = 0;
+			RecordId rid;
+			index.lookup(&key, rid);
+			for (key = relationSize; key < relationSize + extra; key++)
+				index.insertEntry(&key, rid);
+
+			for (int levels = 0; levels <= 2; levels++) {
+				index.setResidentLevels(levels);
+				// The root has non-leaf children, so the tree has three levels
+				if (levels == 2)
+					checkPassFail((index.residentPageCount() > 1), true)
+
+				mgr.setFileQuota(index.indexFile(), 0, 0);
+				for (int n = 0; n < numLookups; n++) {
+					key = random() % (relationSize + extra);
+					index.lookup(&key, rid);
+				}
+				checkPassFail(mgr.getFileStats(index.indexFile()).accesses, numLookups * (3 - levels))
+			}
+			mgr.removeFileQuota(index.indexFile());
+			index.setResidentLevels(0);
+		}
+		File::remove(intIndexName);
+	}
+	deleteRelation();
+	std::cout << "Test 33 Passed" << std::endl;
+}
+
 // -----------------------------------------------------------------------------
 // createRelationForward
 // -----------------------------------------------------------------------------
@@ -299,8 +2024,7 @@ void createRelationForward()
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+	FileAppender appender(file1);
 
   // Insert a bunch of tuples into the relation.
   for(int i = 0; i < relationSize; i++ )
@@ -310,22 +2034,10 @@ void createRelationForward()
     record1.d = (double)i;
     std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
 
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+		appender.appendRecord(new_data);
   }
 
-	file1->writePage(new_page_number, new_page);
+	appender.finish();
 }
 
 // -----------------------------------------------------------------------------
@@ -346,8 +2058,7 @@ void createRelationBackward()
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+	FileAppender appender(file1);
 
   // Insert a bunch of tuples into the relation.
   for(int i = relationSize - 1; i >= 0; i-- )
@@ -358,22 +2069,10 @@ void createRelationBackward()
 
     std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
 
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+		appender.appendRecord(new_data);
   }
 
-	file1->writePage(new_page_number, new_page);
+	appender.finish();
 }
 
 // -----------------------------------------------------------------------------
@@ -394,8 +2093,7 @@ void createRelationRandom()
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+	FileAppender appender(file1);
 
   // insert records in random order
 
@@ -418,19 +2116,7 @@ void createRelationRandom()
 
     std::string new_data(reinterpret_cast<char*>(&record1), sizeof(RECORD));
 
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-      	file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+		appender.appendRecord(new_data);
 
 		int temp = intvec[relationSize-1-i];
 		intvec[relationSize-1-i] = intvec[pos];
@@ -438,7 +2124,7 @@ void createRelationRandom()
 		i++;
   }
 
-	file1->writePage(new_page_number, new_page);
+	appender.finish();
 }
 
 // -----------------------------------------------------------------------------
@@ -467,7 +2153,8 @@ void indexTests()
 void intTests()
 {
   std::cout << "Create a B+ Tree index on the integer field" << std::endl;
-  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
+  BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER, indexFileFormat);
+	index.setResidentLevels(residentLevels);
 	// run some tests
 	checkPassFail(intScan(&index,25,GT,40,LT), 14)
 	checkPassFail(intScan(&index,20,GTE,35,LTE), 16)
@@ -482,9 +2169,46 @@ void intTests()
 	checkPassFail(intScan(&index,-200,GT,-100,LT), 0)
 	// One scan bound too low, one too high
 	checkPassFail(intScan(&index,-100,GT,4000000,LT), relationSize)
+	// Point lookups, partly outside the key range
+	checkPassFail(intLookup(&index,-100,1100), 1100)
+	checkPassFail(intLookup(&index,relationSize-50,relationSize+50), 50)
+	// Every key is reachable from the root, not only through the leaf chain
+	checkPassFail(intLookup(&index,0,relationSize), relationSize)
+}
+
+template <class Index>
+int intLookup(Index * index, int lowVal, int highVal)
+{
+  RecordId rid;
+	Page *curPage;
+
+  std::cout << "Lookup of keys in [" << lowVal << "," << highVal << ")" << std::endl;
+
+  int numResults = 0;
+	for(int key = lowVal; key < highVal; key++)
+	{
+		try
+		{
+			index->lookup(&key, rid);
+		}
+		catch(NoSuchKeyFoundException e)
+		{
+			continue;
+		}
+
+		// Make sure the entry points at the record with the key
+		bufMgr->readPage(file1, rid.page_number, curPage);
+		RECORD myRec = *(reinterpret_cast<const RECORD*>(curPage->getRecord(rid).data()));
+		bufMgr->unPinPage(file1, rid.page_number, false);
+		if(myRec.i == key)
+			numResults++;
+	}
+
+	return numResults;
 }
 
-int intScan(BTreeIndex * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
+template <class Index>
+int intScan(Index * index, int lowVal, Operator lowOp, int highVal, Operator highOp)
 {
   RecordId scanRid;
 	Page *curPage;
@@ -567,8 +2291,7 @@ void errorTests()
 
   // initialize all of record1.s to keep purify happy
   memset(record1.s, ' ', sizeof(record1.s));
-	PageId new_page_number;
-  Page new_page = file1->allocatePage(new_page_number);
+	FileAppender appender(file1);
 
   // Insert a bunch of tuples into the relation.
 	for(int i = 0; i <10; i++ )
@@ -578,22 +2301,10 @@ void errorTests()
     record1.d = (double)i;
     std::string new_data(reinterpret_cast<char*>(&record1), sizeof(record1));
 
-		while(1)
-		{
-			try
-			{
-    		new_page.insertRecord(new_data);
-				break;
-			}
-			catch(InsufficientSpaceException e)
-			{
-				file1->writePage(new_page_number, new_page);
-  			new_page = file1->allocatePage(new_page_number);
-			}
-		}
+		appender.appendRecord(new_data);
   }
 
-	file1->writePage(new_page_number, new_page);
+	appender.finish();
 
   BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple,i), INTEGER);
 
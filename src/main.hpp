@@ -157,6 +157,22 @@
  *   }
  * @endcode
  *
+ * Loading many records one page at a time is dominated by file metadata
+ * updates.  A FileAppender packs records into pages in memory and writes them
+ * to the end of a PageFile in large sequential batches:
+ * @code
+ *   #include "file_appender.h"
+ *
+ *   ...
+ *
+ *   badgerdb::PageFile db_file = badgerdb::PageFile::create("filename.db");
+ *   badgerdb::FileAppender appender(&db_file);
+ *   for (int i = 0; i < 1000000; ++i) {
+ *     appender.appendRecord("hello, world!");
+ *   }
+ *   appender.finish();
+ * @endcode
+ *
  * @subsubsection page_sec Reading and writing data in a page
  *
  * Pages hold variable-length records containing arbitrary data.
@@ -95,6 +95,10 @@ struct PageSlot {
 
 class PageIterator;
 
+#ifndef BADGERDB_PAGE_SIZE
+#define BADGERDB_PAGE_SIZE 8192
+#endif
+
 /**
  * @brief Class which represents a fixed-size database page containing records.
  *
@@ -108,10 +112,13 @@ class PageIterator;
 class Page {
  public:
   /**
-   * Page size in bytes.  If this is changed, database files created with a
-   * different page size value will be unreadable by the resulting binaries.
+   * Page size in bytes, fixed at compile time by BADGERDB_PAGE_SIZE (build
+   * with "make PAGE_SIZE=16384" after "make clean").  Node layouts and
+   * fanouts derived from it are compile-time constants.  Every file records
+   * the page size it was created with; opening it with a binary built for a
+   * different size throws InvalidPageSizeException.
    */
-  static const std::size_t SIZE = 8192;
+  static const std::size_t SIZE = BADGERDB_PAGE_SIZE;
 
   /**
    * Size of page free space area in bytes.
@@ -337,11 +344,16 @@ class Page {
   friend class PageFile;
   friend class BlobFile;
   friend class PageIterator;
+  friend class FileAppender;
 };
 
 static_assert(Page::SIZE > sizeof(PageHeader),
               "Page size must be large enough to hold header and data.");
 static_assert(Page::DATA_SIZE > 0,
               "Page must have some space to hold data.");
+static_assert(Page::SIZE >= 4096 && Page::SIZE <= 32768 &&
+              (Page::SIZE & (Page::SIZE - 1)) == 0,
+              "Page size must be a power of two from 4096 to 32768, as "
+              "offsets within a page are 16 bits.");
 
 }
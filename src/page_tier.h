@@ -0,0 +1,77 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include "file.h"
+#include "page.h"
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Interface of a second-level page cache behind the buffer pool.
+ *
+ * When a BufMgr has a tier, pages leaving the pool are offered to the tier
+ * after they have been written back, and misses in the pool look the page up
+ * in the tier before reading it from its file.  The tier decides which pages
+ * it keeps.  It only ever holds copies of pages as they are on disk: the
+ * buffer manager invalidates a page whenever it writes the page back, deletes
+ * it or flushes its file.
+ *
+ * Pages are identified by the name of their file, so all File objects open on
+ * the same file share the cached pages.  Files that are changed or removed
+ * behind the buffer manager's back must be invalidated with invalidateFile().
+ *
+ * @warning Implementations need not be threadsafe.
+ */
+class PageTier {
+ public:
+  /**
+   * Destructor.
+   */
+  virtual ~PageTier() {}
+
+  /**
+   * Looks up a page in the tier.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page within the file.
+   * @param page         Receives the page if it is held by the tier.
+   * @return  True if the page was found.
+   */
+  virtual bool fetch(const File& file, const PageId page_number,
+                     Page& page) = 0;
+
+  /**
+   * Offers a clean page that is leaving the buffer pool.  The tier may keep
+   * a copy of it or decline it.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page within the file.
+   * @param page         Contents of the page, identical to the page on disk.
+   */
+  virtual void admit(const File& file, const PageId page_number,
+                     const Page& page) = 0;
+
+  /**
+   * Drops the copy of a page, if the tier holds one.
+   *
+   * @param file         File the page belongs to.
+   * @param page_number  Number of the page within the file.
+   */
+  virtual void invalidate(const File& file, const PageId page_number) = 0;
+
+  /**
+   * Drops the copies of all pages of a file.
+   *
+   * @param file  File whose pages to drop.
+   */
+  virtual void invalidateFile(const File& file) = 0;
+};
+
+}